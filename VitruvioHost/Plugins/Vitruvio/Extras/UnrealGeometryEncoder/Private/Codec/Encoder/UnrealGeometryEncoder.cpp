@@ -34,10 +34,12 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cwchar>
 #include <memory>
 #include <numeric>
 #include <set>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 
 namespace
@@ -50,6 +52,15 @@ constexpr const wchar_t* UNREAL_GEOMETRY_ENCODER_DESCRIPTION = L"Encodes geometr
 constexpr const wchar_t* EO_EMIT_ATTRIBUTES = L"emitAttributes";
 constexpr const wchar_t* EO_EMIT_MATERIALS = L"emitMaterials";
 constexpr const wchar_t* EO_EMIT_REPORTS = L"emitReports";
+constexpr const wchar_t* EO_EMIT_RENDER_STREAMS = L"emitRenderStreams";
+constexpr const wchar_t* EO_VERTEX_OFFSET = L"vertexOffset";
+constexpr const wchar_t* EO_STREAM_MESHES = L"streamMeshes";
+constexpr const wchar_t* EO_EMIT_MATERIAL_IDS = L"emitMaterialIds";
+constexpr const wchar_t* EO_STREAM_CHUNK_SIZE = L"streamChunkSize";
+constexpr const wchar_t* EO_SPLIT_INITIAL_SHAPES = L"splitInitialShapes";
+
+// conversion from meters (PRT) to centimeters (Unreal)
+constexpr double PRT_TO_UE_SCALE = 100.0;
 
 const prtx::DoubleVector EMPTY_UVS;
 const prtx::IndexVector EMPTY_IDX;
@@ -74,22 +85,25 @@ struct SerializedGeometry
 	}
 };
 
-using AttributeMapNOPtrVector = std::vector<const prt::AttributeMap*>;
-
-struct AttributeMapNOPtrVectorOwner
+// triangulated geometry with one index buffer shared by all vertex attributes, already converted to the Unreal frame
+struct SerializedRenderGeometry
 {
-	AttributeMapNOPtrVector v;
+	std::vector<float> positions;
+	std::vector<float> normals;
+	std::vector<std::vector<float>> uvs;
+	std::vector<uint32_t> indices;
+	std::vector<uint32_t> faceRanges;
 
-	~AttributeMapNOPtrVectorOwner()
+	SerializedRenderGeometry(uint32_t numVertices, uint32_t numIndices, uint32_t uvSets) : uvs(uvSets)
 	{
-		for (const auto& m : v)
-		{
-			if (m != nullptr)
-				m->destroy();
-		}
+		positions.reserve(numVertices * 3);
+		normals.reserve(numVertices * 3);
+		indices.reserve(numIndices);
 	}
 };
 
+using AttributeMapNOPtrVector = std::vector<const prt::AttributeMap*>;
+
 struct TextureUVMapping
 {
 	std::wstring key;
@@ -353,6 +367,155 @@ void convertMaterialToAttributeMap(prtx::PRTUtils::AttributeMapBuilderPtr& aBuil
 	}
 }
 
+// serializes converted material attributes in key order, PRT creates separate material objects for equal materials (eg. per shape)
+// which have the same content key
+std::wstring getMaterialContentKey(const prt::AttributeMap* attributes)
+{
+	size_t keyCount = 0;
+	wchar_t const* const* keys = attributes->getKeys(&keyCount);
+	std::vector<std::wstring> sortedKeys(keys, keys + keyCount);
+	std::sort(sortedKeys.begin(), sortedKeys.end());
+
+	std::wostringstream contentKey;
+	contentKey << std::hexfloat;
+
+	// strings are prefixed with their length so their content can not be mistaken for a separator
+	const auto writeString = [&contentKey](const wchar_t* s) { contentKey << wcslen(s) << L':' << s; };
+	const auto writeArray = [&contentKey](const auto* values, size_t count, const auto& writeValue) {
+		contentKey << count << L'[';
+		for (size_t i = 0; i < count; i++)
+		{
+			writeValue(values[i]);
+			contentKey << L',';
+		}
+		contentKey << L']';
+	};
+	const auto writeValue = [&contentKey](const auto& value) { contentKey << value; };
+
+	for (const std::wstring& key : sortedKeys)
+	{
+		const wchar_t* k = key.c_str();
+		writeString(k);
+		contentKey << L'=' << attributes->getType(k) << L'|';
+
+		size_t count = 0;
+		switch (attributes->getType(k))
+		{
+		case prt::Attributable::PT_BOOL:
+			contentKey << attributes->getBool(k);
+			break;
+		case prt::Attributable::PT_FLOAT:
+			contentKey << attributes->getFloat(k);
+			break;
+		case prt::Attributable::PT_INT:
+			contentKey << attributes->getInt(k);
+			break;
+		case prt::Attributable::PT_STRING:
+			writeString(attributes->getString(k));
+			break;
+		case prt::Attributable::PT_BOOL_ARRAY:
+		{
+			const bool* values = attributes->getBoolArray(k, &count);
+			writeArray(values, count, writeValue);
+			break;
+		}
+		case prt::Attributable::PT_INT_ARRAY:
+		{
+			const int32_t* values = attributes->getIntArray(k, &count);
+			writeArray(values, count, writeValue);
+			break;
+		}
+		case prt::Attributable::PT_FLOAT_ARRAY:
+		{
+			const double* values = attributes->getFloatArray(k, &count);
+			writeArray(values, count, writeValue);
+			break;
+		}
+		case prt::Attributable::PT_STRING_ARRAY:
+		{
+			wchar_t const* const* values = attributes->getStringArray(k, &count);
+			writeArray(values, count, writeString);
+			break;
+		}
+		default:
+			break;
+		}
+		contentKey << L';';
+	}
+
+	return contentKey.str();
+}
+
+// converts every unique material of an encode only once. Materials are looked up by their prtx object first, which is shared by
+// meshes and instances with the same material, and then by their converted content, so equal materials of different shapes get the
+// same id as well.
+class MaterialInterner
+{
+public:
+	MaterialInterner(IUnrealCallbacks* cb, bool emitMaterialIds) : mCallbacks(cb), mEmitMaterialIds(emitMaterialIds), mAmb(prt::AttributeMapBuilder::create()) {}
+
+	// the attribute map stays valid as long as the interner
+	const prt::AttributeMap* getAttributeMap(const prtx::MaterialPtr& mat)
+	{
+		return intern(mat).attributeMap.get();
+	}
+
+	// passes the material to IUnrealCallbacks::addMaterial before it is first referenced by its id
+	int32_t getId(const prtx::MaterialPtr& mat)
+	{
+		Entry& entry = intern(mat);
+		if (mEmitMaterialIds && !entry.isEmitted)
+		{
+			mCallbacks->addMaterial(entry.id, entry.attributeMap.get());
+			entry.isEmitted = true;
+		}
+		return entry.id;
+	}
+
+private:
+	struct Entry
+	{
+		int32_t id;
+		prtx::PRTUtils::AttributeMapPtr attributeMap;
+		bool isEmitted = false;
+	};
+
+	struct MaterialRef
+	{
+		prtx::MaterialPtr material; // keeps the key alive
+		size_t entryIndex;
+	};
+
+	Entry& intern(const prtx::MaterialPtr& mat)
+	{
+		auto it = mEntriesByMaterial.find(mat.get());
+		if (it == mEntriesByMaterial.end())
+		{
+			convertMaterialToAttributeMap(mAmb, *(mat.get()), mat->getKeys());
+			prtx::PRTUtils::AttributeMapPtr attributeMap{mAmb->createAttributeMapAndReset()};
+
+			std::wstring contentKey = getMaterialContentKey(attributeMap.get());
+			auto contentIt = mEntriesByContent.find(contentKey);
+			if (contentIt == mEntriesByContent.end())
+			{
+				const size_t entryIndex = mEntries.size();
+				contentIt = mEntriesByContent.emplace(std::move(contentKey), entryIndex).first;
+				mEntries.push_back(Entry{static_cast<int32_t>(entryIndex), std::move(attributeMap)});
+			}
+
+			it = mEntriesByMaterial.emplace(mat.get(), MaterialRef{mat, contentIt->second}).first;
+		}
+		return mEntries[it->second.entryIndex];
+	}
+
+	IUnrealCallbacks* mCallbacks;
+	bool mEmitMaterialIds;
+	prtx::PRTUtils::AttributeMapBuilderPtr mAmb;
+	std::vector<Entry> mEntries;
+	std::unordered_map<const prtx::Material*, MaterialRef> mEntriesByMaterial;
+	std::unordered_map<std::wstring, size_t> mEntriesByContent;
+};
+
 template <typename F>
 void forEachKey(prt::Attributable const* a, F f)
 {
@@ -520,18 +683,131 @@ SerializedGeometry serializeGeometry(const prtx::GeometryPtrVector& geometries,
 	return sg;
 }
 
+SerializedRenderGeometry serializeRenderGeometry(const prtx::GeometryPtrVector& geometries, const std::vector<prtx::MaterialPtrVector>& materials,
+												  const prtx::DoubleVector& vertexOffset)
+{
+	// PASS 1: scan
+	uint32_t numVertices = 0;
+	uint32_t numIndices = 0;
+	uint32_t maxNumUVSets = 0;
+	auto matsIt = materials.cbegin();
+	std::vector<bool> isUVSetEmptyVector(10, true);
+	for (const auto& geo : geometries)
+	{
+		const prtx::MeshPtrVector& meshes = geo->getMeshes();
+		const prtx::MaterialPtrVector& mats = *matsIt;
+		auto matIt = mats.cbegin();
+		for (const auto& mesh : meshes)
+		{
+			numVertices += static_cast<uint32_t>(mesh->getVertexCoords().size() / 3);
+			numIndices += mesh->getFaceCount() * 3;
+
+			const prtx::MaterialPtr& mat = *matIt;
+			const uint32_t requiredUVSetsByMaterial = scanValidTextures(mat);
+			maxNumUVSets = std::max(maxNumUVSets, std::max(mesh->getUVSetsCount(), requiredUVSetsByMaterial));
+
+			for (uint32_t uvSet = 0; uvSet < mesh->getUVSetsCount(); uvSet++)
+			{
+				if (!mesh->getUVCoords(uvSet).empty())
+					isUVSetEmptyVector[uvSet] = false;
+			}
+			++matIt;
+		}
+		++matsIt;
+	}
+	SerializedRenderGeometry sg(numVertices, numIndices, maxNumUVSets);
+
+	const double offsetX = vertexOffset.size() == 3 ? vertexOffset[0] : 0.0;
+	const double offsetY = vertexOffset.size() == 3 ? vertexOffset[1] : 0.0;
+	const double offsetZ = vertexOffset.size() == 3 ? vertexOffset[2] : 0.0;
+
+	// PASS 2: convert, the offset is applied in double precision before narrowing to float
+	uint32_t vertexIndexBase = 0u;
+	for (const auto& geo : geometries)
+	{
+		const prtx::MeshPtrVector& meshes = geo->getMeshes();
+		for (const auto& mesh : meshes)
+		{
+			// swap y and z to convert from right-handed y-up to left-handed z-up
+			const prtx::DoubleVector& verts = mesh->getVertexCoords();
+			const uint32_t vertexCount = static_cast<uint32_t>(verts.size() / 3);
+			for (size_t vi = 0; vi < verts.size(); vi += 3)
+			{
+				sg.positions.push_back(static_cast<float>(verts[vi] * PRT_TO_UE_SCALE - offsetX));
+				sg.positions.push_back(static_cast<float>(verts[vi + 2] * PRT_TO_UE_SCALE - offsetY));
+				sg.positions.push_back(static_cast<float>(verts[vi + 1] * PRT_TO_UE_SCALE - offsetZ));
+			}
+
+			// normals share the vertex indices, zero normals are recomputed by the consumer
+			const prtx::DoubleVector& norms = mesh->getVertexNormalsCoords();
+			if (norms.size() == verts.size())
+			{
+				for (size_t ni = 0; ni < norms.size(); ni += 3)
+				{
+					sg.normals.push_back(static_cast<float>(norms[ni]));
+					sg.normals.push_back(static_cast<float>(norms[ni + 2]));
+					sg.normals.push_back(static_cast<float>(norms[ni + 1]));
+				}
+			}
+			else
+			{
+				sg.normals.insert(sg.normals.end(), verts.size(), 0.0f);
+			}
+
+			// same special cases as serializeGeometry: empty uv sets are left empty, missing uv sets are copied from uv set 0
+			const uint32_t numUVSets = mesh->getUVSetsCount();
+			const prtx::DoubleVector& uvs0 = (numUVSets > 0) ? mesh->getUVCoords(0) : EMPTY_UVS;
+			for (uint32_t uvSet = 0; uvSet < sg.uvs.size(); uvSet++)
+			{
+				if (isUVSetEmptyVector[uvSet])
+					continue;
+
+				const prtx::DoubleVector& uvs = (uvSet < numUVSets) ? mesh->getUVCoords(uvSet) : EMPTY_UVS;
+				const auto& src = uvs.empty() ? uvs0 : uvs;
+				auto& tgt = sg.uvs[uvSet];
+				if (src.size() == vertexCount * 2)
+				{
+					// flip v for Unreal
+					for (size_t ui = 0; ui < src.size(); ui += 2)
+					{
+						tgt.push_back(static_cast<float>(src[ui]));
+						tgt.push_back(static_cast<float>(-src[ui + 1]));
+					}
+				}
+				else
+				{
+					tgt.insert(tgt.end(), vertexCount * 2, 0.0f);
+				}
+			}
+
+			// all faces are triangles after preparation
+			for (uint32_t fi = 0, faceCount = mesh->getFaceCount(); fi < faceCount; ++fi)
+			{
+				assert(mesh->getFaceVertexCount(fi) == 3);
+				const uint32_t* vtxIdx = mesh->getFaceVertexIndices(fi);
+				for (uint32_t vi = 0; vi < 3; vi++)
+					sg.indices.push_back(vertexIndexBase + vtxIdx[vi]);
+			}
+			sg.faceRanges.push_back(mesh->getFaceCount());
+
+			vertexIndexBase += vertexCount;
+		} // for all meshes
+	}	  // for all geometries
+
+	return sg;
+}
+
 void encodeMesh(IUnrealCallbacks* cb, const SerializedGeometry& sg, wchar_t const* name, wchar_t const* meshId, int32_t prototypeIndex, const std::wstring& uri,
-				prtx::GeometryPtrVector geometries, std::vector<prtx::MaterialPtrVector> materials)
+				prtx::GeometryPtrVector geometries, std::vector<prtx::MaterialPtrVector> materials, MaterialInterner& materialInterner)
 {
 	auto puvs = toPtrVec(sg.uvs);
 	auto puvCounts = toPtrVec(sg.uvCounts);
 	auto puvIndices = toPtrVec(sg.uvIndices);
 
 	std::vector<uint32_t> faceRanges;
-	AttributeMapNOPtrVectorOwner matAttrMaps;
+	AttributeMapNOPtrVector matAttrMaps;
 
 	auto matIt = materials.cbegin();
-	prtx::PRTUtils::AttributeMapBuilderPtr amb(prt::AttributeMapBuilder::create());
 	for (const auto& geo : geometries)
 	{
 		const prtx::MeshPtrVector& meshes = geo->getMeshes();
@@ -541,8 +817,7 @@ void encodeMesh(IUnrealCallbacks* cb, const SerializedGeometry& sg, wchar_t cons
 			const prtx::MeshPtr& m = meshes.at(mi);
 			const prtx::MaterialPtr& mat = matIt->at(mi);
 
-			convertMaterialToAttributeMap(amb, *(mat.get()), mat->getKeys());
-			matAttrMaps.v.push_back(amb->createAttributeMapAndReset());
+			matAttrMaps.push_back(materialInterner.getAttributeMap(mat));
 			faceRanges.push_back(m->getFaceCount());
 		}
 
@@ -556,7 +831,174 @@ void encodeMesh(IUnrealCallbacks* cb, const SerializedGeometry& sg, wchar_t cons
 				puvs.first.data(), puvs.second.data(), puvCounts.first.data(), puvCounts.second.data(), puvIndices.first.data(),
 				puvIndices.second.data(), sg.uvs.size(),
 
-				faceRanges.data(), faceRanges.size(), matAttrMaps.v.empty() ? nullptr : matAttrMaps.v.data());
+				faceRanges.data(), faceRanges.size(), matAttrMaps.empty() ? nullptr : matAttrMaps.data());
+}
+
+void encodeRenderMesh(IUnrealCallbacks* cb, const SerializedRenderGeometry& sg, wchar_t const* name, wchar_t const* meshId, int32_t prototypeIndex,
+					  const std::wstring& uri, prtx::GeometryPtrVector geometries, std::vector<prtx::MaterialPtrVector> materials,
+					  MaterialInterner& materialInterner)
+{
+	// uv sets which are empty for all meshes are passed as nullptr
+	auto puvs = toPtrVec(sg.uvs);
+	for (size_t uvSet = 0; uvSet < sg.uvs.size(); uvSet++)
+	{
+		if (sg.uvs[uvSet].empty())
+			puvs.first[uvSet] = nullptr;
+	}
+
+	AttributeMapNOPtrVector matAttrMaps;
+
+	auto matIt = materials.cbegin();
+	for (const auto& geo : geometries)
+	{
+		const prtx::MeshPtrVector& meshes = geo->getMeshes();
+
+		for (size_t mi = 0; mi < meshes.size(); mi++)
+		{
+			const prtx::MaterialPtr& mat = matIt->at(mi);
+			matAttrMaps.push_back(materialInterner.getAttributeMap(mat));
+		}
+
+		++matIt;
+	}
+
+	cb->addRenderMesh(name, meshId, prototypeIndex, uri.c_str(), sg.positions.data(), sg.normals.data(), sg.positions.size() / 3, puvs.first.data(),
+					  sg.uvs.size(), sg.indices.data(), sg.indices.size(), sg.faceRanges.data(), sg.faceRanges.size(),
+					  matAttrMaps.empty() ? nullptr : matAttrMaps.data());
+}
+
+// streams the meshes one by one with views of the prtx buffers instead of concatenating them first (see IUnrealCallbacks::beginMesh)
+void streamMesh(IUnrealCallbacks* cb, wchar_t const* name, wchar_t const* meshId, int32_t prototypeIndex, const std::wstring& uri,
+				const prtx::GeometryPtrVector& geometries, const std::vector<prtx::MaterialPtrVector>& materials, MaterialInterner& materialInterner)
+{
+	// PASS 1: scan, same uv set handling as serializeGeometry
+	size_t numParts = 0;
+	uint32_t maxNumUVSets = 0;
+	std::vector<bool> isUVSetEmptyVector(10, true);
+	auto matsIt = materials.cbegin();
+	for (const auto& geo : geometries)
+	{
+		const prtx::MeshPtrVector& meshes = geo->getMeshes();
+		const prtx::MaterialPtrVector& mats = *matsIt;
+		auto matIt = mats.cbegin();
+		for (const auto& mesh : meshes)
+		{
+			numParts++;
+
+			const prtx::MaterialPtr& mat = *matIt;
+			const uint32_t requiredUVSetsByMaterial = scanValidTextures(mat);
+			maxNumUVSets = std::max(maxNumUVSets, std::max(mesh->getUVSetsCount(), requiredUVSetsByMaterial));
+
+			for (uint32_t uvSet = 0; uvSet < mesh->getUVSetsCount(); uvSet++)
+			{
+				if (!mesh->getUVCoords(uvSet).empty())
+					isUVSetEmptyVector[uvSet] = false;
+			}
+			++matIt;
+		}
+		++matsIt;
+	}
+
+	cb->beginMesh(name, meshId, prototypeIndex, uri.c_str(), numParts, maxNumUVSets);
+
+	// PASS 2: stream, only the per face indices have to be gathered and the scratch buffers are reused for all meshes
+	std::vector<uint32_t> vertexIndices;
+	std::vector<uint32_t> normalIndices;
+	std::vector<prtx::IndexVector> uvIndices(maxNumUVSets);
+	prtx::IndexVector zeroUVCounts;
+
+	std::vector<const double*> uvs(maxNumUVSets);
+	std::vector<size_t> uvsSizes(maxNumUVSets);
+	std::vector<const uint32_t*> uvCounts(maxNumUVSets);
+	std::vector<size_t> uvCountsSizes(maxNumUVSets);
+	std::vector<const uint32_t*> puvIndices(maxNumUVSets);
+	std::vector<size_t> uvIndicesSizes(maxNumUVSets);
+
+	matsIt = materials.cbegin();
+	for (const auto& geo : geometries)
+	{
+		const prtx::MeshPtrVector& meshes = geo->getMeshes();
+		for (size_t mi = 0; mi < meshes.size(); mi++)
+		{
+			const prtx::MeshPtr& mesh = meshes[mi];
+			const prtx::MaterialPtr& mat = matsIt->at(mi);
+			const uint32_t faceCount = mesh->getFaceCount();
+
+			vertexIndices.clear();
+			normalIndices.clear();
+			for (uint32_t fi = 0; fi < faceCount; ++fi)
+			{
+				const uint32_t vtxCnt = mesh->getFaceVertexCount(fi);
+				const uint32_t* vtxIdx = mesh->getFaceVertexIndices(fi);
+				const uint32_t* nrmIdx = mesh->getFaceVertexNormalIndices(fi);
+				const size_t nrmCnt = mesh->getFaceVertexNormalCount(fi);
+				vertexIndices.insert(vertexIndices.end(), vtxIdx, vtxIdx + vtxCnt);
+				if (nrmIdx != nullptr)
+					normalIndices.insert(normalIndices.end(), nrmIdx, nrmIdx + std::min<size_t>(nrmCnt, vtxCnt));
+			}
+
+			const uint32_t numUVSets = mesh->getUVSetsCount();
+			const prtx::DoubleVector& uvs0 = (numUVSets > 0) ? mesh->getUVCoords(0) : EMPTY_UVS;
+			if (numUVSets == 0)
+				zeroUVCounts.assign(faceCount, 0);
+			const prtx::IndexVector& faceUVCounts0 = (numUVSets > 0) ? mesh->getFaceUVCounts(0) : zeroUVCounts;
+
+			for (uint32_t uvSet = 0; uvSet < maxNumUVSets; uvSet++)
+			{
+				uvIndices[uvSet].clear();
+				if (isUVSetEmptyVector[uvSet])
+				{
+					uvs[uvSet] = nullptr;
+					uvsSizes[uvSet] = 0;
+					uvCounts[uvSet] = nullptr;
+					uvCountsSizes[uvSet] = 0;
+					puvIndices[uvSet] = nullptr;
+					uvIndicesSizes[uvSet] = 0;
+					continue;
+				}
+
+				const prtx::DoubleVector& meshUVs = (uvSet < numUVSets) ? mesh->getUVCoords(uvSet) : EMPTY_UVS;
+				const bool useUVSet0 = meshUVs.empty();
+				const prtx::DoubleVector& src = useUVSet0 ? uvs0 : meshUVs;
+				const prtx::IndexVector& faceUVCounts = useUVSet0 ? faceUVCounts0 : mesh->getFaceUVCounts(uvSet);
+				assert(faceUVCounts.size() == faceCount);
+
+				for (uint32_t fi = 0; fi < faceCount; ++fi)
+				{
+					const uint32_t faceUVCnt = faceUVCounts[fi];
+					if (faceUVCnt == 0)
+						continue;
+					const uint32_t* faceUVIdx = mesh->getFaceUVIndices(fi, useUVSet0 ? 0 : uvSet);
+					uvIndices[uvSet].insert(uvIndices[uvSet].end(), faceUVIdx, faceUVIdx + faceUVCnt);
+				}
+
+				uvs[uvSet] = src.data();
+				uvsSizes[uvSet] = src.size();
+				uvCounts[uvSet] = faceUVCounts.data();
+				uvCountsSizes[uvSet] = faceUVCounts.size();
+				puvIndices[uvSet] = uvIndices[uvSet].data();
+				uvIndicesSizes[uvSet] = uvIndices[uvSet].size();
+			}
+
+			const prt::AttributeMap* material = materialInterner.getAttributeMap(mat);
+
+			const prtx::DoubleVector& verts = mesh->getVertexCoords();
+			const prtx::DoubleVector& norms = mesh->getVertexNormalsCoords();
+			const prtx::IndexVector& faceVertexCounts = mesh->getFaceVertexCounts();
+
+			cb->addMeshPart(verts.data(), verts.size(), norms.data(), norms.size(), faceVertexCounts.data(), faceVertexCounts.size(),
+							vertexIndices.data(), vertexIndices.size(), normalIndices.data(), normalIndices.size(),
+
+							uvs.data(), uvsSizes.data(), uvCounts.data(), uvCountsSizes.data(), puvIndices.data(), uvIndicesSizes.data(),
+							maxNumUVSets,
+
+							material);
+		} // for all meshes
+
+		++matsIt;
+	} // for all geometries
+
+	cb->endMesh();
 }
 
 const prtx::PRTUtils::AttributeMapPtr convertReportToAttributeMap(const prtx::ReportsPtr& r) {
@@ -584,6 +1026,7 @@ void UnrealGeometryEncoder::init(prtx::GenerateContext&)
 	mNsMaterial = mNamePrep.newNamespace();
 	
 	mEncPrep = prtx::EncodePreparator::create(true, mNamePrep, mNsMesh, mNsMaterial);
+	mChunkShapeCount = 0;
 
 	auto* callbacks = dynamic_cast<IUnrealCallbacks*>(getCallbacks());
 	if (callbacks == nullptr)
@@ -615,13 +1058,36 @@ void UnrealGeometryEncoder::encode(prtx::GenerateContext& context, size_t initia
 			cb->addReport(reportMap.get());
 		}
 	}
+
+	// every initial shape is a chunk of its own if the callbacks keep the geometry of the initial shapes apart
+	if (getOptions()->getBool(EO_SPLIT_INITIAL_SHAPES))
+	{
+		cb->beginInitialShape(initialShapeIndex);
+		convertChunk(cb);
+		cb->endChunk();
+		return;
+	}
+
+	// full chunks are converted right away, so the callbacks can process them while PRT generates the next initial shapes
+	const int32_t streamChunkSize = getOptions()->getInt(EO_STREAM_CHUNK_SIZE);
+	if (streamChunkSize > 0 && ++mChunkShapeCount >= static_cast<size_t>(streamChunkSize))
+	{
+		convertChunk(cb);
+		cb->endChunk();
+	}
 }
 
 void UnrealGeometryEncoder::convertGeometry(const prtx::EncodePreparator::InstanceVector& instances, IUnrealCallbacks* cb)
 {
+	const bool emitRenderStreams = getOptions()->getBool(EO_EMIT_RENDER_STREAMS);
+	const bool streamMeshes = getOptions()->getBool(EO_STREAM_MESHES);
+	const bool emitMaterialIds = getOptions()->getBool(EO_EMIT_MATERIAL_IDS);
+
+	// instances of the same prototype mostly share their materials, so they are only converted once per encode
+	MaterialInterner materialInterner(cb, emitMaterialIds);
+
 	prtx::GeometryPtrVector geometries;
 	std::vector<prtx::MaterialPtrVector> materials;
-	prtx::PRTUtils::AttributeMapBuilderPtr instanceMatAmb(prt::AttributeMapBuilder::create());
 	for (const auto& inst : instances)
 	{
 		if (inst.getPrototypeIndex() != prtx::EncodePreparator::FinalizedInstance::NO_PROTOTYPE_INDEX)
@@ -629,29 +1095,53 @@ void UnrealGeometryEncoder::convertGeometry(const prtx::EncodePreparator::Instan
 			const prtx::MaterialPtrVector& instMaterials = inst.getMaterials();
 			const prtx::GeometryPtr& instGeom = inst.getGeometry();
 
-			AttributeMapNOPtrVectorOwner instMaterialsAttributeMap;
-
 			InstanceIdentifier identifier = createInstanceIdentifier(inst);
 			
 			if (serializedPrototypes.find(identifier.meshId) == serializedPrototypes.end())
 			{
 				const std::wstring uri = instGeom->getURI()->wstring();
-				const SerializedGeometry sg = serializeGeometry({instGeom}, {instMaterials});
-				encodeMesh(cb, sg, identifier.name.c_str(), identifier.meshId.c_str(), inst.getPrototypeIndex(), uri, {instGeom}, {instMaterials});
+				if (emitRenderStreams)
+				{
+					// prototypes are placed by their instance transformations and are not offset
+					const SerializedRenderGeometry sg = serializeRenderGeometry({instGeom}, {instMaterials}, {});
+					encodeRenderMesh(cb, sg, identifier.name.c_str(), identifier.meshId.c_str(), inst.getPrototypeIndex(), uri, {instGeom},
+									 {instMaterials}, materialInterner);
+				}
+				else if (streamMeshes)
+				{
+					streamMesh(cb, identifier.name.c_str(), identifier.meshId.c_str(), inst.getPrototypeIndex(), uri, {instGeom}, {instMaterials},
+							   materialInterner);
+				}
+				else
+				{
+					const SerializedGeometry sg = serializeGeometry({instGeom}, {instMaterials});
+					encodeMesh(cb, sg, identifier.name.c_str(), identifier.meshId.c_str(), inst.getPrototypeIndex(), uri, {instGeom}, {instMaterials},
+							   materialInterner);
+				}
 				serializedPrototypes.insert(identifier.meshId);
 			}
 
-			const prtx::MeshPtrVector& meshes = instGeom->getMeshes();
-			for (size_t mi = 0; mi < meshes.size(); mi++)
+			const size_t numMeshes = instGeom->getMeshes().size();
+			if (emitMaterialIds)
 			{
-				const prtx::MaterialPtr& mat = instMaterials[mi];
+				std::vector<int32_t> instMaterialIds;
+				instMaterialIds.reserve(numMeshes);
+				for (size_t mi = 0; mi < numMeshes; mi++)
+					instMaterialIds.push_back(materialInterner.getId(instMaterials[mi]));
 
-				convertMaterialToAttributeMap(instanceMatAmb, *(mat.get()), mat->getKeys());
-				instMaterialsAttributeMap.v.push_back(instanceMatAmb->createAttributeMapAndReset());
+				cb->addInstanceWithMaterialIds(inst.getPrototypeIndex(), identifier.meshId.c_str(), inst.getTransformation().data(),
+											   instMaterialIds.data(), instMaterialIds.size());
 			}
+			else
+			{
+				AttributeMapNOPtrVector instMaterialsAttributeMap;
+				instMaterialsAttributeMap.reserve(numMeshes);
+				for (size_t mi = 0; mi < numMeshes; mi++)
+					instMaterialsAttributeMap.push_back(materialInterner.getAttributeMap(instMaterials[mi]));
 
-			cb->addInstance(inst.getPrototypeIndex(), identifier.meshId.c_str(), inst.getTransformation().data(), instMaterialsAttributeMap.v.data(),
-							instMaterialsAttributeMap.v.size());
+				cb->addInstance(inst.getPrototypeIndex(), identifier.meshId.c_str(), inst.getTransformation().data(), instMaterialsAttributeMap.data(),
+								instMaterialsAttributeMap.size());
+			}
 		}
 		else
 		{
@@ -662,34 +1152,63 @@ void UnrealGeometryEncoder::convertGeometry(const prtx::EncodePreparator::Instan
 
 	if (geometries.size() > 0)
 	{
-		const SerializedGeometry sg = serializeGeometry(geometries, materials);
-		encodeMesh(cb, sg, L"", L"", prtx::EncodePreparator::FinalizedInstance::NO_PROTOTYPE_INDEX, L"", geometries, materials);
+		if (emitRenderStreams)
+		{
+			size_t offsetSize = 0;
+			const double* offset = getOptions()->getFloatArray(EO_VERTEX_OFFSET, &offsetSize);
+			const prtx::DoubleVector vertexOffset = (offset != nullptr) ? prtx::DoubleVector(offset, offset + offsetSize) : prtx::DoubleVector();
+
+			const SerializedRenderGeometry sg = serializeRenderGeometry(geometries, materials, vertexOffset);
+			encodeRenderMesh(cb, sg, L"", L"", prtx::EncodePreparator::FinalizedInstance::NO_PROTOTYPE_INDEX, L"", geometries, materials,
+							 materialInterner);
+		}
+		else if (streamMeshes)
+		{
+			streamMesh(cb, L"", L"", prtx::EncodePreparator::FinalizedInstance::NO_PROTOTYPE_INDEX, L"", geometries, materials, materialInterner);
+		}
+		else
+		{
+			const SerializedGeometry sg = serializeGeometry(geometries, materials);
+			encodeMesh(cb, sg, L"", L"", prtx::EncodePreparator::FinalizedInstance::NO_PROTOTYPE_INDEX, L"", geometries, materials, materialInterner);
+		}
 	}
 
 	if (DBG)
 		log_debug(L"UnrealGeometryEncoder::convertGeometry: end");
 }
 
-void UnrealGeometryEncoder::finish(prtx::GenerateContext& /*context*/)
+void UnrealGeometryEncoder::convertChunk(IUnrealCallbacks* cb)
 {
-	IUnrealCallbacks* cb = static_cast<IUnrealCallbacks*>(getCallbacks());
+	// render streams are triangulated here and share one index buffer for all vertex attributes so they can be copied into vertex buffers
+	const bool emitRenderStreams = getOptions()->getBool(EO_EMIT_RENDER_STREAMS);
 
 	const prtx::EncodePreparator::PreparationFlags PREP_FLAGS =
 		prtx::EncodePreparator::PreparationFlags()
 			.instancing(true)
 			.meshMerging(prtx::MeshMerging::ALL_OF_SAME_MATERIAL_AND_TYPE)
-			.triangulate(false)
+			.triangulate(emitRenderStreams)
 			.processHoles(prtx::HoleProcessor::TRIANGULATE_FACES_WITH_HOLES)
 			.mergeVertices(true)
 			.cleanupVertexNormals(true)
 			.cleanupUVs(true)
 			.processVertexNormals(prtx::VertexNormalProcessor::SET_MISSING_TO_FACE_NORMALS)
-			.indexSharing(prtx::EncodePreparator::PreparationFlags::INDICES_SEPARATE_FOR_ALL_VERTEX_ATTRIBUTES);
+			.indexSharing(emitRenderStreams ? prtx::EncodePreparator::PreparationFlags::INDICES_SAME_FOR_ALL_VERTEX_ATTRIBUTES
+										   : prtx::EncodePreparator::PreparationFlags::INDICES_SEPARATE_FOR_ALL_VERTEX_ATTRIBUTES);
 	
+	// fetching the finalized instances empties the preparator, so the next chunk starts from scratch
 	prtx::EncodePreparator::InstanceVector instances;
 	mEncPrep->fetchFinalizedInstances(instances, PREP_FLAGS);
+	mChunkShapeCount = 0;
 	
 	convertGeometry(instances, cb);
+}
+
+void UnrealGeometryEncoder::finish(prtx::GenerateContext& /*context*/)
+{
+	IUnrealCallbacks* cb = static_cast<IUnrealCallbacks*>(getCallbacks());
+
+	// without streamChunkSize all initial shapes form a single chunk, otherwise only the remaining ones are left
+	convertChunk(cb);
 	
 	cb->finish();
 }
@@ -706,6 +1225,13 @@ UnrealGeometryEncoderFactory* UnrealGeometryEncoderFactory::createInstance()
 	prtx::PRTUtils::AttributeMapBuilderPtr amb(prt::AttributeMapBuilder::create());
 	amb->setBool(EO_EMIT_ATTRIBUTES, true);
 	amb->setBool(EO_EMIT_MATERIALS, true);
+	amb->setBool(EO_EMIT_RENDER_STREAMS, false);
+	amb->setBool(EO_STREAM_MESHES, false);
+	amb->setBool(EO_EMIT_MATERIAL_IDS, false);
+	amb->setInt(EO_STREAM_CHUNK_SIZE, 0);
+	amb->setBool(EO_SPLIT_INITIAL_SHAPES, false);
+	const double vertexOffset[3] = {0.0, 0.0, 0.0};
+	amb->setFloatArray(EO_VERTEX_OFFSET, vertexOffset, 3);
 	encoderInfoBuilder.setDefaultOptions(amb->createAttributeMap());
 
 	return new UnrealGeometryEncoderFactory(encoderInfoBuilder.create());
@@ -55,11 +55,15 @@ public:
 
 private:
 	void convertGeometry(const prtx::EncodePreparator::InstanceVector& instances, IUnrealCallbacks* callbacks);
+	void convertChunk(IUnrealCallbacks* callbacks);
 
 	prtx::DefaultNamePreparator mNamePrep;
     prtx::EncodePreparatorPtr mEncPrep;
     prtx::NamePreparator::NamespacePtr mNsMesh;
     prtx::NamePreparator::NamespacePtr mNsMaterial;
+
+	// number of initial shapes added to mEncPrep since the last chunk was converted
+	size_t mChunkShapeCount = 0;
     	
 	std::set<std::wstring> serializedPrototypes;
 };
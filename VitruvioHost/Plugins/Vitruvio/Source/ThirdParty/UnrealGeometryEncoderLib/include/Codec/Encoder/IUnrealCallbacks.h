@@ -80,4 +80,126 @@ public:
 	virtual void init() = 0;
 	virtual void finish() = 0;
 	virtual void addReport(const prt::AttributeMap* reports) = 0;
+
+	/**
+	 * Alternative to @ref addMesh which is called instead if the "emitRenderStreams" encoder option is set. The mesh is triangulated
+	 * and all vertex attributes share one index buffer. Positions are already converted to Unreal coordinates (left-handed, z-up,
+	 * centimeters) and offset by the "vertexOffset" encoder option (except for prototypes), normals are converted to Unreal
+	 * coordinates and uvs are flipped, so the streams can be copied into vertex buffers as they are.
+	 *
+	 * @param name either the name of the inserted asset or the shape name
+	 * @param meshId unique identifier of this mesh
+	 * @param prototypeId the id of the prototype or -1 of not cached
+	 * @param uri the uri of the inserted asset or empty otherwise
+	 * @param positions interleaved xyz positions, 3 * vertexCount values
+	 * @param normals interleaved xyz normals, 3 * vertexCount values
+	 * @param vertexCount number of vertices
+	 * @param uvs array of interleaved uv arrays (2 * vertexCount values) per uv set or nullptr if the uv set is unused
+	 * @param uvSets number of uv sets
+	 * @param indices triangle list index array
+	 * @param indicesSize length of the index array
+	 * @param faceRanges number of triangles per material
+	 * @param faceRangesSize number of materials
+	 * @param materials contains faceRangesSize attribute maps
+	 */
+	// clang-format off
+	virtual void addRenderMesh(const wchar_t* name, const wchar_t* meshId,
+	                           int32_t prototypeId, const wchar_t* uri,
+	                           const float* positions, const float* normals, size_t vertexCount,
+	                           float const* const* uvs, size_t uvSets,
+	                           const uint32_t* indices, size_t indicesSize,
+	                           const uint32_t* faceRanges, size_t faceRangesSize,
+	                           const prt::AttributeMap** materials
+	) = 0;
+	// clang-format on
+
+	/**
+	 * Streaming alternative to @ref addMesh which is used instead if the "streamMeshes" encoder option is set. A mesh is passed as partCount
+	 * parts (one per material) between beginMesh and @ref endMesh, each with views of the encoder buffers instead of one concatenated copy.
+	 *
+	 * @param name either the name of the inserted asset or the shape name
+	 * @param meshId unique identifier of this mesh
+	 * @param prototypeId the id of the prototype or -1 of not cached
+	 * @param uri the uri of the inserted asset or empty otherwise
+	 * @param partCount number of @ref addMeshPart calls which follow
+	 * @param uvSets number of uv sets of every part
+	 */
+	virtual void beginMesh(const wchar_t* name, const wchar_t* meshId, int32_t prototypeId, const wchar_t* uri, size_t partCount, size_t uvSets) = 0;
+
+	/**
+	 * Adds the next part of the mesh started with @ref beginMesh. All indices are local to the part, so the consumer has to rebase them
+	 * by the number of vertices, normals and uvs of the previous parts. The buffers are only valid during the call.
+	 *
+	 * @param vtx vertex coordinate array
+	 * @param vtxSize of vertex coordinate array
+	 * @param nrm vertex normal array
+	 * @param nrmSize length of vertex normal array
+	 * @param faceVertexCounts vertex counts per face
+	 * @param faceVertexCountsSize number of faces (= size of faceCounts)
+	 * @param vertexIndices vertex attribute index array (grouped by counts)
+	 * @param vertexIndicesSize vertex attribute index array
+	 * @param uvs array of texture coordinate arrays (nullptr if the uv set is empty for the whole mesh)
+	 * @param uvsSizes lengths of uv arrays per uv set
+	 * @param material the material of this part
+	 */
+	// clang-format off
+	virtual void addMeshPart(const double* vtx, size_t vtxSize,
+	                         const double* nrm, size_t nrmSize,
+	                         const uint32_t* faceVertexCounts, size_t faceVertexCountsSize,
+	                         const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                         const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                         double const* const* uvs, size_t const* uvsSizes,
+	                         uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                         uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                         size_t uvSets,
+
+	                         const prt::AttributeMap* material
+	) = 0;
+	// clang-format on
+
+	/**
+	 * Completes the mesh started with @ref beginMesh.
+	 */
+	virtual void endMesh() = 0;
+
+	/**
+	 * Adds a material which is referenced by its id in @ref addInstanceWithMaterialIds, only called if the "emitMaterialIds" encoder option
+	 * is set. Every material is added once per generate (or chunk, see @ref endChunk), before its first reference. Materials with the same
+	 * attributes share one id.
+	 *
+	 * @param materialId unique id of the material
+	 * @param material the material attributes
+	 */
+	virtual void addMaterial(int32_t materialId, const prt::AttributeMap* material) = 0;
+
+	/**
+	 * Same as @ref addInstance, but the instance materials reference the materials passed to @ref addMaterial. Called instead of
+	 * addInstance if the "emitMaterialIds" encoder option is set.
+	 *
+	 * @param prototypeId the id of the prototype
+	 * @param meshId unique identifier of this mesh
+	 * @param transform the transformation matrix of this instance
+	 * @param materialIds ids of the instance materials
+	 * @param numMaterialIds number of instance materials, equal to the number of materials of the original mesh
+	 */
+	virtual void addInstanceWithMaterialIds(int32_t prototypeId, const wchar_t* meshId, const double* transform, const int32_t* materialIds,
+											size_t numMaterialIds) = 0;
+
+	/**
+	 * Called if the "streamChunkSize" encoder option is set, after the meshes, instances and materials of every streamChunkSize initial
+	 * shapes have been added. The following chunks are added while PRT keeps generating, the meshes without a prototype id of all chunks
+	 * together form the generated model. Material ids are only unique within a chunk. The remaining initial shapes are added before
+	 * @ref finish instead.
+	 */
+	virtual void endChunk() = 0;
+
+	/**
+	 * Called if the "splitInitialShapes" encoder option is set. Every initial shape then forms a chunk of its own (see @ref endChunk) and
+	 * beginInitialShape is called before any of its meshes, instances or materials are added, so the meshes without a prototype id can be
+	 * kept apart per initial shape.
+	 *
+	 * @param initialShapeIndex index of the initial shape in the generate call
+	 */
+	virtual void beginInitialShape(size_t initialShapeIndex) = 0;
 };
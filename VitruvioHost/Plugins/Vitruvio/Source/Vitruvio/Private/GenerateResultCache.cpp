@@ -0,0 +1,288 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GenerateResultCache.h"
+
+#include "RuleAttributes.h"
+#include "VitruvioModule.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Hash/xxhash.h"
+
+TAutoConsoleVariable<int32> CVarGenerateResultCacheBudget(TEXT("Esri.Vitruvio.GenerateResultCacheBudget"), 256,
+														  TEXT("The memory budget in MB for cached generate results. 0 disables the cache."));
+
+namespace
+{
+
+FAutoConsoleCommand GenerateResultCacheStatsCommand(TEXT("Esri.Vitruvio.GenerateResultCacheStats"), TEXT("Logs the generate result cache statistics."),
+													FConsoleCommandDelegate::CreateLambda([]() {
+														FGenerateResultCache& Cache = VitruvioModule::Get().GetGenerateResultCache();
+														Cache.UpdateSizes();
+														UE_LOG(LogUnrealPrt, Display, TEXT("Generate result cache: %d hits, %d misses, %d evictions, %llu KB"),
+															   Cache.GetNumHits(), Cache.GetNumMisses(), Cache.GetNumEvictions(),
+															   static_cast<uint64>(Cache.GetAllocatedSize() / 1024))
+													}));
+
+SIZE_T GetBudget()
+{
+	return static_cast<SIZE_T>(FMath::Max(CVarGenerateResultCacheBudget.GetValueOnAnyThread(), 0)) * 1024 * 1024;
+}
+
+template <typename T>
+void HashValue(FXxHash64Builder& Builder, const T& Value)
+{
+	Builder.Update(&Value, sizeof(T));
+}
+
+template <typename T>
+void HashArray(FXxHash64Builder& Builder, const TArray<T>& Array)
+{
+	HashValue(Builder, Array.Num());
+	Builder.Update(Array.GetData(), Array.Num() * sizeof(T));
+}
+
+void HashString(FXxHash64Builder& Builder, const FString& String)
+{
+	HashValue(Builder, String.Len());
+	Builder.Update(*String, String.Len() * sizeof(TCHAR));
+}
+
+void HashAttribute(FXxHash64Builder& Builder, const URuleAttribute* Attribute)
+{
+	HashString(Builder, Attribute->Name);
+
+	if (const UFloatAttribute* FloatAttribute = Cast<UFloatAttribute>(Attribute))
+	{
+		HashValue(Builder, FloatAttribute->Value);
+	}
+	else if (const UStringAttribute* StringAttribute = Cast<UStringAttribute>(Attribute))
+	{
+		HashString(Builder, StringAttribute->Value);
+	}
+	else if (const UBoolAttribute* BoolAttribute = Cast<UBoolAttribute>(Attribute))
+	{
+		HashValue(Builder, BoolAttribute->Value);
+	}
+	else if (const UStringArrayAttribute* StringArrayAttribute = Cast<UStringArrayAttribute>(Attribute))
+	{
+		HashValue(Builder, StringArrayAttribute->Values.Num());
+		for (const FString& Value : StringArrayAttribute->Values)
+		{
+			HashString(Builder, Value);
+		}
+	}
+	else if (const UBoolArrayAttribute* BoolArrayAttribute = Cast<UBoolArrayAttribute>(Attribute))
+	{
+		HashArray(Builder, BoolArrayAttribute->Values);
+	}
+	else if (const UFloatArrayAttribute* FloatArrayAttribute = Cast<UFloatArrayAttribute>(Attribute))
+	{
+		HashArray(Builder, FloatArrayAttribute->Values);
+	}
+}
+
+void HashInitialShape(FXxHash64Builder& Builder, const FInitialShape& InitialShape)
+{
+	// Key on the rpk content (including its assets) so that reimporting a changed rpk invalidates the cached results
+	HashString(Builder, InitialShape.RulePackage ? InitialShape.RulePackage->ContentHash : FString());
+
+	HashValue(Builder, InitialShape.Position);
+	HashValue(Builder, InitialShape.RandomSeed);
+	HashValue(Builder, InitialShape.bOccluderOnly);
+	HashValue(Builder, InitialShape.OutputCluster);
+
+	HashArray(Builder, InitialShape.Polygon.Vertices);
+	HashValue(Builder, InitialShape.Polygon.Faces.Num());
+	for (const FInitialShapeFace& Face : InitialShape.Polygon.Faces)
+	{
+		HashArray(Builder, Face.Indices);
+		HashValue(Builder, Face.Holes.Num());
+		for (const FInitialShapeHole& Hole : Face.Holes)
+		{
+			HashArray(Builder, Hole.Indices);
+		}
+	}
+	HashValue(Builder, InitialShape.Polygon.TextureCoordinateSets.Num());
+	for (const FTextureCoordinateSet& TextureCoordinateSet : InitialShape.Polygon.TextureCoordinateSets)
+	{
+		HashArray(Builder, TextureCoordinateSet.TextureCoordinates);
+	}
+
+	// Only user-set attributes are passed to PRT, sort them so that the key does not depend on the map order
+	TArray<const URuleAttribute*> UserSetAttributes;
+	for (const auto& [Key, Attribute] : InitialShape.Attributes)
+	{
+		if (Attribute.IsValid() && Attribute->bUserSet)
+		{
+			UserSetAttributes.Add(Attribute.Get());
+		}
+	}
+	UserSetAttributes.Sort([](const URuleAttribute& A, const URuleAttribute& B) { return A.Name < B.Name; });
+
+	HashValue(Builder, UserSetAttributes.Num());
+	for (const URuleAttribute* Attribute : UserSetAttributes)
+	{
+		HashAttribute(Builder, Attribute);
+	}
+}
+
+SIZE_T GetMeshSize(const TSharedPtr<FVitruvioMesh>& Mesh)
+{
+	// Cached results keep the static meshes alive as well, which account for most of the memory once they have been built
+	return Mesh ? Mesh->GetAllocatedSize() + Mesh->GetResourceSize() : 0;
+}
+
+SIZE_T GetResultSize(const FGenerateResultDescription& Result)
+{
+	SIZE_T Size = sizeof(FGenerateResultDescription);
+
+	Size += GetMeshSize(Result.GeneratedModel);
+
+	for (const TSharedPtr<FVitruvioMesh>& ClusterModel : Result.ClusterModels)
+	{
+		Size += GetMeshSize(ClusterModel);
+	}
+
+	for (const auto& [Key, InstanceMesh] : Result.InstanceMeshes)
+	{
+		Size += GetMeshSize(InstanceMesh);
+	}
+
+	for (const auto& [Key, Transforms] : Result.Instances)
+	{
+		Size += Transforms.GetAllocatedSize();
+	}
+
+	return Size;
+}
+
+} // namespace
+
+FGenerateResultCache::FKey FGenerateResultCache::ComputeKey(bool bBatchGenerate, const TArray<FInitialShape>& InitialShapes, bool bEnableOcclusionQueries,
+															const TArray<FInitialShape>& OccluderOnlyShapes)
+{
+	FXxHash64Builder Builder;
+
+	HashValue(Builder, bBatchGenerate);
+	HashValue(Builder, bEnableOcclusionQueries);
+
+	HashValue(Builder, InitialShapes.Num());
+	for (const FInitialShape& InitialShape : InitialShapes)
+	{
+		HashInitialShape(Builder, InitialShape);
+	}
+
+	HashValue(Builder, OccluderOnlyShapes.Num());
+	for (const FInitialShape& InitialShape : OccluderOnlyShapes)
+	{
+		HashInitialShape(Builder, InitialShape);
+	}
+
+	return Builder.Finalize().Hash;
+}
+
+TSharedPtr<const FGenerateResultDescription> FGenerateResultCache::Get(FKey Key)
+{
+	FScopeLock Lock(&GenerateResultCacheCriticalSection);
+
+	FEntry* Entry = Cache.Find(Key);
+	if (!Entry)
+	{
+		Misses.Increment();
+		return {};
+	}
+
+	Hits.Increment();
+	Entry->LastAccess = ++AccessCounter;
+	return Entry->Result;
+}
+
+void FGenerateResultCache::Add(FKey Key, const FGenerateResultDescription& Result)
+{
+	const SIZE_T Budget = GetBudget();
+	const SIZE_T Size = GetResultSize(Result);
+	if (Size > Budget)
+	{
+		return;
+	}
+
+	FScopeLock Lock(&GenerateResultCacheCriticalSection);
+
+	if (const FEntry* Existing = Cache.Find(Key))
+	{
+		TotalSize -= Existing->Size;
+	}
+
+	Cache.Add(Key, {MakeShared<const FGenerateResultDescription>(Result), Size, ++AccessCounter});
+	TotalSize += Size;
+
+	EvictToBudget(Budget);
+}
+
+void FGenerateResultCache::Empty()
+{
+	FScopeLock Lock(&GenerateResultCacheCriticalSection);
+	Cache.Empty();
+	TotalSize = 0;
+}
+
+void FGenerateResultCache::UpdateSizes()
+{
+	FScopeLock Lock(&GenerateResultCacheCriticalSection);
+
+	TotalSize = 0;
+	for (auto& [Key, Entry] : Cache)
+	{
+		Entry.Size = GetResultSize(*Entry.Result);
+		TotalSize += Entry.Size;
+	}
+}
+
+SIZE_T FGenerateResultCache::GetAllocatedSize() const
+{
+	FScopeLock Lock(&GenerateResultCacheCriticalSection);
+	return TotalSize;
+}
+
+void FGenerateResultCache::EvictToBudget(SIZE_T Budget)
+{
+	// The meshes of cached results shrink once their source data is released and grow by their static mesh resources once they are built
+	UpdateSizes();
+	if (TotalSize <= Budget)
+	{
+		return;
+	}
+
+	TArray<TPair<uint64, FKey>> EntriesByAccess;
+	EntriesByAccess.Reserve(Cache.Num());
+	for (const auto& [Key, Entry] : Cache)
+	{
+		EntriesByAccess.Add(MakeTuple(Entry.LastAccess, Key));
+	}
+	EntriesByAccess.Sort([](const TPair<uint64, FKey>& A, const TPair<uint64, FKey>& B) { return A.Key < B.Key; });
+
+	for (const auto& [LastAccess, Key] : EntriesByAccess)
+	{
+		if (TotalSize <= Budget)
+		{
+			break;
+		}
+
+		TotalSize -= Cache[Key].Size;
+		Cache.Remove(Key);
+		Evictions.Increment();
+	}
+}
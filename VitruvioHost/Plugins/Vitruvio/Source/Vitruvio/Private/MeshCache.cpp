@@ -1,42 +1,181 @@
-/* Copyright 2024 Esri
- *
- * Licensed under the Apache License Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- *     http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an "AS IS" BASIS,
- * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- */
-
-#include "MeshCache.h"
-
-TSharedPtr<FVitruvioMesh> FMeshCache::Get(const FString& Id)
-{
-	FScopeLock Lock(&MeshCacheCriticalSection);
-	const auto Result = Cache.Find(Id);
-
-	return Result ? *Result : TSharedPtr<FVitruvioMesh>{};
-}
-
-TSharedPtr<FVitruvioMesh> FMeshCache::InsertOrGet(const FString& Id, const TSharedPtr<FVitruvioMesh>& Mesh)
-{
-	FScopeLock Lock(&MeshCacheCriticalSection);
-	const auto Result = Cache.Find(Id);
-	if (Result)
-	{
-		return *Result;
-	}
-	Cache.Add(Id, Mesh);
-	return Mesh;
-}
-
-void FMeshCache::Empty()
-{
-	FScopeLock Lock(&MeshCacheCriticalSection);
-	Cache.Empty();
-}
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MeshCache.h"
+
+#include "VitruvioModule.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeExit.h"
+
+TAutoConsoleVariable<int32> CVarMeshCacheBudget(TEXT("Esri.Vitruvio.MeshCacheBudget"), 512,
+												TEXT("The memory budget in MB for cached prototype meshes. Meshes which are still in use are never evicted."));
+
+namespace
+{
+
+FAutoConsoleCommand MeshCacheStatsCommand(TEXT("Esri.Vitruvio.MeshCacheStats"), TEXT("Logs the prototype mesh cache statistics."),
+										  FConsoleCommandDelegate::CreateLambda([]() {
+											  FMeshCache& Cache = VitruvioModule::Get().GetMeshCache();
+											  Cache.UpdateSizes();
+											  UE_LOG(LogUnrealPrt, Display, TEXT("Mesh cache: %d hits, %d misses, %d evictions, %llu KB"), Cache.GetNumHits(),
+													 Cache.GetNumMisses(), Cache.GetNumEvictions(), static_cast<uint64>(Cache.GetAllocatedSize() / 1024))
+										  }));
+
+SIZE_T GetBudget()
+{
+	return static_cast<SIZE_T>(FMath::Max(CVarMeshCacheBudget.GetValueOnAnyThread(), 0)) * 1024 * 1024;
+}
+
+} // namespace
+
+FMeshCache::FShard& FMeshCache::GetShard(const FString& Id)
+{
+	return Shards[GetTypeHash(Id) % NumShards];
+}
+
+TSharedPtr<FVitruvioMesh> FMeshCache::Get(const FString& Id)
+{
+	FShard& Shard = GetShard(Id);
+	FReadScopeLock Lock(Shard.Lock);
+
+	FEntry* Entry = Shard.Entries.Find(Id);
+	if (!Entry)
+	{
+		Misses.Increment();
+		return {};
+	}
+
+	Hits.Increment();
+	FPlatformAtomics::AtomicStore(&Entry->LastAccess, AccessCounter.Increment());
+	return Entry->Mesh;
+}
+
+TSharedPtr<FVitruvioMesh> FMeshCache::InsertOrGet(const FString& Id, const TSharedPtr<FVitruvioMesh>& Mesh)
+{
+	{
+		FShard& Shard = GetShard(Id);
+		FWriteScopeLock Lock(Shard.Lock);
+
+		if (FEntry* Entry = Shard.Entries.Find(Id))
+		{
+			Entry->LastAccess = AccessCounter.Increment();
+			return Entry->Mesh;
+		}
+
+		const SIZE_T Size = Mesh ? Mesh->GetAllocatedSize() : 0;
+		Shard.Entries.Add(Id, {Mesh, Size, AccessCounter.Increment()});
+		TotalSize.Add(Size);
+	}
+
+	const SIZE_T Budget = GetBudget();
+	if (GetAllocatedSize() > Budget)
+	{
+		EvictToBudget(Budget);
+	}
+
+	return Mesh;
+}
+
+void FMeshCache::Empty()
+{
+	for (FShard& Shard : Shards)
+	{
+		FWriteScopeLock Lock(Shard.Lock);
+		for (const auto& [Id, Entry] : Shard.Entries)
+		{
+			TotalSize.Subtract(Entry.Size);
+		}
+		Shard.Entries.Empty();
+	}
+}
+
+void FMeshCache::UpdateSizes()
+{
+	for (FShard& Shard : Shards)
+	{
+		FWriteScopeLock Lock(Shard.Lock);
+		for (auto& [Id, Entry] : Shard.Entries)
+		{
+			const SIZE_T Size = Entry.Mesh ? Entry.Mesh->GetAllocatedSize() : 0;
+			TotalSize.Add(static_cast<int64>(Size) - static_cast<int64>(Entry.Size));
+			Entry.Size = Size;
+		}
+	}
+}
+
+void FMeshCache::EvictToBudget(SIZE_T Budget)
+{
+	if (!EvictionCriticalSection.TryLock())
+	{
+		return;
+	}
+	ON_SCOPE_EXIT
+	{
+		EvictionCriticalSection.Unlock();
+	};
+
+	// The sizes recorded on insertion are stale for meshes which have been built in the meantime
+	UpdateSizes();
+	if (GetAllocatedSize() <= Budget)
+	{
+		return;
+	}
+
+	// Only meshes which are not referenced outside of the cache (eg. by generate results or components) can be evicted
+	struct FCandidate
+	{
+		int64 LastAccess;
+		int32 ShardIndex;
+		FString Id;
+	};
+	TArray<FCandidate> Candidates;
+	for (int32 ShardIndex = 0; ShardIndex < NumShards; ++ShardIndex)
+	{
+		FReadScopeLock Lock(Shards[ShardIndex].Lock);
+		for (const auto& [Id, Entry] : Shards[ShardIndex].Entries)
+		{
+			if (!Entry.Mesh || Entry.Mesh.GetSharedReferenceCount() == 1)
+			{
+				Candidates.Add({FPlatformAtomics::AtomicRead(&Entry.LastAccess), ShardIndex, Id});
+			}
+		}
+	}
+	Candidates.Sort([](const FCandidate& A, const FCandidate& B) { return A.LastAccess < B.LastAccess; });
+
+	// Destroying a mesh unregisters its static mesh, keep them alive until the shard locks are released
+	TArray<TSharedPtr<FVitruvioMesh>> EvictedMeshes;
+	for (const FCandidate& Candidate : Candidates)
+	{
+		if (GetAllocatedSize() <= Budget)
+		{
+			break;
+		}
+
+		FWriteScopeLock Lock(Shards[Candidate.ShardIndex].Lock);
+		FEntry* Entry = Shards[Candidate.ShardIndex].Entries.Find(Candidate.Id);
+
+		// The mesh might have been looked up again in the meantime
+		if (!Entry || (Entry->Mesh && Entry->Mesh.GetSharedReferenceCount() > 1))
+		{
+			continue;
+		}
+
+		TotalSize.Subtract(Entry->Size);
+		EvictedMeshes.Add(MoveTemp(Entry->Mesh));
+		Shards[Candidate.ShardIndex].Entries.Remove(Candidate.Id);
+		Evictions.Increment();
+	}
+}
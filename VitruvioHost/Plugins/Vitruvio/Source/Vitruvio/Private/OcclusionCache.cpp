@@ -0,0 +1,148 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "OcclusionCache.h"
+
+FOcclusionCache::FScopedSnapshot::FScopedSnapshot(FOcclusionCache& Cache, const TArray<int64>& InitialShapeIndices) : Cache(Cache)
+{
+	FScopeLock Lock(&Cache.OcclusionCacheCriticalSection);
+
+	State = Cache.State;
+	Version = Cache.Version;
+	State->SnapshotVersions.Add(Version);
+
+	for (const int64 InitialShapeIndex : InitialShapeIndices)
+	{
+		if (Handles.Contains(InitialShapeIndex))
+		{
+			continue;
+		}
+
+		if (const prt::OcclusionSet::Handle* Handle = Cache.HandleCache.Find(InitialShapeIndex))
+		{
+			Handles.Add(InitialShapeIndex, *Handle);
+		}
+		else
+		{
+			MissingInitialShapeIndices.AddUnique(InitialShapeIndex);
+		}
+	}
+}
+
+FOcclusionCache::FScopedSnapshot::~FScopedSnapshot()
+{
+	FScopeLock Lock(&Cache.OcclusionCacheCriticalSection);
+
+	// New snapshots can only be taken while holding the cache lock, so no PRT call uses the set while the pending handles are disposed.
+	// Handles are disposed as soon as the snapshots which might use them are gone, even if other calls keep overlapping.
+	State->SnapshotVersions.RemoveSingle(Version);
+	DisposePending(*State);
+}
+
+void FOcclusionCache::FScopedSnapshot::AddOccluders(const TArray<int64>& InitialShapeIndices, const TArray<prt::OcclusionSet::Handle>& NewHandles)
+{
+	check(InitialShapeIndices.Num() == NewHandles.Num());
+
+	FScopeLock Lock(&Cache.OcclusionCacheCriticalSection);
+
+	const bool bIsCurrentSet = Cache.State == State;
+
+	for (int32 Index = 0; Index < InitialShapeIndices.Num(); ++Index)
+	{
+		const int64 InitialShapeIndex = InitialShapeIndices[Index];
+		const prt::OcclusionSet::Handle Handle = NewHandles[Index];
+
+		Handles.Add(InitialShapeIndex, Handle);
+
+		// The occluder was generated from shape data which may have changed in the meantime, only use it for this snapshot
+		const bool bInvalidated = !bIsCurrentSet || Cache.InvalidationVersions.FindRef(InitialShapeIndex) > Version;
+		if (bInvalidated || Cache.HandleCache.Contains(InitialShapeIndex))
+		{
+			State->PendingDisposal.Add({Version, Handle});
+		}
+		else
+		{
+			Cache.HandleCache.Add(InitialShapeIndex, Handle);
+		}
+	}
+}
+
+void FOcclusionCache::Invalidate(const TArray<int64>& InitialShapeIndices)
+{
+	FScopeLock Lock(&OcclusionCacheCriticalSection);
+
+	const uint64 PreviousVersion = Version++;
+
+	TArray<prt::OcclusionSet::Handle> InvalidHandles;
+	for (const int64 InitialShapeIndex : InitialShapeIndices)
+	{
+		InvalidationVersions.Add(InitialShapeIndex, Version);
+
+		prt::OcclusionSet::Handle Handle;
+		if (HandleCache.RemoveAndCopyValue(InitialShapeIndex, Handle))
+		{
+			InvalidHandles.Add(Handle);
+		}
+	}
+
+	if (State && !InvalidHandles.IsEmpty())
+	{
+		// Only snapshots taken before this invalidation can use the removed handles
+		DisposeOrDefer(*State, PreviousVersion, InvalidHandles);
+	}
+}
+
+void FOcclusionCache::Reset()
+{
+	TSharedPtr<FOcclusionSetState> NewState = MakeShared<FOcclusionSetState>();
+	NewState->OcclusionSet.reset(prt::OcclusionSet::create());
+
+	FScopeLock Lock(&OcclusionCacheCriticalSection);
+
+	++Version;
+	HandleCache.Empty();
+	InvalidationVersions.Empty();
+	State = MoveTemp(NewState);
+}
+
+void FOcclusionCache::DisposeOrDefer(FOcclusionSetState& SetState, uint64 Version, const TArray<prt::OcclusionSet::Handle>& InvalidHandles)
+{
+	for (const prt::OcclusionSet::Handle Handle : InvalidHandles)
+	{
+		SetState.PendingDisposal.Add({Version, Handle});
+	}
+
+	DisposePending(SetState);
+}
+
+void FOcclusionCache::DisposePending(FOcclusionSetState& SetState)
+{
+	TArray<prt::OcclusionSet::Handle> DisposableHandles;
+	SetState.PendingDisposal.RemoveAll([&SetState, &DisposableHandles](const FPendingHandle& PendingHandle) {
+		// Snapshot versions are ascending, the first one is the oldest live snapshot
+		if (!SetState.SnapshotVersions.IsEmpty() && SetState.SnapshotVersions[0] <= PendingHandle.Version)
+		{
+			return false;
+		}
+
+		DisposableHandles.Add(PendingHandle.Handle);
+		return true;
+	});
+
+	if (!DisposableHandles.IsEmpty())
+	{
+		SetState.OcclusionSet->dispose(DisposableHandles.GetData(), DisposableHandles.Num());
+	}
+}
@@ -0,0 +1,157 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PrtWorkerGovernor.h"
+
+#include "VitruvioModule.h"
+
+#include "HAL/Event.h"
+#include "HAL/IConsoleManager.h"
+
+TAutoConsoleVariable<int32> CVarPrtWorkerThreads(TEXT("Esri.Vitruvio.PrtWorkerThreads"), 0,
+												 TEXT("The number of PRT worker threads shared by all generate calls. 0 uses the number of cores."));
+
+TAutoConsoleVariable<int32> CVarMaxQueuedPrtCalls(TEXT("Esri.Vitruvio.MaxQueuedPrtCalls"), 4,
+												  TEXT("The number of background PRT calls which may wait for workers before new calls are deferred."));
+
+namespace
+{
+
+FAutoConsoleCommand PrtWorkerStatsCommand(TEXT("Esri.Vitruvio.PrtWorkerStats"), TEXT("Logs the PRT worker governor statistics."),
+										  FConsoleCommandDelegate::CreateLambda([]() {
+											  const FPrtWorkerGovernor& Governor = VitruvioModule::Get().GetPrtWorkerGovernor();
+											  UE_LOG(LogUnrealPrt, Display,
+													 TEXT("PRT workers: %d/%d busy, %d calls (%d waiting), %d contended acquires, %d deferred calls"),
+													 Governor.GetNumBusyWorkers(), Governor.GetWorkerBudget(), Governor.GetNumCalls(),
+													 Governor.GetNumWaitingCalls(), Governor.GetNumContendedAcquires(), Governor.GetNumRejectedCalls())
+										  }));
+
+} // namespace
+
+int32 FPrtWorkerGovernor::Acquire(int32 DesiredWorkers, EPrtCallPriority Priority)
+{
+	DesiredWorkers = FMath::Max(DesiredWorkers, 1);
+
+	FWaiter Waiter{nullptr, Priority, DesiredWorkers, 0};
+	{
+		FScopeLock Lock(&GovernorCriticalSection);
+
+		if (Waiters.IsEmpty())
+		{
+			const int32 Grant = GetGrant(DesiredWorkers);
+			if (Grant > 0)
+			{
+				BusyWorkers += Grant;
+				return Grant;
+			}
+		}
+
+		// Queue behind all waiters of the same or a higher priority
+		int32 InsertIndex = Waiters.IndexOfByPredicate([Priority](const FWaiter* Other) { return Other->Priority > Priority; });
+		if (InsertIndex == INDEX_NONE)
+		{
+			InsertIndex = Waiters.Num();
+		}
+
+		Waiter.Event = FPlatformProcess::GetSynchEventFromPool();
+		Waiters.Insert(&Waiter, InsertIndex);
+		NumContendedAcquires.Increment();
+	}
+
+	// The workers are assigned by Release before the event is triggered
+	Waiter.Event->Wait();
+	FPlatformProcess::ReturnSynchEventToPool(Waiter.Event);
+
+	return Waiter.GrantedWorkers;
+}
+
+void FPrtWorkerGovernor::Release(int32 NumWorkers)
+{
+	FScopeLock Lock(&GovernorCriticalSection);
+
+	BusyWorkers -= NumWorkers;
+
+	while (!Waiters.IsEmpty())
+	{
+		FWaiter* NextWaiter = Waiters[0];
+		const int32 Grant = GetGrant(NextWaiter->DesiredWorkers);
+		if (Grant == 0)
+		{
+			break;
+		}
+
+		Waiters.RemoveAt(0);
+		BusyWorkers += Grant;
+		NextWaiter->GrantedWorkers = Grant;
+		NextWaiter->Event->Trigger();
+	}
+}
+
+void FPrtWorkerGovernor::BeginCall()
+{
+	NumCalls.Increment();
+}
+
+void FPrtWorkerGovernor::EndCall()
+{
+	NumCalls.Decrement();
+}
+
+bool FPrtWorkerGovernor::CanAdmit() const
+{
+	return NumCalls.GetValue() < GetWorkerBudget() + GetMaxQueuedCalls();
+}
+
+void FPrtWorkerGovernor::AddDeferredCall()
+{
+	NumRejectedCalls.Increment();
+}
+
+int32 FPrtWorkerGovernor::GetWorkerBudget() const
+{
+	const int32 Budget = CVarPrtWorkerThreads.GetValueOnAnyThread();
+	return Budget > 0 ? Budget : FMath::Max(FPlatformMisc::NumberOfCores(), 1);
+}
+
+int32 FPrtWorkerGovernor::GetMaxQueuedCalls() const
+{
+	return FMath::Max(CVarMaxQueuedPrtCalls.GetValueOnAnyThread(), 0);
+}
+
+int32 FPrtWorkerGovernor::GetNumBusyWorkers() const
+{
+	FScopeLock Lock(&GovernorCriticalSection);
+	return BusyWorkers;
+}
+
+int32 FPrtWorkerGovernor::GetNumWaitingCalls() const
+{
+	FScopeLock Lock(&GovernorCriticalSection);
+	return Waiters.Num();
+}
+
+int32 FPrtWorkerGovernor::GetGrant(int32 DesiredWorkers) const
+{
+	const int32 Budget = GetWorkerBudget();
+	const int32 AvailableWorkers = Budget - BusyWorkers;
+	if (AvailableWorkers <= 0)
+	{
+		return 0;
+	}
+
+	// Split the budget fairly between all scheduled calls so that a single large call does not starve the others
+	const int32 FairShare = FMath::Max(Budget / FMath::Max(NumCalls.GetValue(), 1), 1);
+	return FMath::Min3(DesiredWorkers, AvailableWorkers, FairShare);
+}
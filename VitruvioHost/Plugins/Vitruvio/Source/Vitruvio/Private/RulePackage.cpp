@@ -0,0 +1,106 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RulePackage.h"
+
+#include "Hash/xxhash.h"
+#include "Serialization/CustomVersion.h"
+
+namespace
+{
+struct FRulePackageCustomVersion
+{
+	enum Type
+	{
+		// Rpk data serialized inline as a byte array
+		BeforeCustomVersionWasAdded = 0,
+		// Rpk data serialized as lazily loaded bulk data
+		BulkData,
+
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	static const FGuid GUID;
+};
+
+const FGuid FRulePackageCustomVersion::GUID(0x6F1B2A4C, 0x3E8D4F71, 0x9A52C0D7, 0x1B84E6A3);
+FCustomVersionRegistration GRegisterRulePackageCustomVersion(FRulePackageCustomVersion::GUID, FRulePackageCustomVersion::LatestVersion,
+															 TEXT("VitruvioRulePackageVer"));
+
+void SetBulkData(FByteBulkData& BulkData, const TArray<uint8>& InData)
+{
+	BulkData.Lock(LOCK_READ_WRITE);
+	void* Dest = BulkData.Realloc(InData.Num());
+	FMemory::Memcpy(Dest, InData.GetData(), InData.Num());
+	BulkData.Unlock();
+
+	// Store the payload outside of the export so that loading the asset does not read it
+	BulkData.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload);
+}
+} // namespace
+
+void URulePackage::SetData(TArray<uint8>&& InData)
+{
+	FScopeLock Lock(&DataLock);
+	SetBulkData(Data, InData);
+	ContentHash = ComputeContentHash(InData);
+}
+
+TArray<uint8> URulePackage::LoadData()
+{
+	FScopeLock Lock(&DataLock);
+
+	TArray<uint8> Result;
+	Result.SetNumUninitialized(Data.GetBulkDataSize());
+
+	// Discards the loaded payload after copying if it can be reloaded from the package later on
+	void* Dest = Result.GetData();
+	Data.GetCopy(&Dest, true);
+	return Result;
+}
+
+FString URulePackage::ComputeContentHash(const TArray<uint8>& InData)
+{
+	const FXxHash128 Hash = FXxHash128::HashBuffer(InData.GetData(), InData.Num());
+	return FString::Printf(TEXT("%016llx%016llx"), Hash.HighBytes, Hash.LowBytes);
+}
+
+void URulePackage::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	Ar.UsingCustomVersion(FRulePackageCustomVersion::GUID);
+
+	if (Ar.IsLoading() && Ar.CustomVer(FRulePackageCustomVersion::GUID) < FRulePackageCustomVersion::BulkData)
+	{
+		// Rule packages saved before the bulk data format store the rpk inline as a byte array. The data stays resident until the asset
+		// is resaved in the new format.
+		TArray<uint8> LegacyData;
+		int32 NewArrayNum = 0;
+		Ar << NewArrayNum;
+		LegacyData.SetNumUninitialized(NewArrayNum);
+		Ar.Serialize(LegacyData.GetData(), NewArrayNum);
+
+		SetBulkData(Data, LegacyData);
+		if (ContentHash.IsEmpty())
+		{
+			ContentHash = ComputeContentHash(LegacyData);
+		}
+		return;
+	}
+
+	Data.Serialize(Ar, this);
+}
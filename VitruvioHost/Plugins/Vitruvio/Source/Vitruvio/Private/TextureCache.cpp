@@ -0,0 +1,245 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TextureCache.h"
+
+#include "VitruvioModule.h"
+
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+#include "Runtime/Engine/Public/TextureResource.h"
+
+#if WITH_EDITOR
+#include "DirectoryWatcherModule.h"
+#include "IDirectoryWatcher.h"
+#endif
+
+TAutoConsoleVariable<int32> CVarTextureCacheBudget(TEXT("Esri.Vitruvio.TextureCacheBudget"), 256,
+												   TEXT("The memory budget in MB for cached textures, counting both their CPU and GPU memory."));
+
+namespace
+{
+
+FAutoConsoleCommand TextureCacheStatsCommand(TEXT("Esri.Vitruvio.TextureCacheStats"), TEXT("Logs the texture cache statistics."),
+											 FConsoleCommandDelegate::CreateLambda([]() {
+												 FTextureCache& Cache = VitruvioModule::Get().GetTextureCache();
+												 UE_LOG(LogUnrealPrt, Display,
+														TEXT("Texture cache: %d hits, %d misses, %d evictions, %d invalidations, %llu KB CPU, %llu KB GPU"),
+														Cache.GetNumHits(), Cache.GetNumMisses(), Cache.GetNumEvictions(), Cache.GetNumInvalidations(),
+														static_cast<uint64>(Cache.GetCpuSize() / 1024), static_cast<uint64>(Cache.GetGpuSize() / 1024))
+											 }));
+
+SIZE_T GetBudget()
+{
+	return static_cast<SIZE_T>(FMath::Max(CVarTextureCacheBudget.GetValueOnAnyThread(), 0)) * 1024 * 1024;
+}
+
+FString GetCacheKey(const FString& Path)
+{
+	FString Key = Path;
+	FPaths::NormalizeFilename(Key);
+	return Key;
+}
+
+SIZE_T GetCpuSize(const UTexture2D* Texture)
+{
+	const FTexturePlatformData* PlatformData = Texture ? Texture->GetPlatformData() : nullptr;
+	if (!PlatformData)
+	{
+		return 0;
+	}
+
+	SIZE_T Size = 0;
+	for (const FTexture2DMipMap& Mip : PlatformData->Mips)
+	{
+		Size += Mip.BulkData.GetBulkDataSize();
+	}
+	return Size;
+}
+
+SIZE_T GetGpuSize(const UTexture2D* Texture)
+{
+	return Texture ? static_cast<SIZE_T>(Texture->CalcTextureMemorySizeEnum(TMC_AllMips)) : 0;
+}
+
+} // namespace
+
+bool FTextureCache::Find(const FString& Path, Vitruvio::FTextureData& OutTextureData)
+{
+	FScopeLock Lock(&CacheCriticalSection);
+
+	FEntry* Entry = Entries.Find(GetCacheKey(Path));
+	if (!Entry)
+	{
+		Misses.Increment();
+		return false;
+	}
+
+	Hits.Increment();
+	Entry->LastAccess = ++AccessCounter;
+	OutTextureData = Entry->TextureData;
+	return true;
+}
+
+void FTextureCache::Add(const FString& Path, const Vitruvio::FTextureData& TextureData)
+{
+	FEntry NewEntry{TextureData, GetCpuSize(TextureData.Texture), GetGpuSize(TextureData.Texture)};
+
+	FScopeLock Lock(&CacheCriticalSection);
+
+	NewEntry.LastAccess = ++AccessCounter;
+	CpuSize += NewEntry.CpuSize;
+	GpuSize += NewEntry.GpuSize;
+
+	if (const FEntry* Previous = Entries.Find(GetCacheKey(Path)))
+	{
+		CpuSize -= Previous->CpuSize;
+		GpuSize -= Previous->GpuSize;
+	}
+	Entries.Add(GetCacheKey(Path), MoveTemp(NewEntry));
+
+	const SIZE_T Budget = GetBudget();
+	if (CpuSize + GpuSize > Budget)
+	{
+		EvictToBudget(Budget);
+	}
+}
+
+void FTextureCache::Empty()
+{
+	FScopeLock Lock(&CacheCriticalSection);
+
+	Entries.Empty();
+	CpuSize = 0;
+	GpuSize = 0;
+}
+
+SIZE_T FTextureCache::GetCpuSize() const
+{
+	FScopeLock Lock(&CacheCriticalSection);
+	return CpuSize;
+}
+
+SIZE_T FTextureCache::GetGpuSize() const
+{
+	FScopeLock Lock(&CacheCriticalSection);
+	return GpuSize;
+}
+
+void FTextureCache::EvictToBudget(SIZE_T Budget)
+{
+	TArray<TPair<int64, FString>> Candidates;
+	Candidates.Reserve(Entries.Num());
+	for (const auto& [Key, Entry] : Entries)
+	{
+		Candidates.Emplace(Entry.LastAccess, Key);
+	}
+	Candidates.Sort([](const TPair<int64, FString>& A, const TPair<int64, FString>& B) { return A.Key < B.Key; });
+
+	// Always keep the most recently used texture, it has just been loaded for a material which is about to be created
+	for (int32 CandidateIndex = 0; CandidateIndex < Candidates.Num() - 1 && CpuSize + GpuSize > Budget; ++CandidateIndex)
+	{
+		const FEntry& Entry = Entries[Candidates[CandidateIndex].Value];
+		CpuSize -= Entry.CpuSize;
+		GpuSize -= Entry.GpuSize;
+		Entries.Remove(Candidates[CandidateIndex].Value);
+		Evictions.Increment();
+	}
+}
+
+void FTextureCache::WatchTextureDirectory(const FString& Path)
+{
+	check(IsInGameThread());
+
+#if WITH_EDITOR
+	const FString Directory = FPaths::GetPath(GetCacheKey(Path));
+	if (Directory.IsEmpty())
+	{
+		return;
+	}
+
+	// Directories are watched including their subtree
+	for (const auto& [WatchedDirectory, Handle] : WatchedDirectories)
+	{
+		if (FPaths::IsUnderDirectory(Directory, WatchedDirectory))
+		{
+			return;
+		}
+	}
+
+	FDirectoryWatcherModule& DirectoryWatcherModule = FModuleManager::LoadModuleChecked<FDirectoryWatcherModule>(TEXT("DirectoryWatcher"));
+	IDirectoryWatcher* DirectoryWatcher = DirectoryWatcherModule.Get();
+	if (!DirectoryWatcher)
+	{
+		return;
+	}
+
+	// Failed registrations (eg. for directories which do not exist) are remembered as well to not retry them on every lookup
+	FDelegateHandle Handle;
+	DirectoryWatcher->RegisterDirectoryChangedCallback_Handle(
+		Directory, IDirectoryWatcher::FDirectoryChanged::CreateRaw(this, &FTextureCache::OnDirectoryChanged), Handle);
+	WatchedDirectories.Add(Directory, Handle);
+#endif
+}
+
+void FTextureCache::UnwatchDirectories()
+{
+#if WITH_EDITOR
+	if (FDirectoryWatcherModule* DirectoryWatcherModule = FModuleManager::GetModulePtr<FDirectoryWatcherModule>(TEXT("DirectoryWatcher")))
+	{
+		if (IDirectoryWatcher* DirectoryWatcher = DirectoryWatcherModule->Get())
+		{
+			for (const auto& [Directory, Handle] : WatchedDirectories)
+			{
+				if (Handle.IsValid())
+				{
+					DirectoryWatcher->UnregisterDirectoryChangedCallback_Handle(Directory, Handle);
+				}
+			}
+		}
+	}
+#endif
+	WatchedDirectories.Empty();
+}
+
+void FTextureCache::OnDirectoryChanged(const TArray<FFileChangeData>& FileChanges)
+{
+#if WITH_EDITOR
+	FScopeLock Lock(&CacheCriticalSection);
+
+	for (const FFileChangeData& FileChange : FileChanges)
+	{
+		const FString Key = GetCacheKey(FileChange.Filename);
+		if (const FEntry* Entry = Entries.Find(Key))
+		{
+			CpuSize -= Entry->CpuSize;
+			GpuSize -= Entry->GpuSize;
+			Entries.Remove(Key);
+			Invalidations.Increment();
+		}
+	}
+#endif
+}
+
+void FTextureCache::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	FScopeLock Lock(&CacheCriticalSection);
+
+	for (auto& [Key, Entry] : Entries)
+	{
+		Collector.AddReferencedObject(Entry.TextureData.Texture);
+	}
+}
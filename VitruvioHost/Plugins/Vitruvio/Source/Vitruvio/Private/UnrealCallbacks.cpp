@@ -19,18 +19,30 @@
 
 #include "Util/MaterialConversion.h"
 
+#include "Async/ParallelFor.h"
+#include "CompGeom/PolygonTriangulation.h"
 #include "Engine/StaticMesh.h"
+#include "HAL/IConsoleManager.h"
 #include "IImageWrapper.h"
 #include "Materials/MaterialInstanceDynamic.h"
 #include "StaticMeshAttributes.h"
 #include "StaticMeshDescription.h"
 #include "StaticMeshOperations.h"
 #include "Util/AsyncHelpers.h"
+#include "Util/MeshConversion.h"
 #include "VitruvioModule.h"
+#include "VitruvioTrace.h"
 #include "prtx/Mesh.h"
 
 DEFINE_LOG_CATEGORY(LogUnrealCallbacks);
 
+TAutoConsoleVariable<bool> CVarDirectMeshConversion(TEXT("Esri.Vitruvio.DirectMeshConversion"), false,
+													TEXT("Converts generated meshes directly into static mesh render data instead of building a "
+														 "FMeshDescription first. Meshes converted this way have no source geometry and can not be cooked."));
+TAutoConsoleVariable<int32> CVarGenerateChunkSize(TEXT("Esri.Vitruvio.GenerateChunkSize"), 16,
+												  TEXT("Number of initial shapes after which the encoder passes the generated geometry on while PRT keeps "
+													   "generating the remaining ones. 0 converts all initial shapes at the end of a generate call."));
+
 namespace
 {
 
@@ -55,15 +67,6 @@ constexpr float PRT_TO_UE_SCALE = 100.0f;
 constexpr float PRT_DIVISOR_LIMIT = 1e-25f;
 
 // clang-format off
-const TMap<Vitruvio::EPrtUvSetType, Vitruvio::EUnrealUvSetType> PRTToUnrealUVSetMap = {
-	{Vitruvio::EPrtUvSetType::ColorMap,     Vitruvio::EUnrealUvSetType::ColorMap},
-	{Vitruvio::EPrtUvSetType::OpacityMap,   Vitruvio::EUnrealUvSetType::OpacityMap},
-	{Vitruvio::EPrtUvSetType::NormalMap,    Vitruvio::EUnrealUvSetType::NormalMap},
-	{Vitruvio::EPrtUvSetType::EmissiveMap,  Vitruvio::EUnrealUvSetType::EmissiveMap},
-	{Vitruvio::EPrtUvSetType::RoughnessMap, Vitruvio::EUnrealUvSetType::RoughnessMap},
-	{Vitruvio::EPrtUvSetType::MetallicMap,  Vitruvio::EUnrealUvSetType::MetallicMap},
-	{Vitruvio::EPrtUvSetType::DirtMap,      Vitruvio::EUnrealUvSetType::DirtMap}};
-
 const TMap<Vitruvio::EUnrealUvSetType, FString> UnrealUVSetToMaterialParamStringMap = {
 	{Vitruvio::EUnrealUvSetType::DirtMap,      TEXT("HasDirtMapUV")},
 	{Vitruvio::EUnrealUvSetType::OpacityMap,   TEXT("HasOpacityMapUV")},
@@ -74,147 +77,730 @@ const TMap<Vitruvio::EUnrealUvSetType, FString> UnrealUVSetToMaterialParamString
 };
 // clang-format on
 
-TMap<FString, double> CreateAvailableUVSetMaterialParameterMap(uint32_t const* const* UVCounts, size_t UVSets)
+// A uv set is available if its PRT buffer is not null, UVSetData are either the uv counts or the uvs of a mesh
+template <typename T>
+TMap<FString, double> CreateAvailableUVSetMaterialParameterMap(T const* const* UVSetData, size_t UVSets)
 {
 	TMap<FString, double> AvailableUvSetAttributeMap;
 
 	// Check which uv sets are available and set the corresponding information in the MaterialContainer
 	for (size_t PrtUvSet = 0; PrtUvSet < UVSets; ++PrtUvSet)
 	{
-		const Vitruvio::EUnrealUvSetType* UnrealUVSetPtr = PRTToUnrealUVSetMap.Find(static_cast<Vitruvio::EPrtUvSetType>(PrtUvSet));
-		bool bIsValidUnrealUVSet = (UnrealUVSetPtr != nullptr);
+		const Vitruvio::EUnrealUvSetType UnrealUVSet = Vitruvio::GetUnrealUVSet(PrtUvSet);
+		bool bHasUVSet = UVSetData[PrtUvSet] != nullptr;
 
-		if (bIsValidUnrealUVSet)
+		if (UnrealUVSet != Vitruvio::EUnrealUvSetType::ColorMap && UnrealUVSet != Vitruvio::EUnrealUvSetType::None)
 		{
-			bool bHasUVSet = UVCounts[PrtUvSet] != nullptr;
+			const FString UVSetMaterialParamString(UnrealUVSetToMaterialParamStringMap.FindRef(UnrealUVSet));
 
-			const Vitruvio::EUnrealUvSetType UnrealUVSet = *UnrealUVSetPtr;
-			if (UnrealUVSet != Vitruvio::EUnrealUvSetType::ColorMap && UnrealUVSet != Vitruvio::EUnrealUvSetType::None)
+			if (bHasUVSet)
 			{
-				const FString UVSetMaterialParamString(UnrealUVSetToMaterialParamStringMap.FindRef(UnrealUVSet));
-
-				if (bHasUVSet)
-				{
-					AvailableUvSetAttributeMap.Add(UVSetMaterialParamString, 1.0);
-				}
+				AvailableUvSetAttributeMap.Add(UVSetMaterialParamString, 1.0);
 			}
 		}
 	}
 	return AvailableUvSetAttributeMap;
 }
 
-FModelDescription ConvertMesh(const double* vtx, size_t vtxSize, const double* nrm, size_t nrmSize, const uint32_t* faceVertexCounts, size_t faceVertexCountsSize, const uint32_t* vertexIndices, size_t vertexIndicesSize, const uint32_t* normalIndices, size_t normalIndicesSize,
-	double const* const* uvs, uint32_t const* const* uvCounts, uint32_t const* const* uvIndices, size_t uvSets, const uint32_t* faceRanges, size_t faceRangesSize, const prt::AttributeMap** materials, const FVector3f& VertexOffset = FVector3f::ZeroVector)
+// Number of Unreal uv channels needed to store the available uv sets, at least the color map channel which the tangents are computed from
+template <typename T>
+int32 GetNumUnrealUVChannels(T const* const* UVSetData, size_t UVSets)
 {
-	FModelDescription ModelDescription;
-    FStaticMeshAttributes Attributes(ModelDescription.MeshDescription);
-    Attributes.Register();
+	int32 NumUVChannels = 1;
+	for (size_t PrtUvSet = 0; PrtUvSet < UVSets; ++PrtUvSet)
+	{
+		const Vitruvio::EUnrealUvSetType UnrealUVSet = Vitruvio::GetUnrealUVSet(PrtUvSet);
+		if (UnrealUVSet != Vitruvio::EUnrealUvSetType::None && UVSetData[PrtUvSet] != nullptr)
+		{
+			NumUVChannels = FMath::Max(NumUVChannels, static_cast<int32>(UnrealUVSet) + 1);
+		}
+	}
+	return NumUVChannels;
+}
 
-    const auto VertexUVs = Attributes.GetVertexInstanceUVs();
-    VertexUVs.SetNumChannels(8);
-    		
-	// Convert vertices and vertex instances
-	const auto VertexPositions = Attributes.GetVertexPositions();
-	for (size_t VertexIndex = 0; VertexIndex < vtxSize; VertexIndex += 3)
+// Normals and uvs of a mesh converted up front, so the per corner loops only have to gather them by their PRT indices
+struct FConvertedVertexAttributes
+{
+	TArray<FVector3f> Normals;
+
+	// Indexed by the PRT uv set, empty for uv sets which are not used in Unreal
+	TArray<TArray<FVector2f>> UVs;
+	TArray<int32> UnrealUVChannels;
+};
+
+FConvertedVertexAttributes ConvertVertexAttributes(const double* nrm, size_t nrmSize, double const* const* uvs, size_t const* uvsSizes, size_t uvSets)
+{
+	FConvertedVertexAttributes Attributes;
+
+	Attributes.Normals.SetNumUninitialized(nrmSize / 3);
+	Vitruvio::ConvertNormals(nrm, Attributes.Normals.Num(), Attributes.Normals.GetData());
+
+	Attributes.UVs.SetNum(uvSets);
+	Attributes.UnrealUVChannels.SetNumUninitialized(uvSets);
+	for (size_t PrtUVSet = 0; PrtUVSet < uvSets; ++PrtUVSet)
 	{
-		const FVertexID VertexID = ModelDescription.MeshDescription.CreateVertex();
-		VertexPositions[VertexID] = FVector3f(vtx[VertexIndex], vtx[VertexIndex + 2], vtx[VertexIndex + 1]) * PRT_TO_UE_SCALE - VertexOffset;
+		const Vitruvio::EUnrealUvSetType UnrealUVSet = Vitruvio::GetUnrealUVSet(PrtUVSet);
+		Attributes.UnrealUVChannels[PrtUVSet] = static_cast<int32>(UnrealUVSet);
+
+		if (UnrealUVSet != Vitruvio::EUnrealUvSetType::None && uvs[PrtUVSet] != nullptr)
+		{
+			TArray<FVector2f>& UVs = Attributes.UVs[PrtUVSet];
+			UVs.SetNumUninitialized(uvsSizes[PrtUVSet] / 2);
+			Vitruvio::ConvertUVs(uvs[PrtUVSet], UVs.Num(), UVs.GetData());
+		}
 	}
-	
+
+	return Attributes;
+}
+
+// Where a face range starts in the PRT face, corner and uv buffers. Corners are converted in order, so the converted vertices (or vertex
+// instances) of a range are FirstCorner to FirstCorner + NumCorners as well.
+struct FPolygonGroupRange
+{
+	size_t FirstFace = 0;
+	size_t NumFaces = 0;
+	size_t FirstCorner = 0;
+	size_t NumCorners = 0;
+	size_t NumTriangles = 0;
+	TArray<size_t, TInlineAllocator<10>> FirstUVIndex;
+};
+
+TArray<FPolygonGroupRange> GetPolygonGroupRanges(const uint32_t* faceVertexCounts, size_t faceVertexCountsSize, uint32_t const* const* uvCounts,
+												 size_t uvSets, const uint32_t* faceRanges, size_t faceRangesSize)
+{
+	TArray<FPolygonGroupRange> Ranges;
+	Ranges.SetNum(faceRangesSize);
+
 	size_t BaseVertexIndex = 0;
-	TArray<size_t> BaseUVIndex;
+	TArray<size_t, TInlineAllocator<10>> BaseUVIndex;
 	BaseUVIndex.Init(0, uvSets);
 
 	size_t PolygonGroupStartIndex = 0;
-	
+
 	for (size_t PolygonGroupIndex = 0; PolygonGroupIndex < faceRangesSize; ++PolygonGroupIndex)
 	{
-		const size_t PolygonFaceCount = faceRanges[PolygonGroupIndex];
+		FPolygonGroupRange& Range = Ranges[PolygonGroupIndex];
+		Range.FirstFace = PolygonGroupStartIndex;
+		Range.NumFaces = faceRanges[PolygonGroupIndex];
+		Range.FirstCorner = BaseVertexIndex;
+		Range.FirstUVIndex = BaseUVIndex;
+
+		int PolygonFaces = 0;
+		for (size_t FaceIndex = 0; FaceIndex < Range.NumFaces; ++FaceIndex)
+		{
+			check(PolygonGroupStartIndex + FaceIndex < faceVertexCountsSize);
+
+			const size_t FaceVertexCount = faceVertexCounts[PolygonGroupStartIndex + FaceIndex];
+			if (FaceVertexCount >= 3)
+			{
+				PolygonFaces++;
+				BaseVertexIndex += FaceVertexCount;
+				Range.NumTriangles += FaceVertexCount - 2;
+				for (size_t PrtUVSet = 0; PrtUVSet < uvSets; ++PrtUVSet)
+				{
+					if (uvCounts[PrtUVSet] != nullptr)
+					{
+						BaseUVIndex[PrtUVSet] += uvCounts[PrtUVSet][PolygonGroupStartIndex + FaceIndex];
+					}
+				}
+			}
+		}
+
+		Range.NumCorners = BaseVertexIndex - Range.FirstCorner;
+		PolygonGroupStartIndex += PolygonFaces;
+	}
+
+	return Ranges;
+}
+
+// A face of a polygon group with the position of its first corner and, per PRT uv set, of its first uv index
+struct FPrtFace
+{
+	size_t FaceIndex = 0;
+	size_t FirstCorner = 0;
+	size_t NumCorners = 0;
+	TArrayView<const size_t> FirstUVIndex;
+};
+
+// Walks the faces of a polygon group in PRT buffer order and calls FaceFunc for every face with at least three corners
+template <typename FaceFuncType>
+void ForEachFace(const FPolygonGroupRange& Range, const uint32_t* faceVertexCounts, uint32_t const* const* uvCounts, size_t uvSets, FaceFuncType&& FaceFunc)
+{
+	FPrtFace Face;
+	Face.FirstCorner = Range.FirstCorner;
+	TArray<size_t, TInlineAllocator<10>> BaseUVIndex = Range.FirstUVIndex;
+	Face.FirstUVIndex = BaseUVIndex;
+
+	for (Face.FaceIndex = Range.FirstFace; Face.FaceIndex < Range.FirstFace + Range.NumFaces; ++Face.FaceIndex)
+	{
+		Face.NumCorners = faceVertexCounts[Face.FaceIndex];
+		if (Face.NumCorners < 3)
+		{
+			continue;
+		}
 
-		Vitruvio::FMaterialAttributeContainer MaterialContainer(materials[PolygonGroupIndex]);
-		TMap<FString, double> AvailableUvSetAttributeMap = CreateAvailableUVSetMaterialParameterMap(uvCounts, uvSets);
-		for (auto& AvailableUvSetAttribute : AvailableUvSetAttributeMap)
+		FaceFunc(static_cast<const FPrtFace&>(Face));
+
+		Face.FirstCorner += Face.NumCorners;
+		for (size_t PrtUVSet = 0; PrtUVSet < uvSets; ++PrtUVSet)
+		{
+			if (uvCounts[PrtUVSet] != nullptr)
+			{
+				BaseUVIndex[PrtUVSet] += uvCounts[PrtUVSet][Face.FaceIndex];
+			}
+		}
+	}
+}
+
+// Calls UVFunc(UnrealUVChannel, UV) for every uv of a face corner which is used in Unreal
+template <typename UVFuncType>
+void ForEachCornerUV(const FPrtFace& Face, size_t FaceVertexIndex, const FConvertedVertexAttributes& Attributes, uint32_t const* const* uvCounts,
+					 uint32_t const* const* uvIndices, size_t uvSets, UVFuncType&& UVFunc)
+{
+	for (size_t PrtUVSet = 0; PrtUVSet < uvSets; ++PrtUVSet)
+	{
+		const int32 UnrealUVChannel = Attributes.UnrealUVChannels[PrtUVSet];
+
+		bool bIsValidUnrealUvSet = UnrealUVChannel != static_cast<int32>(Vitruvio::EUnrealUvSetType::None);
+		bool bFaceHasUvs = uvCounts[PrtUVSet] != nullptr && uvCounts[PrtUVSet][Face.FaceIndex] > 0;
+
+		if (bIsValidUnrealUvSet && bFaceHasUvs)
+		{
+			check(uvCounts[PrtUVSet][Face.FaceIndex] == Face.NumCorners);
+			const uint32_t UVIndex = uvIndices[PrtUVSet][Face.FirstUVIndex[PrtUVSet] + FaceVertexIndex];
+			UVFunc(UnrealUVChannel, Attributes.UVs[PrtUVSet][UVIndex]);
+		}
+	}
+}
+
+// The materials of the face ranges with the availability of their uv sets added as material parameters
+TArray<Vitruvio::FMaterialAttributeContainer> AddAvailableUVSets(const TArray<Vitruvio::FMaterialAttributeContainer>& Materials, size_t faceRangesSize,
+																 const TMap<FString, double>& AvailableUvSetAttributeMap)
+{
+	TArray<Vitruvio::FMaterialAttributeContainer> MaterialContainers;
+	MaterialContainers.Reserve(faceRangesSize);
+	for (size_t RangeIndex = 0; RangeIndex < faceRangesSize; ++RangeIndex)
+	{
+		Vitruvio::FMaterialAttributeContainer& MaterialContainer = MaterialContainers.Add_GetRef(Materials[RangeIndex]);
+		for (const auto& AvailableUvSetAttribute : AvailableUvSetAttributeMap)
 		{
 			MaterialContainer.ScalarProperties.Add(AvailableUvSetAttribute);
 		}
+	}
+	return MaterialContainers;
+}
+
+TArray<Vitruvio::FMaterialAttributeContainer> ConvertMaterials(const prt::AttributeMap** materials, size_t faceRangesSize)
+{
+	TArray<Vitruvio::FMaterialAttributeContainer> Materials;
+	Materials.Reserve(faceRangesSize);
+	for (size_t PolygonGroupIndex = 0; PolygonGroupIndex < faceRangesSize; ++PolygonGroupIndex)
+	{
+		Materials.Emplace(materials[PolygonGroupIndex]);
+	}
+	return Materials;
+}
+
+// Appends a mesh to ModelDescription, polygon groups are shared with the meshes appended before if they have the same material
+void AppendMesh(FModelDescription& ModelDescription, const double* vtx, size_t vtxSize, const double* nrm, size_t nrmSize, const uint32_t* faceVertexCounts, size_t faceVertexCountsSize, const uint32_t* vertexIndices, size_t vertexIndicesSize, const uint32_t* normalIndices, size_t normalIndicesSize,
+	double const* const* uvs, size_t const* uvsSizes, uint32_t const* const* uvCounts, uint32_t const* const* uvIndices, size_t uvSets, const uint32_t* faceRanges, size_t faceRangesSize, const TArray<Vitruvio::FMaterialAttributeContainer>& Materials, const FVector3f& VertexOffset = FVector3f::ZeroVector)
+{
+	VITRUVIO_SCOPE(STAT_Vitruvio_ConvertMesh);
+
+    FStaticMeshAttributes Attributes(ModelDescription.MeshDescription);
+    Attributes.Register();
+
+    const auto VertexUVs = Attributes.GetVertexInstanceUVs();
+    VertexUVs.SetNumChannels(8);
+
+	// Convert vertices and vertex instances
+	const int32 NumVertices = vtxSize / 3;
+	const int32 VertexBase = static_cast<int32>(ModelDescription.VertexIndexOffset);
+	ModelDescription.MeshDescription.ReserveNewVertices(NumVertices);
+	for (int32 VertexIndex = 0; VertexIndex < NumVertices; ++VertexIndex)
+	{
+		ModelDescription.MeshDescription.CreateVertex();
+	}
 
-		FPolygonGroupID PolygonGroupId;
+	// Elements are only ever appended to the mesh description, so vertex ids and raw attribute indices are the same
+	const TArrayView<FVector3f> VertexPositions = Attributes.GetVertexPositions().GetRawArray();
+	check(VertexPositions.Num() == VertexBase + NumVertices);
+	Vitruvio::ConvertPositions(vtx, NumVertices, PRT_TO_UE_SCALE, VertexOffset, VertexPositions.GetData() + VertexBase);
+
+	const FConvertedVertexAttributes ConvertedAttributes = ConvertVertexAttributes(nrm, nrmSize, uvs, uvsSizes, uvSets);
+	const TMap<FString, double> AvailableUvSetAttributeMap = CreateAvailableUVSetMaterialParameterMap(uvCounts, uvSets);
+
+	const TArray<FPolygonGroupRange> GroupRanges = GetPolygonGroupRanges(faceVertexCounts, faceVertexCountsSize, uvCounts, uvSets, faceRanges, faceRangesSize);
+
+	TArray<FPolygonGroupID> PolygonGroupIds;
+	for (const Vitruvio::FMaterialAttributeContainer& MaterialContainer : AddAvailableUVSets(Materials, faceRangesSize, AvailableUvSetAttributeMap))
+	{
 		if (ModelDescription.MaterialToPolygonMap.Contains(MaterialContainer))
 		{
-			PolygonGroupId = ModelDescription.MaterialToPolygonMap[MaterialContainer];
+			PolygonGroupIds.Add(ModelDescription.MaterialToPolygonMap[MaterialContainer]);
 		}
 		else
 		{
 			ModelDescription.Materials.Add(MaterialContainer);
-			PolygonGroupId = ModelDescription.MeshDescription.CreatePolygonGroup();
+			const FPolygonGroupID PolygonGroupId = ModelDescription.MeshDescription.CreatePolygonGroup();
 			ModelDescription.MaterialToPolygonMap.Add(MaterialContainer, PolygonGroupId);
+			PolygonGroupIds.Add(PolygonGroupId);
 		}
+	}
 
-		// Create Geometry
-		const auto Normals = Attributes.GetVertexInstanceNormals();
-		int PolygonFaces = 0;
-		for (size_t FaceIndex = 0; FaceIndex < PolygonFaceCount; ++FaceIndex)
-		{
-			check(PolygonGroupStartIndex + FaceIndex < faceVertexCountsSize);
+	// One vertex instance per corner, so the instance ids and raw attribute indices are the corner indices offset by the instances appended before
+	const int32 InstanceBase = ModelDescription.MeshDescription.VertexInstances().Num();
+	const size_t NumCorners = GroupRanges.IsEmpty() ? 0 : GroupRanges.Last().FirstCorner + GroupRanges.Last().NumCorners;
+	check(NumCorners <= vertexIndicesSize);
+	check(NumCorners <= normalIndicesSize);
+	ModelDescription.MeshDescription.ReserveNewVertexInstances(NumCorners);
+	for (size_t CornerIndex = 0; CornerIndex < NumCorners; ++CornerIndex)
+	{
+		ModelDescription.MeshDescription.CreateVertexInstance(FVertexID(vertexIndices[CornerIndex] + ModelDescription.VertexIndexOffset));
+	}
 
-			const size_t FaceVertexCount = faceVertexCounts[PolygonGroupStartIndex + FaceIndex];
-			TArray<FVertexInstanceID> PolygonVertexInstances;
+	// Fill in the vertex instance attributes of all polygon groups in parallel, every group writes its own range of corners
+	const TArrayView<FVector3f> Normals = Attributes.GetVertexInstanceNormals().GetRawArray();
+	TArray<TArrayView<FVector2f>, TInlineAllocator<8>> UVChannels;
+	for (int32 UVChannel = 0; UVChannel < VertexUVs.GetNumChannels(); ++UVChannel)
+	{
+		UVChannels.Add(VertexUVs.GetRawArray(UVChannel));
+	}
 
-			if (FaceVertexCount >= 3)
+	ParallelFor(GroupRanges.Num(), [&](int32 PolygonGroupIndex) {
+		ForEachFace(GroupRanges[PolygonGroupIndex], faceVertexCounts, uvCounts, uvSets, [&](const FPrtFace& Face) {
+			for (size_t FaceVertexIndex = 0; FaceVertexIndex < Face.NumCorners; ++FaceVertexIndex)
 			{
-				for (size_t FaceVertexIndex = 0; FaceVertexIndex < FaceVertexCount; ++FaceVertexIndex)
-				{
-					check(BaseVertexIndex + FaceVertexIndex < vertexIndicesSize);
-					check(BaseVertexIndex + FaceVertexIndex < normalIndicesSize);
+				const size_t CornerIndex = Face.FirstCorner + FaceVertexIndex;
+				const size_t InstanceIndex = InstanceBase + CornerIndex;
+				Normals[InstanceIndex] = ConvertedAttributes.Normals[normalIndices[CornerIndex]];
 
-					const uint32_t VertexIndex = vertexIndices[BaseVertexIndex + FaceVertexIndex];
-					const uint32_t NormalIndex = normalIndices[BaseVertexIndex + FaceVertexIndex] * 3;
-					FVertexInstanceID InstanceId = ModelDescription.MeshDescription.CreateVertexInstance(FVertexID(VertexIndex + ModelDescription.VertexIndexOffset));
-					PolygonVertexInstances.Add(InstanceId);
+				ForEachCornerUV(Face, FaceVertexIndex, ConvertedAttributes, uvCounts, uvIndices, uvSets, [&](int32 UnrealUVChannel, const FVector2f& UV) {
+					UVChannels[UnrealUVChannel][InstanceIndex] = UV;
+				});
+			}
+		});
+	});
 
-					check(NormalIndex + 2 < nrmSize);
-					Normals[InstanceId] = FVector3f(nrm[NormalIndex], nrm[NormalIndex + 2], nrm[NormalIndex + 1]);
+	// Create Geometry
+	TArray<FVertexInstanceID, TInlineAllocator<16>> PolygonVertexInstances;
+	for (int32 PolygonGroupIndex = 0; PolygonGroupIndex < GroupRanges.Num(); ++PolygonGroupIndex)
+	{
+		ForEachFace(GroupRanges[PolygonGroupIndex], faceVertexCounts, uvCounts, uvSets, [&](const FPrtFace& Face) {
+			PolygonVertexInstances.Reset();
+			for (size_t FaceVertexIndex = 0; FaceVertexIndex < Face.NumCorners; ++FaceVertexIndex)
+			{
+				PolygonVertexInstances.Add(FVertexInstanceID(InstanceBase + static_cast<int32>(Face.FirstCorner + FaceVertexIndex)));
+			}
 
-					for (size_t PrtUVSet = 0; PrtUVSet < uvSets; ++PrtUVSet)
-					{
-						const Vitruvio::EUnrealUvSetType* UnrealUVSetPtr = PRTToUnrealUVSetMap.Find(static_cast<Vitruvio::EPrtUvSetType>(PrtUVSet));
-
-						bool bIsValidUnrealUvSet = (UnrealUVSetPtr != nullptr);
-						bool bFaceHasUvs = uvCounts[PrtUVSet] != nullptr && uvCounts[PrtUVSet][PolygonGroupStartIndex + FaceIndex] > 0;
-
-						if (bIsValidUnrealUvSet && bFaceHasUvs)
-						{
-							check(uvCounts[PrtUVSet][PolygonGroupStartIndex + FaceIndex] == FaceVertexCount);
-							const uint32_t UVIndex = uvIndices[PrtUVSet][BaseUVIndex[PrtUVSet] + FaceVertexIndex] * 2;
-							FVector2f UVCoords = FVector2f(uvs[PrtUVSet][UVIndex], -uvs[PrtUVSet][UVIndex + 1]);
-							VertexUVs.Set(InstanceId, static_cast<int32>(*UnrealUVSetPtr), UVCoords);
-						}
-					}
-				}
+			ModelDescription.MeshDescription.CreatePolygon(PolygonGroupIds[PolygonGroupIndex], PolygonVertexInstances);
+		});
+	}
 
-				ModelDescription.MeshDescription.CreatePolygon(PolygonGroupId, PolygonVertexInstances);
-				PolygonFaces++;
-				BaseVertexIndex += FaceVertexCount;
-				for (size_t PrtUVSet = 0; PrtUVSet < uvSets; ++PrtUVSet)
+	ModelDescription.VertexIndexOffset += vtxSize / 3;
+}
+
+FModelDescription ConvertMesh(const double* vtx, size_t vtxSize, const double* nrm, size_t nrmSize, const uint32_t* faceVertexCounts, size_t faceVertexCountsSize, const uint32_t* vertexIndices, size_t vertexIndicesSize, const uint32_t* normalIndices, size_t normalIndicesSize,
+	double const* const* uvs, size_t const* uvsSizes, uint32_t const* const* uvCounts, uint32_t const* const* uvIndices, size_t uvSets, const uint32_t* faceRanges, size_t faceRangesSize, const TArray<Vitruvio::FMaterialAttributeContainer>& Materials, const FVector3f& VertexOffset = FVector3f::ZeroVector)
+{
+	FModelDescription ModelDescription;
+	AppendMesh(ModelDescription, vtx, vtxSize, nrm, nrmSize, faceVertexCounts, faceVertexCountsSize, vertexIndices, vertexIndicesSize, normalIndices,
+		normalIndicesSize, uvs, uvsSizes, uvCounts, uvIndices, uvSets, faceRanges, faceRangesSize, Materials, VertexOffset);
+	return ModelDescription;
+}
+
+// Triangulates a single planar face while keeping its winding. Returns the (unnormalized) face normal.
+FVector3f TriangulateFace(TArrayView<const FVector3f> Corners, TArray<uint32>& OutIndices)
+{
+	const int32 NumCorners = Corners.Num();
+
+	// Newell's method also works for concave faces
+	FVector3f Normal = FVector3f::ZeroVector;
+	for (int32 CornerIndex = 0; CornerIndex < NumCorners; ++CornerIndex)
+	{
+		const FVector3f& A = Corners[CornerIndex];
+		const FVector3f& B = Corners[(CornerIndex + 1) % NumCorners];
+		Normal.X += (A.Y - B.Y) * (A.Z + B.Z);
+		Normal.Y += (A.Z - B.Z) * (A.X + B.X);
+		Normal.Z += (A.X - B.X) * (A.Y + B.Y);
+	}
+
+	if (NumCorners == 3)
+	{
+		OutIndices.Append({0, 1, 2});
+		return Normal;
+	}
+
+	// Same triangulation as used by the geometry tools of the engine, it also handles faces with holes which PRT bridges to the outer boundary
+	TArray<UE::Geometry::FIndex3i> Triangles;
+	UE::Geometry::PolygonTriangulation::TriangulateSimplePolygon<float>(TArray<FVector3f>(Corners.GetData(), NumCorners), Triangles, false);
+	for (const UE::Geometry::FIndex3i& Triangle : Triangles)
+	{
+		OutIndices.Append({static_cast<uint32>(Triangle.A), static_cast<uint32>(Triangle.B), static_cast<uint32>(Triangle.C)});
+	}
+
+	return Normal;
+}
+
+// Computes the tangent frame of all corners of a face from its first triangle and the color map uvs
+void ComputeFaceTangents(Vitruvio::FRenderMeshData& MeshData, uint32 FirstVertex, uint32 NumCorners, const uint32* FirstTriangle)
+{
+	const int32 NumUVChannels = MeshData.NumUVChannels;
+	constexpr int32 ColorMapChannel = static_cast<int32>(Vitruvio::EUnrealUvSetType::ColorMap);
+
+	const uint32 V0 = FirstVertex + FirstTriangle[0];
+	const uint32 V1 = FirstVertex + FirstTriangle[1];
+	const uint32 V2 = FirstVertex + FirstTriangle[2];
+
+	const FVector3f Edge1 = MeshData.Positions[V1] - MeshData.Positions[V0];
+	const FVector3f Edge2 = MeshData.Positions[V2] - MeshData.Positions[V0];
+	const FVector2f DeltaUV1 = MeshData.UVs[V1 * NumUVChannels + ColorMapChannel] - MeshData.UVs[V0 * NumUVChannels + ColorMapChannel];
+	const FVector2f DeltaUV2 = MeshData.UVs[V2 * NumUVChannels + ColorMapChannel] - MeshData.UVs[V0 * NumUVChannels + ColorMapChannel];
+
+	FVector3f FaceTangent = FVector3f::ZeroVector;
+	FVector3f FaceBinormal = FVector3f::ZeroVector;
+	const float Determinant = DeltaUV1.X * DeltaUV2.Y - DeltaUV2.X * DeltaUV1.Y;
+	if (FMath::Abs(Determinant) > UE_SMALL_NUMBER)
+	{
+		FaceTangent = (Edge1 * DeltaUV2.Y - Edge2 * DeltaUV1.Y) / Determinant;
+		FaceBinormal = (Edge2 * DeltaUV1.X - Edge1 * DeltaUV2.X) / Determinant;
+	}
+
+	for (uint32 Vertex = FirstVertex; Vertex < FirstVertex + NumCorners; ++Vertex)
+	{
+		const FVector3f& Normal = MeshData.TangentZ[Vertex];
+
+		FVector3f TangentX = (FaceTangent - Normal * FVector3f::DotProduct(Normal, FaceTangent)).GetSafeNormal();
+		FVector3f TangentY;
+		if (TangentX.IsZero())
+		{
+			Normal.FindBestAxisVectors(TangentX, TangentY);
+		}
+		else
+		{
+			TangentY = FVector3f::CrossProduct(Normal, TangentX);
+			if (FVector3f::DotProduct(TangentY, FaceBinormal) < 0.0f)
+			{
+				TangentY = -TangentY;
+			}
+		}
+
+		MeshData.TangentX[Vertex] = TangentX;
+		MeshData.TangentY[Vertex] = TangentY;
+	}
+}
+
+// Sections are shared between all meshes appended to a model which have the same material
+int32 FindOrAddSection(FRenderModelDescription& ModelDescription, const Vitruvio::FMaterialAttributeContainer& MaterialContainer)
+{
+	if (const int32* FoundSectionIndex = ModelDescription.MaterialToSectionMap.Find(MaterialContainer))
+	{
+		return *FoundSectionIndex;
+	}
+
+	const int32 SectionIndex = ModelDescription.RenderMeshData.Sections.AddDefaulted();
+	ModelDescription.SectionIndices.AddDefaulted();
+	ModelDescription.Materials.Add(MaterialContainer);
+	ModelDescription.MaterialToSectionMap.Add(MaterialContainer, SectionIndex);
+	return SectionIndex;
+}
+
+// Same face walk as AppendMesh, but writes the triangulated render buffers directly instead of building a FMeshDescription. The indices are
+// collected per section until FinalizeRenderMesh.
+void AppendRenderMesh(FRenderModelDescription& ModelDescription, const double* vtx, size_t vtxSize, const double* nrm, size_t nrmSize, const uint32_t* faceVertexCounts, size_t faceVertexCountsSize, const uint32_t* vertexIndices, size_t vertexIndicesSize, const uint32_t* normalIndices, size_t normalIndicesSize,
+	double const* const* uvs, size_t const* uvsSizes, uint32_t const* const* uvCounts, uint32_t const* const* uvIndices, size_t uvSets, const uint32_t* faceRanges, size_t faceRangesSize, const TArray<Vitruvio::FMaterialAttributeContainer>& Materials, const FVector3f& VertexOffset = FVector3f::ZeroVector)
+{
+	VITRUVIO_SCOPE(STAT_Vitruvio_ConvertMesh);
+
+	Vitruvio::FRenderMeshData& MeshData = ModelDescription.RenderMeshData;
+	MeshData.GrowUVChannels(GetNumUnrealUVChannels(uvCounts, uvSets));
+	const int32 NumUVChannels = MeshData.NumUVChannels;
+
+	TArray<FVector3f> ConvertedPositions;
+	ConvertedPositions.SetNumUninitialized(vtxSize / 3);
+	Vitruvio::ConvertPositions(vtx, ConvertedPositions.Num(), PRT_TO_UE_SCALE, VertexOffset, ConvertedPositions.GetData());
+
+	const FConvertedVertexAttributes ConvertedAttributes = ConvertVertexAttributes(nrm, nrmSize, uvs, uvsSizes, uvSets);
+	const TMap<FString, double> AvailableUvSetAttributeMap = CreateAvailableUVSetMaterialParameterMap(uvCounts, uvSets);
+
+	const TArray<FPolygonGroupRange> GroupRanges = GetPolygonGroupRanges(faceVertexCounts, faceVertexCountsSize, uvCounts, uvSets, faceRanges, faceRangesSize);
+
+	const size_t NumCorners = GroupRanges.IsEmpty() ? 0 : GroupRanges.Last().FirstCorner + GroupRanges.Last().NumCorners;
+	check(NumCorners <= vertexIndicesSize);
+	check(NumCorners <= normalIndicesSize);
+
+	// The vertices of this mesh follow the ones of the meshes appended before
+	const uint32 VertexBase = MeshData.Positions.Num();
+	MeshData.Positions.AddUninitialized(NumCorners);
+	MeshData.TangentX.AddUninitialized(NumCorners);
+	MeshData.TangentY.AddUninitialized(NumCorners);
+	MeshData.TangentZ.AddUninitialized(NumCorners);
+	MeshData.UVs.AddZeroed(NumCorners * NumUVChannels);
+
+	// One section per material, the triangles of all polygon groups with the same material are concatenated in order
+	TArray<int32> GroupSection;
+	TArray<int32> GroupFirstIndex;
+	GroupSection.SetNumUninitialized(GroupRanges.Num());
+	GroupFirstIndex.SetNumUninitialized(GroupRanges.Num());
+	const TArray<Vitruvio::FMaterialAttributeContainer> MaterialContainers = AddAvailableUVSets(Materials, faceRangesSize, AvailableUvSetAttributeMap);
+	for (int32 PolygonGroupIndex = 0; PolygonGroupIndex < GroupRanges.Num(); ++PolygonGroupIndex)
+	{
+		const int32 SectionIndex = FindOrAddSection(ModelDescription, MaterialContainers[PolygonGroupIndex]);
+
+		const FPolygonGroupRange& Range = GroupRanges[PolygonGroupIndex];
+		Vitruvio::FRenderMeshData::FSection& Section = MeshData.Sections[SectionIndex];
+
+		if (Range.NumCorners > 0)
+		{
+			const uint32 FirstVertex = VertexBase + Range.FirstCorner;
+			const uint32 LastVertex = VertexBase + Range.FirstCorner + Range.NumCorners - 1;
+			const bool bHasVertices = Section.NumTriangles > 0;
+			Section.MinVertexIndex = bHasVertices ? FMath::Min(Section.MinVertexIndex, FirstVertex) : FirstVertex;
+			Section.MaxVertexIndex = bHasVertices ? FMath::Max(Section.MaxVertexIndex, LastVertex) : LastVertex;
+		}
+		Section.NumTriangles += Range.NumTriangles;
+
+		GroupSection[PolygonGroupIndex] = SectionIndex;
+		GroupFirstIndex[PolygonGroupIndex] = ModelDescription.SectionIndices[SectionIndex].AddUninitialized(Range.NumTriangles * 3);
+	}
+
+	// Every polygon group writes its own range of vertices and indices, so the result does not depend on the order the groups finish in
+	ParallelFor(GroupRanges.Num(), [&](int32 PolygonGroupIndex) {
+		uint32* Indices = ModelDescription.SectionIndices[GroupSection[PolygonGroupIndex]].GetData() + GroupFirstIndex[PolygonGroupIndex];
+		TArray<uint32> FaceIndices;
+
+		ForEachFace(GroupRanges[PolygonGroupIndex], faceVertexCounts, uvCounts, uvSets, [&](const FPrtFace& Face) {
+			const uint32 FirstVertex = VertexBase + Face.FirstCorner;
+
+			for (size_t FaceVertexIndex = 0; FaceVertexIndex < Face.NumCorners; ++FaceVertexIndex)
+			{
+				const size_t CornerIndex = Face.FirstCorner + FaceVertexIndex;
+				const size_t VertexIndex = VertexBase + CornerIndex;
+				MeshData.Positions[VertexIndex] = ConvertedPositions[vertexIndices[CornerIndex]];
+				MeshData.TangentZ[VertexIndex] = ConvertedAttributes.Normals[normalIndices[CornerIndex]];
+
+				FVector2f* VertexUVs = &MeshData.UVs[VertexIndex * NumUVChannels];
+				ForEachCornerUV(Face, FaceVertexIndex, ConvertedAttributes, uvCounts, uvIndices, uvSets, [VertexUVs](int32 UnrealUVChannel, const FVector2f& UV) {
+					VertexUVs[UnrealUVChannel] = UV;
+				});
+			}
+
+			FaceIndices.Reset();
+			const FVector3f FaceNormal =
+				TriangulateFace(MakeArrayView(MeshData.Positions.GetData() + FirstVertex, static_cast<int32>(Face.NumCorners)), FaceIndices).GetSafeNormal();
+
+			// The indices of the polygon group are laid out for NumCorners - 2 triangles per face, degenerate faces might come out with fewer
+			const int32 NumFaceIndices = static_cast<int32>(Face.NumCorners - 2) * 3;
+			check(FaceIndices.Num() <= NumFaceIndices);
+			FaceIndices.SetNumZeroed(NumFaceIndices);
+
+			// Invalid normals fall back to the flat face normal
+			for (uint32 Vertex = FirstVertex; Vertex < FirstVertex + Face.NumCorners; ++Vertex)
+			{
+				if (!MeshData.TangentZ[Vertex].Normalize())
 				{
-					if (uvCounts[PrtUVSet] != nullptr)
-					{
-						BaseUVIndex[PrtUVSet] += uvCounts[PrtUVSet][PolygonGroupStartIndex + FaceIndex];
-					}
+					MeshData.TangentZ[Vertex] = FaceNormal;
 				}
 			}
+
+			ComputeFaceTangents(MeshData, FirstVertex, Face.NumCorners, FaceIndices.GetData());
+
+			for (const uint32 FaceVertex : FaceIndices)
+			{
+				*Indices++ = FirstVertex + FaceVertex;
+			}
+		});
+	});
+}
+
+// Concatenates the indices of all sections once all meshes are appended
+void FinalizeRenderMesh(FRenderModelDescription& ModelDescription)
+{
+	Vitruvio::FRenderMeshData& MeshData = ModelDescription.RenderMeshData;
+
+	if (ModelDescription.SectionIndices.Num() == 1)
+	{
+		MeshData.Indices = MoveTemp(ModelDescription.SectionIndices[0]);
+	}
+	else
+	{
+		int32 NumIndices = 0;
+		for (const TArray<uint32>& SectionIndices : ModelDescription.SectionIndices)
+		{
+			NumIndices += SectionIndices.Num();
 		}
 
-		PolygonGroupStartIndex += PolygonFaces;
+		MeshData.Indices.Reset(NumIndices);
+		for (int32 SectionIndex = 0; SectionIndex < ModelDescription.SectionIndices.Num(); ++SectionIndex)
+		{
+			MeshData.Sections[SectionIndex].FirstIndex = MeshData.Indices.Num();
+			MeshData.Indices.Append(ModelDescription.SectionIndices[SectionIndex]);
+		}
 	}
 
-	ModelDescription.VertexIndexOffset += vtxSize / 3;
+	ModelDescription.SectionIndices.Empty();
+	ModelDescription.MaterialToSectionMap.Empty();
+}
 
+FRenderModelDescription ConvertRenderMesh(const double* vtx, size_t vtxSize, const double* nrm, size_t nrmSize, const uint32_t* faceVertexCounts, size_t faceVertexCountsSize, const uint32_t* vertexIndices, size_t vertexIndicesSize, const uint32_t* normalIndices, size_t normalIndicesSize,
+	double const* const* uvs, size_t const* uvsSizes, uint32_t const* const* uvCounts, uint32_t const* const* uvIndices, size_t uvSets, const uint32_t* faceRanges, size_t faceRangesSize, const TArray<Vitruvio::FMaterialAttributeContainer>& Materials, const FVector3f& VertexOffset = FVector3f::ZeroVector)
+{
+	FRenderModelDescription ModelDescription;
+	AppendRenderMesh(ModelDescription, vtx, vtxSize, nrm, nrmSize, faceVertexCounts, faceVertexCountsSize, vertexIndices, vertexIndicesSize,
+		normalIndices, normalIndicesSize, uvs, uvsSizes, uvCounts, uvIndices, uvSets, faceRanges, faceRangesSize, Materials, VertexOffset);
+	FinalizeRenderMesh(ModelDescription);
 	return ModelDescription;
 }
 
-TSharedPtr<FVitruvioMesh> CreateVitruvioMesh(const FString& Identifier, FMeshDescription Description, TArray<Vitruvio::FMaterialAttributeContainer> ModelMaterials)
+// Appends the render streams prepared by the encoder (see IUnrealCallbacks::addRenderMesh). They are already triangulated, converted and share
+// one index buffer, so only the tangents (and missing normals) are left to compute. The indices are collected per section until FinalizeRenderMesh.
+void AppendRenderStreams(FRenderModelDescription& ModelDescription, const float* positions, const float* normals, size_t vertexCount, float const* const* uvs, size_t uvSets,
+	const uint32_t* indices, size_t indicesSize, const uint32_t* faceRanges, size_t faceRangesSize, const TArray<Vitruvio::FMaterialAttributeContainer>& Materials)
 {
+	VITRUVIO_SCOPE(STAT_Vitruvio_ConvertMesh);
+
+	constexpr int32 ColorMapChannel = static_cast<int32>(Vitruvio::EUnrealUvSetType::ColorMap);
+
+	Vitruvio::FRenderMeshData& MeshData = ModelDescription.RenderMeshData;
+	MeshData.GrowUVChannels(GetNumUnrealUVChannels(uvs, uvSets));
+	const int32 NumUVChannels = MeshData.NumUVChannels;
+
+	// The vertices of these streams follow the ones of the meshes appended before
+	const int32 NumVertices = static_cast<int32>(vertexCount);
+	const uint32 VertexBase = MeshData.Positions.Num();
+	MeshData.Positions.AddUninitialized(NumVertices);
+	MeshData.TangentX.AddUninitialized(NumVertices);
+	MeshData.TangentY.AddUninitialized(NumVertices);
+	MeshData.TangentZ.AddUninitialized(NumVertices);
+	MeshData.UVs.AddZeroed(NumVertices * NumUVChannels);
+	FMemory::Memcpy(MeshData.Positions.GetData() + VertexBase, positions, NumVertices * sizeof(FVector3f));
+	FMemory::Memcpy(MeshData.TangentZ.GetData() + VertexBase, normals, NumVertices * sizeof(FVector3f));
+
+	for (size_t PrtUVSet = 0; PrtUVSet < uvSets; ++PrtUVSet)
+	{
+		const Vitruvio::EUnrealUvSetType UnrealUVSet = Vitruvio::GetUnrealUVSet(PrtUVSet);
+		if (UnrealUVSet == Vitruvio::EUnrealUvSetType::None || uvs[PrtUVSet] == nullptr)
+		{
+			continue;
+		}
+
+		const FVector2f* UVs = reinterpret_cast<const FVector2f*>(uvs[PrtUVSet]);
+		FVector2f* VertexUVs = MeshData.UVs.GetData() + VertexBase * NumUVChannels + static_cast<int32>(UnrealUVSet);
+		for (int32 VertexIndex = 0; VertexIndex < NumVertices; ++VertexIndex)
+		{
+			VertexUVs[VertexIndex * NumUVChannels] = UVs[VertexIndex];
+		}
+	}
+
+	// One section per material, the triangles of all face ranges with the same material are concatenated in order
+	const TMap<FString, double> AvailableUvSetAttributeMap = CreateAvailableUVSetMaterialParameterMap(uvs, uvSets);
+	const TArray<Vitruvio::FMaterialAttributeContainer> MaterialContainers = AddAvailableUVSets(Materials, faceRangesSize, AvailableUvSetAttributeMap);
+
+	uint32 RangeFirstIndex = 0;
+	for (size_t RangeIndex = 0; RangeIndex < faceRangesSize; ++RangeIndex)
+	{
+		const int32 SectionIndex = FindOrAddSection(ModelDescription, MaterialContainers[RangeIndex]);
+
+		Vitruvio::FRenderMeshData::FSection& Section = MeshData.Sections[SectionIndex];
+		TArray<uint32>& SectionIndices = ModelDescription.SectionIndices[SectionIndex];
+
+		const uint32 NumIndices = faceRanges[RangeIndex] * 3;
+		check(RangeFirstIndex + NumIndices <= indicesSize);
+		for (uint32 Index = RangeFirstIndex; Index < RangeFirstIndex + NumIndices; ++Index)
+		{
+			check(indices[Index] < vertexCount);
+			const uint32 Vertex = VertexBase + indices[Index];
+			const bool bHasVertices = Section.NumTriangles > 0 || Index > RangeFirstIndex;
+			Section.MinVertexIndex = bHasVertices ? FMath::Min(Section.MinVertexIndex, Vertex) : Vertex;
+			Section.MaxVertexIndex = bHasVertices ? FMath::Max(Section.MaxVertexIndex, Vertex) : Vertex;
+			SectionIndices.Add(Vertex);
+		}
+		Section.NumTriangles += faceRanges[RangeIndex];
+		RangeFirstIndex += NumIndices;
+	}
+
+	// Vertices are shared between triangles, so the triangle normals and tangents are accumulated per vertex first
+	TArray<FVector3f> TriangleNormals;
+	TArray<FVector3f> TriangleTangents;
+	TArray<FVector3f> TriangleBinormals;
+	TriangleNormals.SetNumZeroed(NumVertices);
+	TriangleTangents.SetNumZeroed(NumVertices);
+	TriangleBinormals.SetNumZeroed(NumVertices);
+	for (uint32 Index = 0; Index + 2 < RangeFirstIndex; Index += 3)
+	{
+		const uint32 V0 = indices[Index];
+		const uint32 V1 = indices[Index + 1];
+		const uint32 V2 = indices[Index + 2];
+
+		const FVector3f* Positions = MeshData.Positions.GetData() + VertexBase;
+		const FVector2f* UVs = MeshData.UVs.GetData() + VertexBase * NumUVChannels + ColorMapChannel;
+
+		const FVector3f Edge1 = Positions[V1] - Positions[V0];
+		const FVector3f Edge2 = Positions[V2] - Positions[V0];
+		const FVector2f DeltaUV1 = UVs[V1 * NumUVChannels] - UVs[V0 * NumUVChannels];
+		const FVector2f DeltaUV2 = UVs[V2 * NumUVChannels] - UVs[V0 * NumUVChannels];
+
+		const FVector3f TriangleNormal = FVector3f::CrossProduct(Edge1, Edge2);
+		FVector3f TriangleTangent = FVector3f::ZeroVector;
+		FVector3f TriangleBinormal = FVector3f::ZeroVector;
+		const float Determinant = DeltaUV1.X * DeltaUV2.Y - DeltaUV2.X * DeltaUV1.Y;
+		if (FMath::Abs(Determinant) > UE_SMALL_NUMBER)
+		{
+			TriangleTangent = (Edge1 * DeltaUV2.Y - Edge2 * DeltaUV1.Y) / Determinant;
+			TriangleBinormal = (Edge2 * DeltaUV1.X - Edge1 * DeltaUV2.X) / Determinant;
+		}
+
+		for (const uint32 Vertex : {V0, V1, V2})
+		{
+			TriangleNormals[Vertex] += TriangleNormal;
+			TriangleTangents[Vertex] += TriangleTangent;
+			TriangleBinormals[Vertex] += TriangleBinormal;
+		}
+	}
+
+	ParallelFor(NumVertices, [&MeshData, &TriangleNormals, &TriangleTangents, &TriangleBinormals, VertexBase](int32 LocalVertex) {
+		const uint32 Vertex = VertexBase + LocalVertex;
+
+		FVector3f& Normal = MeshData.TangentZ[Vertex];
+		if (!Normal.Normalize())
+		{
+			Normal = TriangleNormals[LocalVertex].GetSafeNormal();
+		}
+
+		const FVector3f& Tangent = TriangleTangents[LocalVertex];
+		FVector3f TangentX = (Tangent - Normal * FVector3f::DotProduct(Normal, Tangent)).GetSafeNormal();
+		FVector3f TangentY;
+		if (TangentX.IsZero())
+		{
+			Normal.FindBestAxisVectors(TangentX, TangentY);
+		}
+		else
+		{
+			TangentY = FVector3f::CrossProduct(Normal, TangentX);
+			if (FVector3f::DotProduct(TangentY, TriangleBinormals[LocalVertex]) < 0.0f)
+			{
+				TangentY = -TangentY;
+			}
+		}
+
+		MeshData.TangentX[Vertex] = TangentX;
+		MeshData.TangentY[Vertex] = TangentY;
+	});
+}
+
+FRenderModelDescription ConvertRenderStreams(const float* positions, const float* normals, size_t vertexCount, float const* const* uvs, size_t uvSets,
+	const uint32_t* indices, size_t indicesSize, const uint32_t* faceRanges, size_t faceRangesSize, const TArray<Vitruvio::FMaterialAttributeContainer>& Materials)
+{
+	FRenderModelDescription ModelDescription;
+	AppendRenderStreams(ModelDescription, positions, normals, vertexCount, uvs, uvSets, indices, indicesSize, faceRanges, faceRangesSize, Materials);
+	FinalizeRenderMesh(ModelDescription);
+	return ModelDescription;
+}
+
+void ComputeTangents(const FString& Identifier, FMeshDescription& Description)
+{
+	VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_ComputeTangents, TEXT("%s"), *Identifier);
+
 	bool bHasInvalidNormals;
 	bool bHasInvalidTangents;
 
@@ -232,10 +818,83 @@ TSharedPtr<FVitruvioMesh> CreateVitruvioMesh(const FString& Identifier, FMeshDes
 	{
 		FStaticMeshOperations::ComputeMikktTangents(Description, true);
 	}
+}
 
+TSharedPtr<FVitruvioMesh> CreateVitruvioMesh(const FString& Identifier, FMeshDescription Description, TArray<Vitruvio::FMaterialAttributeContainer> ModelMaterials)
+{
+	ComputeTangents(Identifier, Description);
 	return MakeShared<FVitruvioMesh>(Identifier, Description, ModelMaterials);
 }
 
+// Appends a chunk of a generated model (see UnrealCallbacks::endChunk), polygon groups are shared with the chunks appended before if they have
+// the same material
+void AppendModelChunk(FModelDescription& ModelDescription, const FModelDescription& Chunk)
+{
+	FStaticMeshOperations::FAppendSettings AppendSettings;
+	AppendSettings.PolygonGroupsDelegate = FAppendPolygonGroupsDelegate::CreateLambda(
+		[&ModelDescription, &Chunk](const FMeshDescription&, FMeshDescription& TargetMesh, PolygonGroupMap& RemapPolygonGroups) {
+			for (const auto& [MaterialContainer, ChunkPolygonGroupId] : Chunk.MaterialToPolygonMap)
+			{
+				FPolygonGroupID PolygonGroupId;
+				if (const FPolygonGroupID* FoundPolygonGroupId = ModelDescription.MaterialToPolygonMap.Find(MaterialContainer))
+				{
+					PolygonGroupId = *FoundPolygonGroupId;
+				}
+				else
+				{
+					ModelDescription.Materials.Add(MaterialContainer);
+					PolygonGroupId = TargetMesh.CreatePolygonGroup();
+					ModelDescription.MaterialToPolygonMap.Add(MaterialContainer, PolygonGroupId);
+				}
+				RemapPolygonGroups.Add(ChunkPolygonGroupId, PolygonGroupId);
+			}
+		});
+
+	FStaticMeshOperations::AppendMeshDescription(Chunk.MeshDescription, ModelDescription.MeshDescription, AppendSettings);
+	ModelDescription.VertexIndexOffset += Chunk.VertexIndexOffset;
+}
+
+// Creates the generated model of an output cluster from all its chunks, the pending chunks are merged in the order they were generated
+TSharedPtr<FVitruvioMesh> CreateGeneratedModel(FModelDescription& ModelDescription, FRenderModelDescription& RenderModelDescription,
+											   TArray<TFuture<FModelDescription>>& PendingChunks)
+{
+	FinalizeRenderMesh(RenderModelDescription);
+
+	if (!RenderModelDescription.RenderMeshData.IsEmpty())
+	{
+		return MakeShared<FVitruvioMesh>(TEXT("GeneratedMesh"), MoveTemp(RenderModelDescription.RenderMeshData), RenderModelDescription.Materials);
+	}
+
+	if (!PendingChunks.IsEmpty())
+	{
+		if (!ModelDescription.MeshDescription.IsEmpty())
+		{
+			ComputeTangents(TEXT("GeneratedMesh"), ModelDescription.MeshDescription);
+		}
+
+		// The tangents of a chunk do not depend on the other chunks
+		FModelDescription MergedDescription;
+		FStaticMeshAttributes Attributes(MergedDescription.MeshDescription);
+		Attributes.Register();
+		Attributes.GetVertexInstanceUVs().SetNumChannels(8);
+
+		for (TFuture<FModelDescription>& PendingChunk : PendingChunks)
+		{
+			AppendModelChunk(MergedDescription, PendingChunk.Get());
+		}
+		AppendModelChunk(MergedDescription, ModelDescription);
+
+		return MakeShared<FVitruvioMesh>(TEXT("GeneratedMesh"), MergedDescription.MeshDescription, MergedDescription.Materials);
+	}
+
+	if (!ModelDescription.MeshDescription.IsEmpty())
+	{
+		return CreateVitruvioMesh(TEXT("GeneratedMesh"), ModelDescription.MeshDescription, ModelDescription.Materials);
+	}
+
+	return nullptr;
+}
+
 TMap<FString, FReport> ExtractReports(const prt::AttributeMap* reports)
 {
 	TMap<FString, FReport> ReportMap;
@@ -277,19 +936,126 @@ TMap<FString, FReport> ExtractReports(const prt::AttributeMap* reports)
 	return ReportMap;
 }
 
+// Copy of a prototype mesh passed to addMesh. PRT only keeps its buffers alive during the callback, so prototypes which are converted in the
+// background have to own their data.
+struct FPrtMeshData
+{
+	TArray<double> Vertices;
+	TArray<double> Normals;
+	TArray<uint32_t> FaceVertexCounts;
+	TArray<uint32_t> VertexIndices;
+	TArray<uint32_t> NormalIndices;
+	TArray<TArray<double>> UVs;
+	TArray<TArray<uint32_t>> UVCounts;
+	TArray<TArray<uint32_t>> UVIndices;
+	TArray<uint32_t> FaceRanges;
+	TArray<Vitruvio::FMaterialAttributeContainer> Materials;
+};
+
+TSharedPtr<FVitruvioMesh> ConvertPrototypeMesh(const FString& Identifier, const FPrtMeshData& Data, bool bDirectMeshConversion)
+{
+	TArray<const double*> UVs;
+	TArray<size_t> UVsSizes;
+	TArray<const uint32_t*> UVCounts;
+	TArray<const uint32_t*> UVIndices;
+	for (int32 UVSet = 0; UVSet < Data.UVs.Num(); ++UVSet)
+	{
+		UVs.Add(Data.UVs[UVSet].IsEmpty() ? nullptr : Data.UVs[UVSet].GetData());
+		UVsSizes.Add(Data.UVs[UVSet].Num());
+		UVCounts.Add(Data.UVCounts[UVSet].IsEmpty() ? nullptr : Data.UVCounts[UVSet].GetData());
+		UVIndices.Add(Data.UVIndices[UVSet].GetData());
+	}
+
+	if (bDirectMeshConversion)
+	{
+		FRenderModelDescription InstanceModelDescription = ConvertRenderMesh(Data.Vertices.GetData(), Data.Vertices.Num(), Data.Normals.GetData(),
+			Data.Normals.Num(), Data.FaceVertexCounts.GetData(), Data.FaceVertexCounts.Num(), Data.VertexIndices.GetData(), Data.VertexIndices.Num(),
+			Data.NormalIndices.GetData(), Data.NormalIndices.Num(), UVs.GetData(), UVsSizes.GetData(), UVCounts.GetData(), UVIndices.GetData(),
+			Data.UVs.Num(), Data.FaceRanges.GetData(), Data.FaceRanges.Num(), Data.Materials);
+
+		if (InstanceModelDescription.RenderMeshData.IsEmpty())
+		{
+			return nullptr;
+		}
+
+		return MakeShared<FVitruvioMesh>(Identifier, MoveTemp(InstanceModelDescription.RenderMeshData), InstanceModelDescription.Materials);
+	}
+
+	FModelDescription InstanceModelDescription = ConvertMesh(Data.Vertices.GetData(), Data.Vertices.Num(), Data.Normals.GetData(), Data.Normals.Num(),
+		Data.FaceVertexCounts.GetData(), Data.FaceVertexCounts.Num(), Data.VertexIndices.GetData(), Data.VertexIndices.Num(), Data.NormalIndices.GetData(),
+		Data.NormalIndices.Num(), UVs.GetData(), UVsSizes.GetData(), UVCounts.GetData(), UVIndices.GetData(), Data.UVs.Num(), Data.FaceRanges.GetData(),
+		Data.FaceRanges.Num(), Data.Materials);
+
+	if (InstanceModelDescription.MeshDescription.IsEmpty())
+	{
+		return nullptr;
+	}
+
+	InstanceModelDescription.MeshDescription.TriangulateMesh();
+
+	return CreateVitruvioMesh(Identifier, InstanceModelDescription.MeshDescription, InstanceModelDescription.Materials);
+}
+
+FTransform ConvertInstanceTransform(const double* transform, const FVector& Offset)
+{
+	const FMatrix TransformationMat(GetColumn(transform, 0), GetColumn(transform, 1), GetColumn(transform, 2), GetColumn(transform, 3));
+	const int32 SignumDet = FMath::Sign(TransformationMat.Determinant());
+
+	// Create proper rotation matrix (remove scaling and translation and det == 1)
+	FMatrix RotationMat = TransformationMat.GetMatrixWithoutScale(PRT_DIVISOR_LIMIT).RemoveTranslation();
+	RotationMat = RotationMat * SignumDet;
+	RotationMat.M[3][3] = 1;
+
+	const FQuat Rotation =
+		Conjugate(RotationMat.ToQuat()); // Conjugate because we want the quaternion to describe a transformation to basis vectors of RotationMat
+	const FVector Scale = TransformationMat.GetScaleVector() * SignumDet;
+	const FVector Translation = TransformationMat.GetOrigin();
+
+	// Convert from right-handed y-up (CE) to left-handed z-up (Unreal) (see
+	// https://stackoverflow.com/questions/16099979/can-i-switch-x-y-z-in-a-quaternion)
+	const FQuat CERotation = FQuat(Rotation.X, Rotation.Z, Rotation.Y, Rotation.W);
+	const FVector CEScale = FVector(Scale.X, Scale.Z, Scale.Y);
+	const FVector CETranslation = FVector(Translation.X, Translation.Z, Translation.Y) * PRT_TO_UE_SCALE - Offset;
+
+	return FTransform(CERotation.GetNormalized(), CETranslation, CEScale);
+}
+
 
 } // namespace
 
 
+void UnrealCallbacks::SetOutputClusters(TArray<int32> OutputClusters)
+{
+	InitialShapeClusters = MoveTemp(OutputClusters);
+
+	const int32 NumClusters = InitialShapeClusters.IsEmpty() ? 1 : FMath::Max(InitialShapeClusters) + 1;
+	Clusters.SetNum(NumClusters);
+}
+
+UnrealCallbacks::FGeneratedModelCluster& UnrealCallbacks::GetCurrentCluster()
+{
+	if (!Clusters.IsValidIndex(CurrentCluster))
+	{
+		Clusters.SetNum(CurrentCluster + 1);
+	}
+	return Clusters[CurrentCluster];
+}
+
 void UnrealCallbacks::init()
 {
-	FStaticMeshAttributes Attributes(ModelDescription.MeshDescription);
+	FStaticMeshAttributes Attributes(GetCurrentCluster().ModelDescription.MeshDescription);
 	Attributes.Register();
 
 	const auto VertexUVs = Attributes.GetVertexInstanceUVs();
 	VertexUVs.SetNumChannels(8);
 }
 
+void UnrealCallbacks::beginInitialShape(size_t initialShapeIndex)
+{
+	const int32 InitialShapeIndex = static_cast<int32>(initialShapeIndex);
+	CurrentCluster = InitialShapeClusters.IsValidIndex(InitialShapeIndex) ? InitialShapeClusters[InitialShapeIndex] : 0;
+}
+
 void UnrealCallbacks::addMesh(const wchar_t* name, const wchar_t* meshId, int32_t prototypeId, const wchar_t* uri, const double* vtx, size_t vtxSize, const double* nrm,
                               size_t nrmSize, const uint32_t* faceVertexCounts, size_t faceVertexCountsSize, const uint32_t* vertexIndices,
                               size_t vertexIndicesSize, const uint32_t* normalIndices, size_t normalIndicesSize,
@@ -301,8 +1067,18 @@ void UnrealCallbacks::addMesh(const wchar_t* name, const wchar_t* meshId, int32_
 {
 	if (prototypeId == NoPrototypeIndex)
 	{
-		ModelDescription = ConvertMesh(vtx, vtxSize, nrm, nrmSize, faceVertexCounts, faceVertexCountsSize, vertexIndices, vertexIndicesSize,
-			normalIndices, normalIndicesSize, uvs, uvCounts, uvIndices, uvSets, faceRanges, faceRangesSize, materials, FVector3f(Offset));
+		// Every chunk adds its own mesh to the generated model
+		if (bDirectMeshConversion)
+		{
+			AppendRenderMesh(GetCurrentCluster().RenderModelDescription, vtx, vtxSize, nrm, nrmSize, faceVertexCounts, faceVertexCountsSize, vertexIndices,
+				vertexIndicesSize, normalIndices, normalIndicesSize, uvs, uvsSizes, uvCounts, uvIndices, uvSets, faceRanges, faceRangesSize,
+				ConvertMaterials(materials, faceRangesSize), FVector3f(Offset));
+			return;
+		}
+
+		AppendMesh(GetCurrentCluster().ModelDescription, vtx, vtxSize, nrm, nrmSize, faceVertexCounts, faceVertexCountsSize, vertexIndices, vertexIndicesSize,
+			normalIndices, normalIndicesSize, uvs, uvsSizes, uvCounts, uvIndices, uvSets, faceRanges, faceRangesSize, ConvertMaterials(materials, faceRangesSize),
+			FVector3f(Offset));
 	}
 	else
 	{
@@ -315,28 +1091,262 @@ void UnrealCallbacks::addMesh(const wchar_t* name, const wchar_t* meshId, int32_
 			InstanceNames.Add(meshId, NameString);
 			return;
 		}
-		
-		FModelDescription InstanceModelDescription = ConvertMesh(vtx, vtxSize, nrm, nrmSize, faceVertexCounts, faceVertexCountsSize,
-			vertexIndices, vertexIndicesSize, normalIndices, normalIndicesSize, uvs, uvCounts, uvIndices, uvSets, faceRanges, faceRangesSize, materials);
 
-		if (!InstanceModelDescription.MeshDescription.IsEmpty())
+		// Convert the prototype in the background while PRT continues with the next one, finish() waits for all of them
+		FPrtMeshData Data;
+		Data.Vertices = TArray<double>(vtx, vtxSize);
+		Data.Normals = TArray<double>(nrm, nrmSize);
+		Data.FaceVertexCounts = TArray<uint32_t>(faceVertexCounts, faceVertexCountsSize);
+		Data.VertexIndices = TArray<uint32_t>(vertexIndices, vertexIndicesSize);
+		Data.NormalIndices = TArray<uint32_t>(normalIndices, normalIndicesSize);
+		for (size_t UVSet = 0; UVSet < uvSets; ++UVSet)
 		{
+			Data.UVs.Emplace(uvs[UVSet], uvsSizes[UVSet]);
+			Data.UVCounts.Emplace(uvCounts[UVSet], uvCounts[UVSet] ? uvCountsSizes[UVSet] : 0);
+			Data.UVIndices.Emplace(uvIndices[UVSet], uvIndicesSizes[UVSet]);
+		}
+		Data.FaceRanges = TArray<uint32_t>(faceRanges, faceRangesSize);
+		Data.Materials = ConvertMaterials(materials, faceRangesSize);
+
+		TFuture<TSharedPtr<FVitruvioMesh>> Mesh =
+			Async(EAsyncExecution::TaskGraph, [IdentifierString, Data = MoveTemp(Data), bDirectMeshConversion = bDirectMeshConversion]() {
+				return ConvertPrototypeMesh(IdentifierString, Data, bDirectMeshConversion);
+			});
+
+		PendingInstanceMeshes.Add({IdentifierString, MoveTemp(Mesh)});
+		InstanceNames.Add(meshId, NameString);
+	}
+}
+
+void UnrealCallbacks::addRenderMesh(const wchar_t* name, const wchar_t* meshId, int32_t prototypeId, const wchar_t* uri, const float* positions,
+									const float* normals, size_t vertexCount, float const* const* uvs, size_t uvSets, const uint32_t* indices,
+									size_t indicesSize, const uint32_t* faceRanges, size_t faceRangesSize, const prt::AttributeMap** materials)
+{
+	if (prototypeId == NoPrototypeIndex)
+	{
+		AppendRenderStreams(GetCurrentCluster().RenderModelDescription, positions, normals, vertexCount, uvs, uvSets, indices, indicesSize, faceRanges, faceRangesSize,
+			ConvertMaterials(materials, faceRangesSize));
+		return;
+	}
+
+	const FString NameString(name);
+	const FString IdentifierString(meshId);
+
+	if (const TSharedPtr<FVitruvioMesh> Mesh = VitruvioModule::Get().GetMeshCache().Get(IdentifierString))
+	{
+		InstanceMeshes.Add(meshId, Mesh);
+		InstanceNames.Add(meshId, NameString);
+		return;
+	}
+
+	// The streams only have to be copied, so unlike in addMesh the prototype is converted right away instead of copying its data for a background task
+	FRenderModelDescription InstanceModelDescription = ConvertRenderStreams(positions, normals, vertexCount, uvs, uvSets, indices, indicesSize,
+		faceRanges, faceRangesSize, ConvertMaterials(materials, faceRangesSize));
+
+	TSharedPtr<FVitruvioMesh> Mesh;
+	if (!InstanceModelDescription.RenderMeshData.IsEmpty())
+	{
+		Mesh = MakeShared<FVitruvioMesh>(IdentifierString, MoveTemp(InstanceModelDescription.RenderMeshData), InstanceModelDescription.Materials);
+	}
+
+	PendingInstanceMeshes.Add({IdentifierString, MakeFulfilledPromise<TSharedPtr<FVitruvioMesh>>(MoveTemp(Mesh)).GetFuture()});
+	InstanceNames.Add(meshId, NameString);
+}
+
+void UnrealCallbacks::beginMesh(const wchar_t* name, const wchar_t* meshId, int32_t prototypeId, const wchar_t* uri, size_t partCount, size_t uvSets)
+{
+	StreamedMesh = FStreamedMesh();
+	StreamedMesh.Name = name;
+	StreamedMesh.MeshId = meshId;
+	StreamedMesh.PrototypeId = prototypeId;
+
+	if (prototypeId != NoPrototypeIndex)
+	{
+		if (const TSharedPtr<FVitruvioMesh> Mesh = VitruvioModule::Get().GetMeshCache().Get(StreamedMesh.MeshId))
+		{
+			InstanceMeshes.Add(StreamedMesh.MeshId, Mesh);
+			InstanceNames.Add(StreamedMesh.MeshId, StreamedMesh.Name);
+			StreamedMesh.bIsCached = true;
+		}
+	}
+}
+
+void UnrealCallbacks::addMeshPart(const double* vtx, size_t vtxSize, const double* nrm, size_t nrmSize, const uint32_t* faceVertexCounts,
+								  size_t faceVertexCountsSize, const uint32_t* vertexIndices, size_t vertexIndicesSize, const uint32_t* normalIndices,
+								  size_t normalIndicesSize,
+
+								  double const* const* uvs, size_t const* uvsSizes, uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+								  uint32_t const* const* uvIndices, size_t const* uvIndicesSizes, size_t uvSets,
+
+								  const prt::AttributeMap* material)
+{
+	if (StreamedMesh.bIsCached)
+	{
+		return;
+	}
+
+	// Each part is a single polygon group with local indices, the Append functions rebase them onto the parts added before. Parts of the generated
+	// model go directly into the model of all chunks.
+	const uint32_t FaceRange = static_cast<uint32_t>(faceVertexCountsSize);
+	const TArray<Vitruvio::FMaterialAttributeContainer> Materials = ConvertMaterials(&material, 1);
+	const bool bIsGeneratedModel = StreamedMesh.PrototypeId == NoPrototypeIndex;
+	const FVector3f VertexOffset = bIsGeneratedModel ? FVector3f(Offset) : FVector3f::ZeroVector;
+
+	if (bDirectMeshConversion)
+	{
+		FRenderModelDescription& TargetDescription = bIsGeneratedModel ? GetCurrentCluster().RenderModelDescription : StreamedMesh.RenderModelDescription;
+		AppendRenderMesh(TargetDescription, vtx, vtxSize, nrm, nrmSize, faceVertexCounts, faceVertexCountsSize, vertexIndices, vertexIndicesSize,
+			normalIndices, normalIndicesSize, uvs, uvsSizes, uvCounts, uvIndices, uvSets, &FaceRange, 1, Materials, VertexOffset);
+	}
+	else
+	{
+		FModelDescription& TargetDescription = bIsGeneratedModel ? GetCurrentCluster().ModelDescription : StreamedMesh.ModelDescription;
+		AppendMesh(TargetDescription, vtx, vtxSize, nrm, nrmSize, faceVertexCounts, faceVertexCountsSize, vertexIndices, vertexIndicesSize,
+			normalIndices, normalIndicesSize, uvs, uvsSizes, uvCounts, uvIndices, uvSets, &FaceRange, 1, Materials, VertexOffset);
+	}
+}
+
+void UnrealCallbacks::endMesh()
+{
+	// The generated model is only finalized in finish() since later chunks still add to it
+	if (StreamedMesh.bIsCached || StreamedMesh.PrototypeId == NoPrototypeIndex)
+	{
+		StreamedMesh = FStreamedMesh();
+		return;
+	}
+
+	TFuture<TSharedPtr<FVitruvioMesh>> Mesh;
+	if (bDirectMeshConversion)
+	{
+		FinalizeRenderMesh(StreamedMesh.RenderModelDescription);
+
+		TSharedPtr<FVitruvioMesh> RenderMesh;
+		if (!StreamedMesh.RenderModelDescription.RenderMeshData.IsEmpty())
+		{
+			RenderMesh = MakeShared<FVitruvioMesh>(StreamedMesh.MeshId, MoveTemp(StreamedMesh.RenderModelDescription.RenderMeshData),
+												   StreamedMesh.RenderModelDescription.Materials);
+		}
+		Mesh = MakeFulfilledPromise<TSharedPtr<FVitruvioMesh>>(MoveTemp(RenderMesh)).GetFuture();
+	}
+	else
+	{
+		// The tangents are computed in the background like for prototypes passed to addMesh
+		Mesh = Async(EAsyncExecution::TaskGraph, [MeshId = StreamedMesh.MeshId, InstanceModelDescription = MoveTemp(StreamedMesh.ModelDescription)]() mutable {
+			if (InstanceModelDescription.MeshDescription.IsEmpty())
+			{
+				return TSharedPtr<FVitruvioMesh>();
+			}
+
 			InstanceModelDescription.MeshDescription.TriangulateMesh();
-			
-			TSharedPtr<FVitruvioMesh> Mesh = CreateVitruvioMesh(IdentifierString, InstanceModelDescription.MeshDescription, InstanceModelDescription.Materials);
-			Mesh = VitruvioModule::Get().GetMeshCache().InsertOrGet(IdentifierString, Mesh);
+			return CreateVitruvioMesh(MeshId, InstanceModelDescription.MeshDescription, InstanceModelDescription.Materials);
+		});
+	}
 
-			InstanceMeshes.Add(meshId, Mesh);
-			InstanceNames.Add(meshId, NameString);
+	PendingInstanceMeshes.Add({StreamedMesh.MeshId, MoveTemp(Mesh)});
+	InstanceNames.Add(StreamedMesh.MeshId, StreamedMesh.Name);
+
+	StreamedMesh = FStreamedMesh();
+}
+
+void UnrealCallbacks::ResolveInstanceMaterialIds()
+{
+	// The material containers are only built once per material and looked up once per distinct instance key
+	for (auto& [Key, Transforms] : InstancesByMaterialIds)
+	{
+		TArray<Vitruvio::FMaterialAttributeContainer> MaterialOverrides;
+		MaterialOverrides.Reserve(Key.MaterialIds.Num());
+		for (const int32 MaterialId : Key.MaterialIds)
+		{
+			MaterialOverrides.Add(InternedMaterials.FindChecked(MaterialId));
 		}
+
+		GetCurrentCluster().Instances.FindOrAdd({Key.MeshId, MoveTemp(MaterialOverrides)}).Append(MoveTemp(Transforms));
 	}
+	InstancesByMaterialIds.Empty();
+	InternedMaterials.Empty();
+}
+
+void UnrealCallbacks::endChunk()
+{
+	// Material ids are only unique within a chunk
+	ResolveInstanceMaterialIds();
+
+	// Render data already gets its tangents while it is appended. Mesh descriptions of finished chunks compute them in the background while PRT
+	// generates the next chunk.
+	FGeneratedModelCluster& Cluster = GetCurrentCluster();
+	if (bDirectMeshConversion || Cluster.ModelDescription.MeshDescription.IsEmpty())
+	{
+		return;
+	}
+
+	Cluster.PendingChunks.Add(Async(EAsyncExecution::TaskGraph, [Chunk = MoveTemp(Cluster.ModelDescription)]() mutable {
+		ComputeTangents(TEXT("GeneratedMesh"), Chunk.MeshDescription);
+		return MoveTemp(Chunk);
+	}));
+	Cluster.ModelDescription = FModelDescription();
 }
 
 void UnrealCallbacks::finish()
 {
-	if (!ModelDescription.MeshDescription.IsEmpty())
+	ResolveInstanceMaterialIds();
+
+	ClusterModels.SetNum(Clusters.Num());
+	ClusterInstances.SetNum(Clusters.Num());
+	for (int32 ClusterIndex = 0; ClusterIndex < Clusters.Num(); ++ClusterIndex)
+	{
+		FGeneratedModelCluster& Cluster = Clusters[ClusterIndex];
+		ClusterModels[ClusterIndex] = CreateGeneratedModel(Cluster.ModelDescription, Cluster.RenderModelDescription, Cluster.PendingChunks);
+		ClusterInstances[ClusterIndex] = MoveTemp(Cluster.Instances);
+	}
+	Clusters.Empty();
+
+	// Collect the prototypes in the order PRT added them so the result does not depend on which conversion finished first
+	for (FPendingInstanceMesh& PendingInstanceMesh : PendingInstanceMeshes)
 	{
-		GeneratedModel = CreateVitruvioMesh(TEXT("GeneratedMesh"), ModelDescription.MeshDescription, ModelDescription.Materials);
+		const FString& MeshId = PendingInstanceMesh.MeshId;
+		TSharedPtr<FVitruvioMesh> Mesh = PendingInstanceMesh.Mesh.Get();
+
+		if (Mesh)
+		{
+			InstanceMeshes.Add(MeshId, VitruvioModule::Get().GetMeshCache().InsertOrGet(MeshId, Mesh));
+		}
+		else
+		{
+			UE_LOG(LogUnrealCallbacks, Warning, TEXT("No mesh found for meshId %s"), *MeshId);
+
+			InstanceNames.Remove(MeshId);
+			for (Vitruvio::FInstanceMap& ClusterInstanceMap : ClusterInstances)
+			{
+				for (auto InstanceIt = ClusterInstanceMap.CreateIterator(); InstanceIt; ++InstanceIt)
+				{
+					if (InstanceIt->Key.MeshId == MeshId)
+					{
+						InstanceIt.RemoveCurrent();
+					}
+				}
+			}
+		}
+	}
+	PendingInstanceMeshes.Empty();
+
+	// Without output clusters the single cluster is the generated model of the whole call, with output clusters the instances of all clusters
+	// are reported together as well
+	if (!HasOutputClusters())
+	{
+		GeneratedModel = ClusterModels.IsEmpty() ? nullptr : ClusterModels[0];
+		Instances = ClusterInstances.IsEmpty() ? Vitruvio::FInstanceMap() : MoveTemp(ClusterInstances[0]);
+		ClusterModels.Empty();
+		ClusterInstances.Empty();
+	}
+	else
+	{
+		for (const Vitruvio::FInstanceMap& ClusterInstanceMap : ClusterInstances)
+		{
+			for (const auto& [InstanceKey, Transforms] : ClusterInstanceMap)
+			{
+				Instances.FindOrAdd(InstanceKey).Append(Transforms);
+			}
+		}
 	}
 }
 
@@ -354,32 +1364,13 @@ void UnrealCallbacks::addReport(const prt::AttributeMap* reports)
 void UnrealCallbacks::addInstance(int32_t prototypeId, const wchar_t* meshId, const double* transform, const prt::AttributeMap** instanceMaterials,
                                   size_t numInstanceMaterials)
 {
-	const FMatrix TransformationMat(GetColumn(transform, 0), GetColumn(transform, 1), GetColumn(transform, 2), GetColumn(transform, 3));
-	const int32 SignumDet = FMath::Sign(TransformationMat.Determinant());
-
-	// Create proper rotation matrix (remove scaling and translation and det == 1)
-	FMatrix RotationMat = TransformationMat.GetMatrixWithoutScale(PRT_DIVISOR_LIMIT).RemoveTranslation();
-	RotationMat = RotationMat * SignumDet;
-	RotationMat.M[3][3] = 1;
-
-	const FQuat Rotation =
-		Conjugate(RotationMat.ToQuat()); // Conjugate because we want the quaternion to describe a transformation to basis vectors of RotationMat
-	const FVector Scale = TransformationMat.GetScaleVector() * SignumDet;
-	const FVector Translation = TransformationMat.GetOrigin();
-
-	// Convert from right-handed y-up (CE) to left-handed z-up (Unreal) (see
-	// https://stackoverflow.com/questions/16099979/can-i-switch-x-y-z-in-a-quaternion)
-	const FQuat CERotation = FQuat(Rotation.X, Rotation.Z, Rotation.Y, Rotation.W);
-	const FVector CEScale = FVector(Scale.X, Scale.Z, Scale.Y);
-	const FVector CETranslation = FVector(Translation.X, Translation.Z, Translation.Y) * PRT_TO_UE_SCALE - Offset;
-
-	if (!InstanceMeshes.Contains(meshId))
+	if (!InstanceNames.Contains(meshId))
 	{
 		UE_LOG(LogUnrealCallbacks, Warning, TEXT("No mesh found for meshId %s"), meshId);
 		return;
 	}
 
-	const FTransform Transform(CERotation.GetNormalized(), CETranslation, CEScale);
+	const FTransform Transform = ConvertInstanceTransform(transform, Offset);
 
 	TArray<Vitruvio::FMaterialAttributeContainer> MaterialOverrides;
 	if (instanceMaterials)
@@ -391,7 +1382,26 @@ void UnrealCallbacks::addInstance(int32_t prototypeId, const wchar_t* meshId, co
 		}
 	}
 
-	Instances.FindOrAdd({meshId, MaterialOverrides}).Add(Transform);
+	GetCurrentCluster().Instances.FindOrAdd({meshId, MaterialOverrides}).Add(Transform);
+}
+
+void UnrealCallbacks::addMaterial(int32_t materialId, const prt::AttributeMap* material)
+{
+	InternedMaterials.Emplace(materialId, Vitruvio::FMaterialAttributeContainer(material));
+}
+
+void UnrealCallbacks::addInstanceWithMaterialIds(int32_t prototypeId, const wchar_t* meshId, const double* transform, const int32_t* materialIds,
+												 size_t numMaterialIds)
+{
+	if (!InstanceNames.Contains(meshId))
+	{
+		UE_LOG(LogUnrealCallbacks, Warning, TEXT("No mesh found for meshId %s"), meshId);
+		return;
+	}
+
+	FInstanceMaterialIdsKey Key{meshId, {}};
+	Key.MaterialIds.Append(materialIds, static_cast<int32>(numMaterialIds));
+	InstancesByMaterialIds.FindOrAdd(MoveTemp(Key)).Add(ConvertInstanceTransform(transform, Offset));
 }
 
 prt::Status UnrealCallbacks::attrBool(size_t isIndex, int32_t shapeID, const wchar_t* key, bool value)
@@ -21,7 +21,9 @@
 #include "Report.h"
 #include "VitruvioTypes.h"
 
+#include "Async/Future.h"
 #include "Engine/StaticMesh.h"
+#include "HAL/IConsoleManager.h"
 #include "MeshDescription.h"
 #include "StaticMeshAttributes.h"
 #include "Modules/ModuleManager.h"
@@ -37,6 +39,19 @@ struct FModelDescription
 	TMap<Vitruvio::FMaterialAttributeContainer, FPolygonGroupID> MaterialToPolygonMap;
 };
 
+struct FRenderModelDescription
+{
+	Vitruvio::FRenderMeshData RenderMeshData;
+	TArray<Vitruvio::FMaterialAttributeContainer> Materials;
+
+	// The indices per section while meshes are appended, they are moved into RenderMeshData.Indices once all meshes are added
+	TMap<Vitruvio::FMaterialAttributeContainer, int32> MaterialToSectionMap;
+	TArray<TArray<uint32>> SectionIndices;
+};
+
+extern TAutoConsoleVariable<bool> CVarDirectMeshConversion;
+extern TAutoConsoleVariable<int32> CVarGenerateChunkSize;
+
 class UnrealCallbacks final : public IUnrealCallbacks
 {
 	TArray<AttributeMapBuilderUPtr>& AttributeMapBuilders;
@@ -46,13 +61,79 @@ class UnrealCallbacks final : public IUnrealCallbacks
 	TMap<FString, TSharedPtr<FVitruvioMesh>> InstanceMeshes;
 	TMap<FString, FString> InstanceNames;
 
-	FModelDescription ModelDescription;
+	struct FPendingInstanceMesh
+	{
+		FString MeshId;
+		TFuture<TSharedPtr<FVitruvioMesh>> Mesh;
+	};
+	TArray<FPendingInstanceMesh> PendingInstanceMeshes;
+
+	const bool bDirectMeshConversion;
+	const int32 StreamChunkSize;
+
+	// The mesh which is currently streamed by beginMesh, addMeshPart and endMesh
+	struct FStreamedMesh
+	{
+		FString Name;
+		FString MeshId;
+		int32 PrototypeId = -1;
+		bool bIsCached = false;
+		FModelDescription ModelDescription;
+		FRenderModelDescription RenderModelDescription;
+	};
+	FStreamedMesh StreamedMesh;
+
+	// Materials passed to addMaterial by their id
+	TMap<int32, Vitruvio::FMaterialAttributeContainer> InternedMaterials;
+
+	// Instances passed to addInstanceWithMaterialIds, they are only resolved to their materials once per key in finish()
+	struct FInstanceMaterialIdsKey
+	{
+		FString MeshId;
+		TArray<int32, TInlineAllocator<4>> MaterialIds;
+
+		friend bool operator==(const FInstanceMaterialIdsKey& Lhs, const FInstanceMaterialIdsKey& Rhs)
+		{
+			return Lhs.MeshId == Rhs.MeshId && Lhs.MaterialIds == Rhs.MaterialIds;
+		}
+
+		friend uint32 GetTypeHash(const FInstanceMaterialIdsKey& Object)
+		{
+			uint32 Hash = GetTypeHash(Object.MeshId);
+			for (const int32 MaterialId : Object.MaterialIds)
+			{
+				Hash = HashCombine(Hash, ::GetTypeHash(MaterialId));
+			}
+			return Hash;
+		}
+	};
+	TMap<FInstanceMaterialIdsKey, TArray<FTransform>> InstancesByMaterialIds;
+
+	// The generated model of an output cluster accumulates the meshes without a prototype of all chunks (see endChunk)
+	struct FGeneratedModelCluster
+	{
+		FModelDescription ModelDescription;
+		FRenderModelDescription RenderModelDescription;
+
+		// Finished chunks whose tangents are computed in the background, they are merged in finish()
+		TArray<TFuture<FModelDescription>> PendingChunks;
+
+		Vitruvio::FInstanceMap Instances;
+	};
+	TArray<FGeneratedModelCluster> Clusters;
+
+	// The output cluster per initial shape index, empty if all initial shapes form one generated model
+	TArray<int32> InitialShapeClusters;
+	int32 CurrentCluster = 0;
+
 	TSharedPtr<FVitruvioMesh> GeneratedModel;
+	TArray<TSharedPtr<FVitruvioMesh>> ClusterModels;
+	TArray<Vitruvio::FInstanceMap> ClusterInstances;
 	TMap<FString, FReport> Reports;
 	
 public:
 	virtual ~UnrealCallbacks() override = default;
-	UnrealCallbacks(TArray<AttributeMapBuilderUPtr>& AttributeMapBuilders, const FVector& Offset = FVector::ZeroVector) : AttributeMapBuilders(AttributeMapBuilders), Offset(Offset) {}
+	UnrealCallbacks(TArray<AttributeMapBuilderUPtr>& AttributeMapBuilders, const FVector& Offset = FVector::ZeroVector) : AttributeMapBuilders(AttributeMapBuilders), Offset(Offset), bDirectMeshConversion(CVarDirectMeshConversion.GetValueOnAnyThread()), StreamChunkSize(CVarGenerateChunkSize.GetValueOnAnyThread()) {}
 
 	static constexpr int32 NoPrototypeIndex = -1;
 
@@ -71,6 +152,29 @@ public:
 		return GeneratedModel;
 	}
 
+	const TArray<TSharedPtr<FVitruvioMesh>>& GetClusterModels() const
+	{
+		return ClusterModels;
+	}
+
+	const TArray<Vitruvio::FInstanceMap>& GetClusterInstances() const
+	{
+		return ClusterInstances;
+	}
+
+	/**
+	 * Keeps the generated models of the output clusters apart instead of generating one model for all initial shapes, see
+	 * FInitialShape::OutputCluster. Has to be called before generating.
+	 *
+	 * @param OutputClusters the output cluster per initial shape index
+	 */
+	void SetOutputClusters(TArray<int32> OutputClusters);
+
+	bool HasOutputClusters() const
+	{
+		return !InitialShapeClusters.IsEmpty();
+	}
+
 	const TMap<FString, FReport>& GetReports() const
 	{
 		return Reports;
@@ -81,6 +185,21 @@ public:
 		return InstanceNames;
 	}
 
+	const FVector& GetOffset() const
+	{
+		return Offset;
+	}
+
+	bool UsesDirectMeshConversion() const
+	{
+		return bDirectMeshConversion;
+	}
+
+	int32 GetStreamChunkSize() const
+	{
+		return StreamChunkSize;
+	}
+
 	/**
 	 * @param name either the name of the inserted asset or the shape name
 	 * @param identifier unique identifier of this mesh if originates from an inserted asset or empty otherwise
@@ -132,6 +251,20 @@ public:
 	virtual void addInstance(int32_t prototypeId, const wchar_t* meshId, const double* transform, const prt::AttributeMap** instanceMaterial,
 							 size_t numInstanceMaterials) override;
 
+	/**
+	 * Add a material which is referenced by its id in addInstanceWithMaterialIds
+	 *
+	 * @param materialId unique id of the material
+	 * @param material the material attributes
+	 */
+	virtual void addMaterial(int32_t materialId, const prt::AttributeMap* material) override;
+
+	/**
+	 * Same as addInstance, but the materials are referenced by the ids passed to addMaterial
+	 */
+	virtual void addInstanceWithMaterialIds(int32_t prototypeId, const wchar_t* meshId, const double* transform, const int32_t* materialIds,
+											size_t numMaterialIds) override;
+
 	/**
 	 * Add a new report
 	 *
@@ -139,6 +272,57 @@ public:
 	 */
 	virtual void addReport(const prt::AttributeMap* reports) override;
 
+	/**
+	 * Alternative to addMesh if the encoder emits render streams. The streams are triangulated, converted to Unreal coordinates and share one
+	 * index buffer, see IUnrealCallbacks::addRenderMesh.
+	 */
+	// clang-format off
+	virtual void addRenderMesh(const wchar_t* name, const wchar_t* meshId,
+	                           int32_t prototypeId, const wchar_t* uri,
+	                           const float* positions, const float* normals, size_t vertexCount,
+	                           float const* const* uvs, size_t uvSets,
+	                           const uint32_t* indices, size_t indicesSize,
+	                           const uint32_t* faceRanges, size_t faceRangesSize,
+	                           const prt::AttributeMap** materials
+	) override;
+	// clang-format on
+
+	/**
+	 * Streaming alternative to addMesh, see IUnrealCallbacks::beginMesh. The parts are converted directly into the mesh description
+	 * (or render data) of the mesh.
+	 */
+	virtual void beginMesh(const wchar_t* name, const wchar_t* meshId, int32_t prototypeId, const wchar_t* uri, size_t partCount, size_t uvSets) override;
+
+	// clang-format off
+	virtual void addMeshPart(const double* vtx, size_t vtxSize,
+	                         const double* nrm, size_t nrmSize,
+	                         const uint32_t* faceVertexCounts, size_t faceVertexCountsSize,
+	                         const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                         const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                         double const* const* uvs, size_t const* uvsSizes,
+	                         uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                         uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                         size_t uvSets,
+
+	                         const prt::AttributeMap* material
+	) override;
+	// clang-format on
+
+	virtual void endMesh() override;
+
+	/**
+	 * Resolves the instance material ids of the finished chunk and starts computing the tangents of its part of the generated model in the
+	 * background, see IUnrealCallbacks::endChunk.
+	 */
+	virtual void endChunk() override;
+
+	/**
+	 * Adds the meshes without a prototype of the following chunk to the output cluster of the initial shape, see
+	 * IUnrealCallbacks::beginInitialShape.
+	 */
+	virtual void beginInitialShape(size_t initialShapeIndex) override;
+
 	virtual void init() override;
 	
 	virtual void finish() override;
@@ -188,4 +372,7 @@ public:
 	virtual prt::Status attrStringArray(size_t isIndex, int32_t shapeID, const wchar_t* key, const wchar_t* const* values, size_t size,
 								size_t nRows) override;
 
+private:
+	FGeneratedModelCluster& GetCurrentCluster();
+	void ResolveInstanceMaterialIds();
 };
\ No newline at end of file
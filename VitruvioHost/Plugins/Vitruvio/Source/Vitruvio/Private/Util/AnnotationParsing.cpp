@@ -234,6 +234,18 @@ void ParseAttributeAnnotations(const prt::RuleFileInfo::Entry* AttributeInfo, UR
 	}
 }
 
+bool IsAttributeHidden(const prt::RuleFileInfo::Entry* AttributeInfo)
+{
+	for (size_t AnnotationIndex = 0; AnnotationIndex < AttributeInfo->getNumAnnotations(); ++AnnotationIndex)
+	{
+		if (!std::wcscmp(AttributeInfo->getAnnotation(AnnotationIndex)->getName(), ANNOT_HIDDEN))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 TMap<FString, int> ParseImportOrderMap(const RuleFileInfoPtr& RuleFileInfo)
 {
 	TMap<FString, int> ImportOrderMap;
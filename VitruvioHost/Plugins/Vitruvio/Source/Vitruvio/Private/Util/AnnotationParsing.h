@@ -22,5 +22,7 @@ namespace Vitruvio
 {
 void ParseAttributeAnnotations(const prt::RuleFileInfo::Entry* AttributeInfo, URuleAttribute& InAttribute, UObject* const Outer);
 
+bool IsAttributeHidden(const prt::RuleFileInfo::Entry* AttributeInfo);
+
 TMap<FString, int> ParseImportOrderMap(const RuleFileInfoPtr& RuleFileInfo);
 } // namespace Vitruvio
@@ -36,75 +36,88 @@ std::vector<const wchar_t*> ToPtrVector(const TArray<FString>& Input)
 	return PtrVec;
 }
 
-URuleAttribute* CreateAttribute(const AttributeMapUPtr& AttributeMap, const prt::RuleFileInfo::Entry* AttrInfo, UObject* const Outer)
+UClass* GetAttributeClass(prt::AnnotationArgumentType Type)
 {
-	const std::wstring Name(AttrInfo->getName());
-	const FName AttributeName = WCHAR_TO_TCHAR(Name.c_str());
-	switch (AttrInfo->getReturnType())
+	switch (Type)
 	{
 	case prt::AAT_BOOL:
+		return UBoolAttribute::StaticClass();
+	case prt::AAT_INT:
+	case prt::AAT_FLOAT:
+		return UFloatAttribute::StaticClass();
+	case prt::AAT_STR:
+		return UStringAttribute::StaticClass();
+	case prt::AAT_STR_ARRAY:
+		return UStringArrayAttribute::StaticClass();
+	case prt::AAT_BOOL_ARRAY:
+		return UBoolArrayAttribute::StaticClass();
+	case prt::AAT_FLOAT_ARRAY:
+		return UFloatArrayAttribute::StaticClass();
+	case prt::AAT_UNKNOWN:
+	case prt::AAT_VOID:
+
+	default:
+		return nullptr;
+	}
+}
+
+// Returns the attribute with the parsed annotations of the given schema entry, created on first use
+const URuleAttribute* GetTemplateAttribute(const Vitruvio::FAttributeSchemaEntry& Entry)
+{
+	check(IsInGameThread());
+
+	if (!Entry.TemplateAttribute)
+	{
+		URuleAttribute* Attribute = NewObject<URuleAttribute>(GetTransientPackage(), GetAttributeClass(Entry.AttributeInfo->getReturnType()));
+		Attribute->Name = Entry.AttributeName;
+		// The annotations are outered to the template so they are duplicated along with it
+		Vitruvio::ParseAttributeAnnotations(Entry.AttributeInfo, *Attribute, Attribute);
+
+		Attribute->DisplayName = Entry.DisplayName;
+		Attribute->ImportPath = Entry.ImportPath;
+		Attribute->ImportOrder = Entry.ImportOrder;
+		Entry.TemplateAttribute.Reset(Attribute);
+	}
+
+	return Entry.TemplateAttribute.Get();
+}
+
+// Writes the value of the given attribute from the PRT attribute map directly into the Unreal attribute, avoiding a temporary URuleAttribute
+void SetAttributeValue(URuleAttribute* Attribute, const AttributeMapUPtr& AttributeMap, const std::wstring& Name)
+{
+	if (UBoolAttribute* BoolAttribute = Cast<UBoolAttribute>(Attribute))
 	{
-		UBoolAttribute* BoolAttribute = NewObject<UBoolAttribute>(Outer);
 		BoolAttribute->Value = AttributeMap->getBool(Name.c_str());
-		BoolAttribute->SetFlags(RF_Transactional);
-		return BoolAttribute;
 	}
-	case prt::AAT_INT:
-	case prt::AAT_FLOAT:
+	else if (UFloatAttribute* FloatAttribute = Cast<UFloatAttribute>(Attribute))
 	{
-		UFloatAttribute* FloatAttribute = NewObject<UFloatAttribute>(Outer);
 		FloatAttribute->Value = AttributeMap->getFloat(Name.c_str());
-		FloatAttribute->SetFlags(RF_Transactional);
-		return FloatAttribute;
 	}
-	case prt::AAT_STR:
+	else if (UStringAttribute* StringAttribute = Cast<UStringAttribute>(Attribute))
 	{
-		UStringAttribute* StringAttribute = NewObject<UStringAttribute>(Outer);
 		StringAttribute->Value = WCHAR_TO_TCHAR(AttributeMap->getString(Name.c_str()));
-		StringAttribute->SetFlags(RF_Transactional);
-		return StringAttribute;
 	}
-	case prt::AAT_STR_ARRAY:
+	else if (UStringArrayAttribute* StringArrayAttribute = Cast<UStringArrayAttribute>(Attribute))
 	{
-		UStringArrayAttribute* StringArrayAttribute = NewObject<UStringArrayAttribute>(Outer);
 		size_t Count = 0;
 		const wchar_t* const* Arr = AttributeMap->getStringArray(Name.c_str(), &Count);
+		StringArrayAttribute->Values.Reset(static_cast<int32>(Count));
 		for (size_t Index = 0; Index < Count; Index++)
 		{
 			StringArrayAttribute->Values.Add(Arr[Index]);
 		}
-		StringArrayAttribute->SetFlags(RF_Transactional);
-		return StringArrayAttribute;
 	}
-	case prt::AAT_BOOL_ARRAY:
+	else if (UBoolArrayAttribute* BoolArrayAttribute = Cast<UBoolArrayAttribute>(Attribute))
 	{
-		UBoolArrayAttribute* BoolArrayAttribute = NewObject<UBoolArrayAttribute>(Outer);
 		size_t Count = 0;
 		const bool* Arr = AttributeMap->getBoolArray(Name.c_str(), &Count);
-		for (size_t Index = 0; Index < Count; Index++)
-		{
-			BoolArrayAttribute->Values.Add(Arr[Index]);
-		}
-		BoolArrayAttribute->SetFlags(RF_Transactional);
-		return BoolArrayAttribute;
+		BoolArrayAttribute->Values = TArray<bool>(Arr, static_cast<int32>(Count));
 	}
-	case prt::AAT_FLOAT_ARRAY:
+	else if (UFloatArrayAttribute* FloatArrayAttribute = Cast<UFloatArrayAttribute>(Attribute))
 	{
-		UFloatArrayAttribute* FloatArrayAttribute = NewObject<UFloatArrayAttribute>(Outer);
 		size_t Count = 0;
 		const double* Arr = AttributeMap->getFloatArray(Name.c_str(), &Count);
-		for (size_t Index = 0; Index < Count; Index++)
-		{
-			FloatArrayAttribute->Values.Add(Arr[Index]);
-		}
-		FloatArrayAttribute->SetFlags(RF_Transactional);
-		return FloatArrayAttribute;
-	}
-	case prt::AAT_UNKNOWN:
-	case prt::AAT_VOID:
-
-	default:
-		return nullptr;
+		FloatArrayAttribute->Values = TArray<double>(Arr, static_cast<int32>(Count));
 	}
 }
 
@@ -367,11 +380,10 @@ bool TryParseString(const FString& InStr, FString& OutValue)
 
 namespace Vitruvio
 {
-void UpdateAttributeMap(TMap<FString, URuleAttribute*>& AttributeMapOut, const AttributeMapUPtr& AttributeMap, const RuleFileInfoPtr& RuleInfo,
-                        UObject* const Outer)
+FAttributeSchema CreateAttributeSchema(const RuleFileInfoPtr& RuleInfo)
 {
-	bool bNeedsResorting = false;
-	TMap<FString, int> ImportOrderMap = ParseImportOrderMap(RuleInfo);
+	FAttributeSchema Schema;
+	const TMap<FString, int> ImportOrderMap = ParseImportOrderMap(RuleInfo);
 
 	for (size_t AttributeIndex = 0; AttributeIndex < RuleInfo->getNumAttributes(); AttributeIndex++)
 	{
@@ -388,43 +400,64 @@ void UpdateAttributeMap(TMap<FString, URuleAttribute*>& AttributeMapOut, const A
 			continue;
 		}
 
-		const std::wstring Name(AttrInfo->getName());
-		URuleAttribute* Attribute = ::CreateAttribute(AttributeMap, AttrInfo, Outer);
+		switch (AttrInfo->getReturnType())
+		{
+		case prt::AAT_BOOL:
+		case prt::AAT_INT:
+		case prt::AAT_FLOAT:
+		case prt::AAT_STR:
+		case prt::AAT_STR_ARRAY:
+		case prt::AAT_BOOL_ARRAY:
+		case prt::AAT_FLOAT_ARRAY:
+			break;
+		default:
+			continue;
+		}
 
-		if (Attribute)
+		if (IsAttributeHidden(AttrInfo))
 		{
-			const FString AttributeName = WCHAR_TO_TCHAR(Name.c_str());
-			Attribute->Name = AttributeName;
+			continue;
+		}
 
-			ParseAttributeAnnotations(AttrInfo, *Attribute, Outer);
-			if (!Attribute->bHidden)
+		FAttributeSchemaEntry& Entry = Schema.AddDefaulted_GetRef();
+		Entry.AttributeInfo = AttrInfo;
+		Entry.Name = AttrInfo->getName();
+		Entry.AttributeName = WCHAR_TO_TCHAR(Entry.Name.c_str());
+		Entry.DisplayName = WCHAR_TO_TCHAR(prtu::removeImport(prtu::removeStyle(Entry.Name.c_str())).c_str());
+		Entry.ImportPath = WCHAR_TO_TCHAR(prtu::getFullImportPath(Entry.Name.c_str()).c_str());
+		if (const int* ImportOrder = ImportOrderMap.Find(Entry.ImportPath))
+		{
+			Entry.ImportOrder = *ImportOrder;
+		}
+	}
+
+	return Schema;
+}
+
+void UpdateAttributeMap(TMap<FString, URuleAttribute*>& AttributeMapOut, const AttributeMapUPtr& AttributeMap, const FAttributeSchema& Schema,
+                        UObject* const Outer)
+{
+	bool bNeedsResorting = false;
+
+	for (const FAttributeSchemaEntry& Entry : Schema)
+	{
+		// update existing attributes in place, only attributes seen for the first time (or whose type has changed in the rule) are created
+		URuleAttribute** OutAttribute = AttributeMapOut.Find(Entry.AttributeName);
+		if (OutAttribute && (*OutAttribute)->GetClass() == GetAttributeClass(Entry.AttributeInfo->getReturnType()))
+		{
+			if (!(*OutAttribute)->bUserSet)
 			{
-				// update/add attributes if they aren't hidden
-				if (AttributeMapOut.Contains(AttributeName))
-				{
-					const URuleAttribute* OutAttribute = AttributeMapOut[AttributeName];
-					if (!OutAttribute->bUserSet)
-					{
-						AttributeMapOut[AttributeName]->CopyValue(Attribute);
-					}
-				}
-				else
-				{
-					const FString DisplayName = WCHAR_TO_TCHAR(prtu::removeImport(prtu::removeStyle(Name.c_str())).c_str());
-					const FString ImportPath = WCHAR_TO_TCHAR(prtu::getFullImportPath(Name.c_str()).c_str());
-
-					Attribute->DisplayName = DisplayName;
-					Attribute->ImportPath = ImportPath;
-					int* ImportOrder = ImportOrderMap.Find(ImportPath);
-					if (ImportOrder != nullptr)
-					{
-						Attribute->ImportOrder = *ImportOrder;
-					}
-					AttributeMapOut.Add(AttributeName, Attribute);
-					bNeedsResorting = true;
-				}
+				SetAttributeValue(*OutAttribute, AttributeMap, Entry.Name);
 			}
+			continue;
 		}
+
+		URuleAttribute* Attribute = DuplicateObject<URuleAttribute>(GetTemplateAttribute(Entry), Outer);
+		SetAttributeValue(Attribute, AttributeMap, Entry.Name);
+		Attribute->SetFlags(RF_Transactional);
+
+		AttributeMapOut.Add(Entry.AttributeName, Attribute);
+		bNeedsResorting = true;
 	}
 	if (bNeedsResorting)
 	{
@@ -18,9 +18,9 @@
 #include "MaterialConversion.h"
 #include "Runtime/Engine/Public/TextureResource.h"
 #include "Engine/Texture2D.h"
-#include "HAL/PlatformFileManager.h"
 #include "Runtime/ImageCore/Public/ImageCore.h"
 #include "VitruvioModule.h"
+#include "VitruvioTrace.h"
 #include "VitruvioTypes.h"
 #include "Async/Async.h"
 #include "UObject/Package.h"
@@ -174,17 +174,19 @@ class FLoadTextureTask
 {
 	TPromise<Vitruvio::FTextureData> Promise;
 	UObject* Outer;
-	TMap<FString, Vitruvio::FTextureData>& Cache;
-	FCriticalSection& CacheCriticalSection;
+	FTextureCache& Cache;
+	TMap<FString, Vitruvio::FTextureData>& LoadedTextures;
+	FCriticalSection& LoadedTexturesCriticalSection;
 
 	FString ImagePath;
 	FString TextureKey;
 
 public:
-	FLoadTextureTask(TPromise<Vitruvio::FTextureData>&& InPromise, UObject* Outer, TMap<FString, Vitruvio::FTextureData>& Cache,
-					 FCriticalSection& CacheCriticalSection, const FString& ImagePath, const FString& TextureKey)
-		: Promise(MoveTemp(InPromise)), Outer(Outer), Cache(Cache), CacheCriticalSection(CacheCriticalSection), ImagePath(ImagePath),
-		  TextureKey(TextureKey)
+	FLoadTextureTask(TPromise<Vitruvio::FTextureData>&& InPromise, UObject* Outer, FTextureCache& Cache,
+					 TMap<FString, Vitruvio::FTextureData>& LoadedTextures, FCriticalSection& LoadedTexturesCriticalSection,
+					 const FString& ImagePath, const FString& TextureKey)
+		: Promise(MoveTemp(InPromise)), Outer(Outer), Cache(Cache), LoadedTextures(LoadedTextures),
+		  LoadedTexturesCriticalSection(LoadedTexturesCriticalSection), ImagePath(ImagePath), TextureKey(TextureKey)
 	{
 	}
 
@@ -209,13 +211,14 @@ public:
 
 	void DoTask(ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
 	{
-		QUICK_SCOPE_CYCLE_COUNTER(STAT_MaterialConversion_LoadTexture);
+		VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_DecodeTexture, TEXT("%s"), *ImagePath);
 		FTaskTagScope Scope(ETaskTag::EParallelRenderingThread);
 		Vitruvio::FTextureData TextureData = VitruvioModule::Get().DecodeTexture(Outer, ImagePath, TextureKey);
+		Cache.Add(ImagePath, TextureData);
 		{
-			FScopeLock CacheLock(&CacheCriticalSection);
+			FScopeLock LoadedTexturesLock(&LoadedTexturesCriticalSection);
 
-			Cache.Add(ImagePath, TextureData);
+			LoadedTextures.Add(ImagePath, TextureData);
 		}
 
 		Promise.SetValue(TextureData);
@@ -229,14 +232,16 @@ namespace Vitruvio
 UMaterialInstanceDynamic* GameThread_CreateMaterialInstance(UObject* Outer, const FString& Name, UMaterialInterface* OpaqueParent,
 															UMaterialInterface* MaskedParent, UMaterialInterface* TranslucentParent,
 															const FMaterialAttributeContainer& MaterialContainer,
-															TMap<FString, FTextureData>& TextureCache)
+															FTextureCache& TextureCache)
 {
 	check(IsInGameThread());
 
 	TMap<FString, FGraphEventRef> TexturePropertyTasks;
 	TMap<FString, TFuture<FTextureData>> TextureProperties;
 
-	FCriticalSection CacheCriticalSection;
+	// Textures loaded by this call, the cache might already have evicted them again when textures used more than once are looked up
+	TMap<FString, FTextureData> LoadedTextures;
+	FCriticalSection LoadedTexturesCriticalSection;
 
 	for (const auto& TextureProperty : MaterialContainer.TextureProperties)
 	{
@@ -244,30 +249,9 @@ UMaterialInstanceDynamic* GameThread_CreateMaterialInstance(UObject* Outer, cons
 		TPromise<FTextureData> Promise;
 		TFuture<FTextureData> Future = Promise.GetFuture();
 
-		bool ValidCache = false;
-		{
-			FScopeLock CacheLock(&CacheCriticalSection);
-
-			auto Cached = TextureCache.Find(TexturePath);
-			if (Cached)
-			{
-				auto FileSystemTimeStamp = FPlatformFileManager::Get().GetPlatformFile().GetAccessTimeStamp(*TexturePath);
-				if (FileSystemTimeStamp > Cached->LoadTime)
-				{
-					// If the timestamp on the filesystem is newer than our cached version we have to evict it from the cache and reload the texture
-					// because it has changed
-					TextureCache.Remove(*TextureCache.FindKey(*Cached));
-				}
-				else
-				{
-					// Found a valid entry in the cache which we can just use
-					Promise.SetValue(*Cached);
-					ValidCache = true;
-				}
-			}
-		}
-
-		if (!ValidCache)
+		// Changed texture files are evicted from the cache by its directory watcher, so cached entries are always valid
+		FTextureData CachedTextureData;
+		if (TexturePropertyTasks.Contains(TexturePath) || !TextureCache.Find(TexturePath, CachedTextureData))
 		{
 			// No valid entry found in the cache so we have to load it from the disk
 			auto LoadTextureTask = TexturePropertyTasks.Find(TexturePath);
@@ -277,16 +261,19 @@ UMaterialInstanceDynamic* GameThread_CreateMaterialInstance(UObject* Outer, cons
 				Prerequisites.Add(*LoadTextureTask);
 				TGraphTask<TAsyncGraphTask<FTextureData>>::CreateTask(&Prerequisites)
 					.ConstructAndDispatchWhenReady(
-						[&TextureCache, TexturePath, &CacheCriticalSection]() {
-							FScopeLock CacheLock(&CacheCriticalSection);
-							return TextureCache[TexturePath];
+						[&LoadedTextures, TexturePath, &LoadedTexturesCriticalSection]() {
+							FScopeLock LoadedTexturesLock(&LoadedTexturesCriticalSection);
+							return LoadedTextures[TexturePath];
 						},
 						MoveTemp(Promise), ENamedThreads::AnyThread);
 			}
 			else if (!TexturePath.IsEmpty())
 			{
+				TextureCache.WatchTextureDirectory(TexturePath);
+
 				FGraphEventRef LoadTask = TGraphTask<FLoadTextureTask>::CreateTask().ConstructAndDispatchWhenReady(
-					MoveTemp(Promise), Outer, TextureCache, CacheCriticalSection, TextureProperty.Value, TextureProperty.Key);
+					MoveTemp(Promise), Outer, TextureCache, LoadedTextures, LoadedTexturesCriticalSection, TextureProperty.Value,
+					TextureProperty.Key);
 				TexturePropertyTasks.Add(TexturePath, LoadTask);
 			}
 			else
@@ -294,6 +281,10 @@ UMaterialInstanceDynamic* GameThread_CreateMaterialInstance(UObject* Outer, cons
 				Promise.SetValue({});
 			}
 		}
+		else
+		{
+			Promise.SetValue(CachedTextureData);
+		}
 
 		TextureProperties.Add(TextureProperty.Key, MoveTemp(Future));
 	}
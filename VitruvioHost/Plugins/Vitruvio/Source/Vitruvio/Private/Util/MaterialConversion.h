@@ -15,6 +15,7 @@
 
 #pragma once
 
+#include "TextureCache.h"
 #include "VitruvioTypes.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogMaterialConversion, Log, All);
@@ -24,5 +25,5 @@ namespace Vitruvio
 UMaterialInstanceDynamic* GameThread_CreateMaterialInstance(UObject* Outer, const FString& Name, UMaterialInterface* OpaqueParent,
 															UMaterialInterface* MaskedParent, UMaterialInterface* TranslucentParent,
 															const FMaterialAttributeContainer& MaterialAttributes,
-															TMap<FString, FTextureData>& TextureCache);
+															FTextureCache& TextureCache);
 }
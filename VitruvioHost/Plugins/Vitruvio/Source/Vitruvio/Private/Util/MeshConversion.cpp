@@ -0,0 +1,226 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MeshConversion.h"
+
+#include "VitruvioModule.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Math/VectorRegister.h"
+
+namespace
+{
+
+static_assert(sizeof(FVector3f) == 3 * sizeof(float), "Converted positions are written as packed floats");
+static_assert(sizeof(FVector2f) == 2 * sizeof(float), "Converted uvs are written as packed floats");
+
+// Indexed by EPrtUvSetType
+// clang-format off
+constexpr Vitruvio::EUnrealUvSetType PRTToUnrealUVSets[] = {
+	Vitruvio::EUnrealUvSetType::ColorMap,     // ColorMap
+	Vitruvio::EUnrealUvSetType::None,         // BumpMap
+	Vitruvio::EUnrealUvSetType::DirtMap,      // DirtMap
+	Vitruvio::EUnrealUvSetType::None,         // SpecularMap
+	Vitruvio::EUnrealUvSetType::OpacityMap,   // OpacityMap
+	Vitruvio::EUnrealUvSetType::NormalMap,    // NormalMap
+	Vitruvio::EUnrealUvSetType::EmissiveMap,  // EmissiveMap
+	Vitruvio::EUnrealUvSetType::None,         // OcclusionMap
+	Vitruvio::EUnrealUvSetType::RoughnessMap, // RoughnessMap
+	Vitruvio::EUnrealUvSetType::MetallicMap   // MetallicMap
+};
+// clang-format on
+
+static_assert(UE_ARRAY_COUNT(PRTToUnrealUVSets) == static_cast<int32>(Vitruvio::EPrtUvSetType::MetallicMap) + 1);
+
+} // namespace
+
+namespace Vitruvio
+{
+
+EUnrealUvSetType GetUnrealUVSet(size_t PrtUVSet)
+{
+	return PrtUVSet < UE_ARRAY_COUNT(PRTToUnrealUVSets) ? PRTToUnrealUVSets[PrtUVSet] : EUnrealUvSetType::None;
+}
+
+void ConvertPositions(const double* Src, int32 NumVertices, float Scale, const FVector3f& Offset, FVector3f* Dst)
+{
+	float* DstValues = reinterpret_cast<float*>(Dst);
+
+	// Four vertices (12 values) are converted per iteration. The loaded registers hold x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3 and are
+	// shuffled into x0 z0 y0 x1 | z1 y1 x2 z2 | y2 x3 z3 y3, so the offset has to be rotated the same way.
+	const VectorRegister4Float ScaleVector = VectorSetFloat1(Scale);
+	const VectorRegister4Float NegOffset0 = MakeVectorRegisterFloat(-Offset.X, -Offset.Y, -Offset.Z, -Offset.X);
+	const VectorRegister4Float NegOffset1 = MakeVectorRegisterFloat(-Offset.Y, -Offset.Z, -Offset.X, -Offset.Y);
+	const VectorRegister4Float NegOffset2 = MakeVectorRegisterFloat(-Offset.Z, -Offset.X, -Offset.Y, -Offset.Z);
+
+	int32 VertexIndex = 0;
+	for (; VertexIndex + 4 <= NumVertices; VertexIndex += 4)
+	{
+		const double* Values = Src + VertexIndex * 3;
+		const VectorRegister4Float In0 = MakeVectorRegisterFloatFromDouble(VectorLoad(Values));
+		const VectorRegister4Float In1 = MakeVectorRegisterFloatFromDouble(VectorLoad(Values + 4));
+		const VectorRegister4Float In2 = MakeVectorRegisterFloatFromDouble(VectorLoad(Values + 8));
+
+		const VectorRegister4Float Out0 = VectorSwizzle(In0, 0, 2, 1, 3);
+		const VectorRegister4Float Out1 = VectorShuffle(In1, VectorShuffle(In1, In2, 2, 2, 0, 0), 1, 0, 0, 2);
+		const VectorRegister4Float Out2 = VectorShuffle(VectorShuffle(In1, In2, 3, 3, 1, 1), In2, 0, 2, 3, 2);
+
+		float* OutValues = DstValues + VertexIndex * 3;
+		VectorStore(VectorMultiplyAdd(Out0, ScaleVector, NegOffset0), OutValues);
+		VectorStore(VectorMultiplyAdd(Out1, ScaleVector, NegOffset1), OutValues + 4);
+		VectorStore(VectorMultiplyAdd(Out2, ScaleVector, NegOffset2), OutValues + 8);
+	}
+
+	for (; VertexIndex < NumVertices; ++VertexIndex)
+	{
+		const double* Values = Src + VertexIndex * 3;
+		Dst[VertexIndex] = FVector3f(Values[0], Values[2], Values[1]) * Scale - Offset;
+	}
+}
+
+void ConvertNormals(const double* Src, int32 NumNormals, FVector3f* Dst)
+{
+	ConvertPositions(Src, NumNormals, 1.0f, FVector3f::ZeroVector, Dst);
+}
+
+void ConvertUVs(const double* Src, int32 NumUVs, FVector2f* Dst)
+{
+	float* DstValues = reinterpret_cast<float*>(Dst);
+
+	// Four uvs (8 values) are converted per iteration
+	const VectorRegister4Float FlipV = MakeVectorRegisterFloat(1.0f, -1.0f, 1.0f, -1.0f);
+
+	int32 UVIndex = 0;
+	for (; UVIndex + 4 <= NumUVs; UVIndex += 4)
+	{
+		const double* Values = Src + UVIndex * 2;
+		const VectorRegister4Float In0 = MakeVectorRegisterFloatFromDouble(VectorLoad(Values));
+		const VectorRegister4Float In1 = MakeVectorRegisterFloatFromDouble(VectorLoad(Values + 4));
+
+		float* OutValues = DstValues + UVIndex * 2;
+		VectorStore(VectorMultiply(In0, FlipV), OutValues);
+		VectorStore(VectorMultiply(In1, FlipV), OutValues + 4);
+	}
+
+	for (; UVIndex < NumUVs; ++UVIndex)
+	{
+		const double* Values = Src + UVIndex * 2;
+		Dst[UVIndex] = FVector2f(Values[0], -Values[1]);
+	}
+}
+
+} // namespace Vitruvio
+
+#if !UE_BUILD_SHIPPING
+namespace
+{
+// Returns the best time in seconds of a few runs of Func
+template <typename FuncType>
+double MeasureBestSeconds(FuncType&& Func)
+{
+	constexpr int32 NumIterations = 5;
+
+	double BestSeconds = TNumericLimits<double>::Max();
+	for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		const double StartSeconds = FPlatformTime::Seconds();
+		Func();
+		BestSeconds = FMath::Min(BestSeconds, FPlatformTime::Seconds() - StartSeconds);
+	}
+	return BestSeconds;
+}
+
+// The vectorized conversion might round differently than the per element one, eg. by using fused multiply adds
+template <typename VectorType>
+float GetMaxDifference(const TArray<VectorType>& Converted, const TArray<VectorType>& Expected)
+{
+	float MaxDifference = 0.0f;
+	for (int32 Index = 0; Index < Converted.Num(); ++Index)
+	{
+		MaxDifference = FMath::Max(MaxDifference, (Converted[Index] - Expected[Index]).GetAbsMax());
+	}
+	return MaxDifference;
+}
+
+// Runs on synthetic data: the kernels do the same arithmetic for every element without branching on the values, so their cost only depends on
+// the number of elements. Random values in the range of generated coordinates are enough to compare the rounding with the per element conversion.
+FAutoConsoleCommand BenchmarkMeshConversionCommand(
+	TEXT("Esri.Vitruvio.BenchmarkMeshConversion"),
+	TEXT("Logs the throughput of the position, normal and uv conversion compared to a per element conversion for common mesh sizes (on synthetic data)."),
+	FConsoleCommandDelegate::CreateLambda([]() {
+		const int32 Sizes[] = {1000, 100000, 1000000};
+		constexpr float Scale = 100.0f;
+		const FVector3f Offset(12.5f, -3.0f, 7.25f);
+
+		FRandomStream Random(0);
+		for (const int32 Size : Sizes)
+		{
+			TArray<double> Src;
+			Src.SetNumUninitialized(Size * 3);
+			for (double& Value : Src)
+			{
+				Value = Random.FRandRange(-1000.0f, 1000.0f);
+			}
+
+			TArray<FVector3f> Vectors;
+			TArray<FVector3f> ScalarVectors;
+			Vectors.SetNumUninitialized(Size);
+			ScalarVectors.SetNumUninitialized(Size);
+			TArray<FVector2f> UVs;
+			TArray<FVector2f> ScalarUVs;
+			UVs.SetNumUninitialized(Size);
+			ScalarUVs.SetNumUninitialized(Size);
+
+			const double PositionSeconds = MeasureBestSeconds([&]() { Vitruvio::ConvertPositions(Src.GetData(), Size, Scale, Offset, Vectors.GetData()); });
+			const double ScalarPositionSeconds = MeasureBestSeconds([&]() {
+				for (int32 Index = 0; Index < Size; ++Index)
+				{
+					const double* Values = Src.GetData() + Index * 3;
+					ScalarVectors[Index] = FVector3f(Values[0], Values[2], Values[1]) * Scale - Offset;
+				}
+			});
+			const float PositionDifference = GetMaxDifference(Vectors, ScalarVectors);
+
+			const double NormalSeconds = MeasureBestSeconds([&]() { Vitruvio::ConvertNormals(Src.GetData(), Size, Vectors.GetData()); });
+			const double ScalarNormalSeconds = MeasureBestSeconds([&]() {
+				for (int32 Index = 0; Index < Size; ++Index)
+				{
+					const double* Values = Src.GetData() + Index * 3;
+					ScalarVectors[Index] = FVector3f(Values[0], Values[2], Values[1]);
+				}
+			});
+			const float NormalDifference = GetMaxDifference(Vectors, ScalarVectors);
+
+			const double UVSeconds = MeasureBestSeconds([&]() { Vitruvio::ConvertUVs(Src.GetData(), Size, UVs.GetData()); });
+			const double ScalarUVSeconds = MeasureBestSeconds([&]() {
+				for (int32 Index = 0; Index < Size; ++Index)
+				{
+					const double* Values = Src.GetData() + Index * 2;
+					ScalarUVs[Index] = FVector2f(Values[0], -Values[1]);
+				}
+			});
+			const float UVDifference = GetMaxDifference(UVs, ScalarUVs);
+
+			UE_LOG(LogUnrealPrt, Display, TEXT("Mesh conversion %d positions: %.3f ms (per element %.3f ms, max difference %g)"), Size,
+				   PositionSeconds * 1000.0, ScalarPositionSeconds * 1000.0, PositionDifference)
+			UE_LOG(LogUnrealPrt, Display, TEXT("Mesh conversion %d normals: %.3f ms (per element %.3f ms, max difference %g)"), Size,
+				   NormalSeconds * 1000.0, ScalarNormalSeconds * 1000.0, NormalDifference)
+			UE_LOG(LogUnrealPrt, Display, TEXT("Mesh conversion %d uvs: %.3f ms (per element %.3f ms, max difference %g)"), Size,
+				   UVSeconds * 1000.0, ScalarUVSeconds * 1000.0, UVDifference)
+		}
+	}));
+} // namespace
+#endif
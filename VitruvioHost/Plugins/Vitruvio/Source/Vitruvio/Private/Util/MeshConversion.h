@@ -0,0 +1,59 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "VitruvioTypes.h"
+
+namespace Vitruvio
+{
+
+/**
+ * Returns the Unreal uv channel a PRT uv set is written to or EUnrealUvSetType::None if the uv set is not used in Unreal.
+ *
+ * @param PrtUVSet	Index of the PRT uv set
+ */
+EUnrealUvSetType GetUnrealUVSet(size_t PrtUVSet);
+
+/**
+ * Converts interleaved PRT positions (right-handed, y-up, meters) to Unreal positions (left-handed, z-up, centimeters).
+ *
+ * @param Src			Interleaved xyz coordinates, 3 * NumVertices values
+ * @param NumVertices	Number of vertices to convert
+ * @param Scale			Scale applied to the converted positions
+ * @param Offset		Offset subtracted from the scaled positions
+ * @param Dst			Output positions, NumVertices values
+ */
+void ConvertPositions(const double* Src, int32 NumVertices, float Scale, const FVector3f& Offset, FVector3f* Dst);
+
+/**
+ * Converts interleaved PRT normals to Unreal normals by swapping the y and z components. Normals are not normalized.
+ *
+ * @param Src			Interleaved xyz coordinates, 3 * NumNormals values
+ * @param NumNormals	Number of normals to convert
+ * @param Dst			Output normals, NumNormals values
+ */
+void ConvertNormals(const double* Src, int32 NumNormals, FVector3f* Dst);
+
+/**
+ * Converts interleaved PRT uvs to Unreal uvs by flipping the v component.
+ *
+ * @param Src		Interleaved uv coordinates, 2 * NumUVs values
+ * @param NumUVs	Number of uvs to convert
+ * @param Dst		Output uvs, NumUVs values
+ */
+void ConvertUVs(const double* Src, int32 NumUVs, FVector2f* Dst);
+
+} // namespace Vitruvio
@@ -0,0 +1,68 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ShapeCanonicalization.h"
+
+#include "VitruvioModule.h"
+
+namespace
+{
+
+// In cm, rotated copies of a polygon only differ by rounding errors far below this
+constexpr double CanonicalGridSize = 0.1;
+
+FVector SnapToCanonicalGrid(const FVector& Vertex)
+{
+	return FVector(FMath::GridSnap(Vertex.X, CanonicalGridSize), FMath::GridSnap(Vertex.Y, CanonicalGridSize),
+				   FMath::GridSnap(Vertex.Z, CanonicalGridSize));
+}
+
+} // namespace
+
+namespace Vitruvio
+{
+
+FTransform CanonicalizeInitialShape(const FInitialShape& InitialShape, FInitialShape& OutCanonicalShape)
+{
+	OutCanonicalShape = InitialShape;
+	OutCanonicalShape.Position = FVector::ZeroVector;
+	OutCanonicalShape.OutputCluster = 0;
+
+	const TArray<FVector>& Vertices = InitialShape.Polygon.Vertices;
+	if (Vertices.IsEmpty() || InitialShape.Polygon.Faces.IsEmpty() || InitialShape.Polygon.Faces[0].Indices.IsEmpty())
+	{
+		return FTransform(InitialShape.Position);
+	}
+
+	const TArray<int32>& FirstFaceIndices = InitialShape.Polygon.Faces[0].Indices;
+	const FVector& FirstVertex = Vertices[FirstFaceIndices[0]];
+
+	double Angle = 0.0;
+	if (FirstFaceIndices.Num() > 1)
+	{
+		const FVector FirstEdge = Vertices[FirstFaceIndices[1]] - FirstVertex;
+		Angle = FMath::Atan2(FirstEdge.Y, FirstEdge.X);
+	}
+	const FQuat Rotation(FVector::UpVector, Angle);
+
+	for (FVector& Vertex : OutCanonicalShape.Polygon.Vertices)
+	{
+		Vertex = SnapToCanonicalGrid(Rotation.UnrotateVector(Vertex - FirstVertex));
+	}
+
+	return FTransform(Rotation, InitialShape.Position + FirstVertex);
+}
+
+} // namespace Vitruvio
@@ -0,0 +1,36 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FInitialShape;
+
+namespace Vitruvio
+{
+
+/**
+ * Moves an initial shape into its canonical frame: the first vertex of the first face at the origin and the first edge along the x axis. The
+ * canonical vertices are snapped to a millimeter grid, so initial shapes which only differ by a translation and a rotation about the up axis
+ * have bitwise identical canonical shapes.
+ *
+ * @param InitialShape			The initial shape to canonicalize
+ * @param OutCanonicalShape		The canonical shape, a copy of the initial shape with the canonical polygon and a zero position
+ * @return the transform from the canonical frame to the initial shape
+ */
+FTransform CanonicalizeInitialShape(const FInitialShape& InitialShape, FInitialShape& OutCanonicalShape);
+
+} // namespace Vitruvio
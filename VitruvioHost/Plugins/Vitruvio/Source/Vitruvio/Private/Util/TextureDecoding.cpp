@@ -15,13 +15,23 @@
 
 #include "TextureDecoding.h"
 #include "Engine/TextureDefines.h"
-#include "HAL/PlatformFileManager.h"
 #include "Engine/Texture2D.h"
 #include "Runtime/Engine/Public/TextureResource.h"
 #include "UObject/Package.h"
+#include "VitruvioModule.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
 
 #include <string>
 
+#if defined(PLATFORM_ALWAYS_HAS_SSE4_1) && PLATFORM_ALWAYS_HAS_SSE4_1
+#include <smmintrin.h>
+#define VITRUVIO_DECODE_TEXTURE_SSE 1
+#else
+#define VITRUVIO_DECODE_TEXTURE_SSE 0
+#endif
+
 namespace
 {
 struct FTextureSettings
@@ -43,6 +53,166 @@ FTextureSettings GetTextureSettings(const FString& Key, EPixelFormat PixelFormat
 	bool IsGrayscale = PixelFormat == EPixelFormat::PF_G8 || PixelFormat == EPixelFormat::PF_G16 || EPixelFormat::PF_R32_FLOAT;
 	return {!IsGrayscale, TC_Default};
 }
+
+// Converts one row of PRT pixels into the Unreal pixel format returned by GetUnrealPixelFormat. Grayscale images are expanded to RGBA as
+// well, since texture params don't automatically update their sample method. The alpha of images without alpha band is 0.
+using FConvertRowFunction = void (*)(const uint8* RESTRICT Src, uint8* RESTRICT Dst, int32 Width);
+
+void ConvertRowGrey8(const uint8* RESTRICT Src, uint8* RESTRICT Dst, int32 Width)
+{
+	int32 X = 0;
+#if VITRUVIO_DECODE_TEXTURE_SSE
+	const __m128i Masks[4] = {_mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1),
+							  _mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1),
+							  _mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1),
+							  _mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1)};
+	for (; X + 16 <= Width; X += 16)
+	{
+		const __m128i Grey = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Src + X));
+		for (int32 Part = 0; Part < 4; ++Part)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Dst + (X + Part * 4) * 4), _mm_shuffle_epi8(Grey, Masks[Part]));
+		}
+	}
+#endif
+	for (; X < Width; ++X)
+	{
+		const uint32 Pixel = Src[X] * 0x00010101u;
+		FMemory::Memcpy(Dst + X * 4, &Pixel, sizeof(Pixel));
+	}
+}
+
+void ConvertRowRGB8(const uint8* RESTRICT Src, uint8* RESTRICT Dst, int32 Width)
+{
+	int32 X = 0;
+#if VITRUVIO_DECODE_TEXTURE_SSE
+	const __m128i Mask = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+	// Four pixels use 12 of the 16 loaded bytes, stop early enough to not read past the end of the row
+	for (; X + 6 <= Width; X += 4)
+	{
+		const __m128i RGB = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Src + X * 3));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(Dst + X * 4), _mm_shuffle_epi8(RGB, Mask));
+	}
+#endif
+	for (; X < Width; ++X)
+	{
+		const uint8* RGB = Src + X * 3;
+		const uint32 Pixel = RGB[2] | (RGB[1] << 8) | (RGB[0] << 16);
+		FMemory::Memcpy(Dst + X * 4, &Pixel, sizeof(Pixel));
+	}
+}
+
+void ConvertRowRGBA8(const uint8* RESTRICT Src, uint8* RESTRICT Dst, int32 Width)
+{
+	int32 X = 0;
+#if VITRUVIO_DECODE_TEXTURE_SSE
+	const __m128i Mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	for (; X + 4 <= Width; X += 4)
+	{
+		const __m128i RGBA = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Src + X * 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(Dst + X * 4), _mm_shuffle_epi8(RGBA, Mask));
+	}
+#endif
+	for (; X < Width; ++X)
+	{
+		uint32 Pixel;
+		FMemory::Memcpy(&Pixel, Src + X * 4, sizeof(Pixel));
+		Pixel = (Pixel & 0xFF00FF00u) | ((Pixel & 0x000000FFu) << 16) | ((Pixel >> 16) & 0x000000FFu);
+		FMemory::Memcpy(Dst + X * 4, &Pixel, sizeof(Pixel));
+	}
+}
+
+void ConvertRowGrey16(const uint8* RESTRICT Src, uint8* RESTRICT Dst, int32 Width)
+{
+	int32 X = 0;
+#if VITRUVIO_DECODE_TEXTURE_SSE
+	const __m128i Masks[4] = {_mm_setr_epi8(0, 1, 0, 1, 0, 1, -1, -1, 2, 3, 2, 3, 2, 3, -1, -1),
+							  _mm_setr_epi8(4, 5, 4, 5, 4, 5, -1, -1, 6, 7, 6, 7, 6, 7, -1, -1),
+							  _mm_setr_epi8(8, 9, 8, 9, 8, 9, -1, -1, 10, 11, 10, 11, 10, 11, -1, -1),
+							  _mm_setr_epi8(12, 13, 12, 13, 12, 13, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1)};
+	for (; X + 8 <= Width; X += 8)
+	{
+		const __m128i Grey = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Src + X * 2));
+		for (int32 Part = 0; Part < 4; ++Part)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Dst + (X + Part * 2) * 8), _mm_shuffle_epi8(Grey, Masks[Part]));
+		}
+	}
+#endif
+	for (; X < Width; ++X)
+	{
+		uint16 Grey;
+		FMemory::Memcpy(&Grey, Src + X * 2, sizeof(Grey));
+		const uint64 Pixel = Grey * 0x0000000100010001ull;
+		FMemory::Memcpy(Dst + X * 8, &Pixel, sizeof(Pixel));
+	}
+}
+
+// Converts 32 bit grayscale float textures to 16 bit RGBA float textures
+void ConvertRowFloat32(const uint8* RESTRICT Src, uint8* RESTRICT Dst, int32 Width)
+{
+	const float* Grey = reinterpret_cast<const float*>(Src);
+	FFloat16Color* Colors = reinterpret_cast<FFloat16Color*>(Dst);
+	const FFloat16 One(1.0f);
+
+	int32 X = 0;
+	uint16 Halfs[8];
+	for (; X + 8 <= Width; X += 8)
+	{
+		FPlatformMath::WideVectorStoreHalf(Halfs, Grey + X);
+		for (int32 Index = 0; Index < 8; ++Index)
+		{
+			FFloat16Color& Color = Colors[X + Index];
+			Color.R.Encoded = Halfs[Index];
+			Color.G.Encoded = Halfs[Index];
+			Color.B.Encoded = Halfs[Index];
+			Color.A = One;
+		}
+	}
+	for (; X < Width; ++X)
+	{
+		const FFloat16 Half(Grey[X]);
+		FFloat16Color& Color = Colors[X];
+		Color.R = Half;
+		Color.G = Half;
+		Color.B = Half;
+		Color.A = One;
+	}
+}
+
+FConvertRowFunction GetConvertRowFunction(Vitruvio::EPRTPixelFormat PixelFormat)
+{
+	switch (PixelFormat)
+	{
+	case Vitruvio::EPRTPixelFormat::GREY8:
+		return &ConvertRowGrey8;
+	case Vitruvio::EPRTPixelFormat::GREY16:
+		return &ConvertRowGrey16;
+	case Vitruvio::EPRTPixelFormat::FLOAT32:
+		return &ConvertRowFloat32;
+	case Vitruvio::EPRTPixelFormat::RGB8:
+		return &ConvertRowRGB8;
+	case Vitruvio::EPRTPixelFormat::RGBA8:
+		return &ConvertRowRGBA8;
+	default:
+		return nullptr;
+	}
+}
+
+void ConvertPixels(const Vitruvio::FTextureMetadata& TextureMetadata, const uint8* Src, uint8* Dst, SIZE_T DstBytesPerPixel)
+{
+	const FConvertRowFunction ConvertRow = GetConvertRowFunction(TextureMetadata.PixelFormat);
+	check(ConvertRow);
+
+	const SIZE_T SrcRowSize = TextureMetadata.Width * TextureMetadata.Bands * TextureMetadata.BytesPerBand;
+	const SIZE_T DstRowSize = TextureMetadata.Width * DstBytesPerPixel;
+	for (SIZE_T Y = 0; Y < TextureMetadata.Height; ++Y)
+	{
+		// PRT stores the rows bottom up
+		ConvertRow(Src + (TextureMetadata.Height - Y - 1) * SrcRowSize, Dst + Y * DstRowSize, static_cast<int32>(TextureMetadata.Width));
+	}
+}
+
 } // namespace
 
 namespace Vitruvio
@@ -126,48 +296,6 @@ FTextureData DecodeTexture(UObject* Outer, const FString& Key, const FString& Pa
 	EPixelFormat UnrealPixelFormat = GetUnrealPixelFormat(TextureMetadata.PixelFormat);
 	check(UnrealPixelFormat != EPixelFormat::PF_Unknown);
 
-	const size_t BytesPerBand = FMath::Min<size_t>(2, TextureMetadata.BytesPerBand);
-	const bool bIsColor = (TextureMetadata.Bands >= 3);
-
-	size_t NewBufferSize = TextureMetadata.Width * TextureMetadata.Height * 4 * BytesPerBand;
-	auto NewBuffer = std::make_unique<uint8_t[]>(NewBufferSize);
-
-	for (int Y = 0; Y < TextureMetadata.Height; ++Y)
-	{
-		for (int X = 0; X < TextureMetadata.Width; ++X)
-		{
-			if (TextureMetadata.PixelFormat == EPRTPixelFormat::FLOAT32)
-			{
-				// Convert 32 bit grayscale float textures to 16 bit RGBA float textures
-				const int OldOffset = ((TextureMetadata.Height - Y - 1) * TextureMetadata.Width + X) * TextureMetadata.Bands;
-				const int NewOffset = (Y * TextureMetadata.Width + X);
-				const float* FloatBuffer = reinterpret_cast<const float*>(Buffer.get());
-				FFloat16Color* NewFloat16Buffer = reinterpret_cast<FFloat16Color*>(NewBuffer.get());
-				const float Float32Value = FloatBuffer[OldOffset];
-				const FFloat16 Float16Value(Float32Value);
-				FFloat16Color Color;
-				Color.R = Float16Value;
-				Color.G = Float16Value;
-				Color.B = Float16Value;
-				Color.A = FFloat16(1.0f);
-				NewFloat16Buffer[NewOffset] = Color;
-			}
-			else
-			{
-				// Workaround: Also convert grayscale images to rgba, since texture params don't automatically update their sample method
-				const int OldOffset = ((TextureMetadata.Height - Y - 1) * TextureMetadata.Width + X) * TextureMetadata.Bands * BytesPerBand;
-				const int NewOffset = (Y * TextureMetadata.Width + X) * 4 * BytesPerBand;
-				for (int B = 0; B < BytesPerBand; ++B)
-				{
-					NewBuffer[NewOffset + 0 * BytesPerBand + B] = bIsColor ? Buffer[OldOffset + 2 + B] : Buffer[OldOffset + B];
-					NewBuffer[NewOffset + 1 * BytesPerBand + B] = bIsColor ? Buffer[OldOffset + 1 + B] : Buffer[OldOffset + B];
-					NewBuffer[NewOffset + 2 * BytesPerBand + B] = bIsColor ? Buffer[OldOffset + 0 + B] : Buffer[OldOffset + B];
-					NewBuffer[NewOffset + 3 * BytesPerBand + B] = (TextureMetadata.Bands == 4) ? Buffer[OldOffset + 3 + B] : 0;
-				}
-			}
-		}
-	}
-
 	const FTextureSettings Settings = GetTextureSettings(Key, UnrealPixelFormat);
 
 	const FString TextureBaseName = TEXT("T_") + FPaths::GetBaseFilename(Path);
@@ -189,14 +317,79 @@ FTextureData DecodeTexture(UObject* Outer, const FString& Key, const FString& Pa
 	Mip->SizeY = TextureMetadata.Height;
 	Mip->BulkData.Lock(LOCK_READ_WRITE);
 	void* TextureData = Mip->BulkData.Realloc(CalculateImageBytes(TextureMetadata.Width, TextureMetadata.Height, 0, UnrealPixelFormat));
-	FMemory::Memcpy(TextureData, NewBuffer.get(), NewBufferSize);
+	ConvertPixels(TextureMetadata, Buffer.get(), static_cast<uint8*>(TextureData), GPixelFormats[UnrealPixelFormat].BlockBytes);
 	Mip->BulkData.Unlock();
 
 	NewTexture->SetPlatformData(PlatformData);
 
 	NewTexture->UpdateResource();
 
-	const auto TimeStamp = FPlatformFileManager::Get().GetPlatformFile().GetAccessTimeStamp(*Path);
-	return FTextureData { NewTexture, static_cast<uint32>(TextureMetadata.Bands), TimeStamp };
+	return FTextureData { NewTexture, static_cast<uint32>(TextureMetadata.Bands) };
 }
 } // namespace Vitruvio
+
+#if !UE_BUILD_SHIPPING
+namespace
+{
+FAutoConsoleCommand BenchmarkTextureDecodingCommand(
+	TEXT("Esri.Vitruvio.BenchmarkTextureDecoding"), TEXT("Logs the pixel conversion throughput of texture decoding for common texture sizes."),
+	FConsoleCommandDelegate::CreateLambda([]() {
+		const TPair<Vitruvio::EPRTPixelFormat, const TCHAR*> PixelFormats[] = {{Vitruvio::EPRTPixelFormat::GREY8, TEXT("GREY8")},
+																			  {Vitruvio::EPRTPixelFormat::GREY16, TEXT("GREY16")},
+																			  {Vitruvio::EPRTPixelFormat::FLOAT32, TEXT("FLOAT32")},
+																			  {Vitruvio::EPRTPixelFormat::RGB8, TEXT("RGB8")},
+																			  {Vitruvio::EPRTPixelFormat::RGBA8, TEXT("RGBA8")}};
+		const int32 Sizes[] = {512, 2048, 4096};
+		constexpr int32 NumIterations = 5;
+
+		FRandomStream Random(0);
+		for (const auto& [PixelFormat, PixelFormatName] : PixelFormats)
+		{
+			const EPixelFormat UnrealPixelFormat = Vitruvio::GetUnrealPixelFormat(PixelFormat);
+			const SIZE_T DstBytesPerPixel = GPixelFormats[UnrealPixelFormat].BlockBytes;
+
+			for (const int32 Size : Sizes)
+			{
+				Vitruvio::FTextureMetadata TextureMetadata;
+				TextureMetadata.Width = Size;
+				TextureMetadata.Height = Size;
+				TextureMetadata.PixelFormat = PixelFormat;
+				TextureMetadata.Bands = PixelFormat == Vitruvio::EPRTPixelFormat::RGB8 ? 3 : PixelFormat == Vitruvio::EPRTPixelFormat::RGBA8 ? 4 : 1;
+				TextureMetadata.BytesPerBand = PixelFormat == Vitruvio::EPRTPixelFormat::GREY16 ? 2 : PixelFormat == Vitruvio::EPRTPixelFormat::FLOAT32 ? 4 : 1;
+
+				TArray<uint8> Src;
+				Src.SetNumUninitialized(Size * Size * TextureMetadata.Bands * TextureMetadata.BytesPerBand);
+				if (PixelFormat == Vitruvio::EPRTPixelFormat::FLOAT32)
+				{
+					float* Floats = reinterpret_cast<float*>(Src.GetData());
+					for (int32 Index = 0; Index < Size * Size; ++Index)
+					{
+						Floats[Index] = Random.FRand();
+					}
+				}
+				else
+				{
+					for (uint8& Byte : Src)
+					{
+						Byte = static_cast<uint8>(Random.RandHelper(256));
+					}
+				}
+
+				TArray<uint8> Dst;
+				Dst.SetNumUninitialized(Size * Size * DstBytesPerPixel);
+
+				double BestSeconds = TNumericLimits<double>::Max();
+				for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+				{
+					const double StartSeconds = FPlatformTime::Seconds();
+					ConvertPixels(TextureMetadata, Src.GetData(), Dst.GetData(), DstBytesPerPixel);
+					BestSeconds = FMath::Min(BestSeconds, FPlatformTime::Seconds() - StartSeconds);
+				}
+
+				UE_LOG(LogUnrealPrt, Display, TEXT("Texture decoding %s %dx%d: %.2f ms (%.0f MPixel/s)"), PixelFormatName, Size, Size,
+					   BestSeconds * 1000.0, Size * Size / BestSeconds / 1e6)
+			}
+		}
+	}));
+} // namespace
+#endif
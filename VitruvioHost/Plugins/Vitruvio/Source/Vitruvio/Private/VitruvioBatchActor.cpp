@@ -15,9 +15,26 @@
 
 #include "VitruvioBatchActor.h"
 
+#include "Algo/AllOf.h"
+#include "Algo/StableSort.h"
 #include "Materials/Material.h"
 #include "Runtime/CoreUObject/Public/UObject/ConstructorHelpers.h"
 #include "GenerateCompletedCallbackProxy.h"
+#include "HAL/IConsoleManager.h"
+#include "VitruvioBatchSubsystem.h"
+#include "VitruvioTrace.h"
+
+TAutoConsoleVariable<float> CVarBatchGenerateFrameBudget(TEXT("Esri.Vitruvio.BatchGenerateFrameBudget"), 5.0f,
+														 TEXT("The time in ms per frame the batch actor spends applying finished generate and attribute "
+															  "evaluation results. At least one unit of work is processed per frame."));
+
+namespace
+{
+FString GetTileTraceTag(const UTile& Tile)
+{
+	return FString::Printf(TEXT("Tile %d,%d"), Tile.Location.X, Tile.Location.Y);
+}
+} // namespace
 
 void UTile::MarkForAttributeEvaluation(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy)
 {
@@ -31,6 +48,7 @@ void UTile::MarkForAttributeEvaluation(UVitruvioComponent* VitruvioComponent, UG
 void UTile::UnmarkForAttributeEvaluation()
 {
 	bMarkedForEvaluateAttributes = false;
+	bAttributeEvaluationDeferred = false;
 }
 
 void UTile::MarkForGenerate(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy)
@@ -50,6 +68,8 @@ void UTile::MarkForGenerate(UVitruvioComponent* VitruvioComponent, UGenerateComp
 void UTile::UnmarkForGenerate()
 {
 	bMarkedForGenerate = false;
+	bInteractiveGenerate = false;
+	bGenerateDeferred = false;
 }
 
 void UTile::Add(UVitruvioComponent* VitruvioComponent)
@@ -108,12 +128,16 @@ void FGrid::MarkAllForAttributeEvaluation()
 	}
 }
 
-void FGrid::MarkForGenerate(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy)
+void FGrid::MarkForGenerate(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy, EPrtCallPriority Priority)
 {
 	if (UTile** FoundTile = TilesByComponent.Find(VitruvioComponent))
 	{
 		UTile* Tile = *FoundTile;
 		Tile->MarkForGenerate(VitruvioComponent, CallbackProxy);
+		if (Priority == EPrtCallPriority::Interactive)
+		{
+			Tile->bInteractiveGenerate = true;
+		}
 	}
 }
 
@@ -203,10 +227,15 @@ TArray<UTile*> FGrid::GetTilesMarkedForGenerate() const
 	TArray<UTile*> TilesToGenerate;
 	Tiles.GenerateValueArray(TilesToGenerate);
 
-	return TilesToGenerate.FilterByPredicate([](const UTile* Tile)
+	TilesToGenerate = TilesToGenerate.FilterByPredicate([](const UTile* Tile)
 	{
 		return Tile->bMarkedForGenerate;
 	});
+
+	// Interactive tiles first
+	Algo::StableSortBy(TilesToGenerate, [](const UTile* Tile) { return !Tile->bInteractiveGenerate; });
+
+	return TilesToGenerate;
 }
 
 TArray<UTile*> FGrid::GetTilesMarkedForAttributeEvaluation() const
@@ -236,45 +265,38 @@ void FGrid::UnmarkAllForAttributeEvaluation()
 	}
 }
 
-TArray<FInitialShape> FGrid::GetNeighboringShapes(const UTile* Tile, const TArray<FInitialShape>& InitialShapes)
+TArray<FInitialShape> FGrid::GetNeighboringShapes(const UTile* Tile, const TArray<FInitialShape>& InitialShapes, const FVitruvioSpatialIndex& SpatialIndex)
 {
 	TArray<FInitialShape> NeighboringShapes;
-	
-	const TArray Directions = {
-		FIntPoint(-1, 0), FIntPoint(1, 0), FIntPoint(0, -1), FIntPoint(0, 1),
-		FIntPoint(-1, -1), FIntPoint(-1, 1), FIntPoint(1, -1), FIntPoint(1, 1)
-	};
 
-	for (const FIntPoint& Dir : Directions)
+	const double QueryDistance = CVarInterOcclusionNeighborQueryDistance.GetValueOnAnyThread();
+
+	TArray<UVitruvioComponent*> NearbyComponents;
+	for (const FInitialShape& InputShape : InitialShapes)
 	{
-		FIntPoint NeighborPos = Tile->Location + Dir;
-		UTile** NeighborTilePtr = Tiles.Find(NeighborPos);
-		if (!NeighborTilePtr)
+		SpatialIndex.QueryRadius(InputShape.Position, QueryDistance, NearbyComponents);
+	}
+
+	TSet<UVitruvioComponent*> VisitedComponents;
+	for (UVitruvioComponent* VitruvioComponent : NearbyComponents)
+	{
+		bool bAlreadyVisited;
+		VisitedComponents.Add(VitruvioComponent, &bAlreadyVisited);
+		if (bAlreadyVisited)
 		{
 			continue;
 		}
-			
-		UTile* NeighborTile = *NeighborTilePtr;
-		auto [NeighborInitialShapes, _] = NeighborTile->GetInitialShapes([&InitialShapes](UVitruvioComponent* VitruvioComponent)
-		{
-			FVector Position = VitruvioComponent->GetOwner()->GetTransform().GetLocation();
-			for (const FInitialShape& InputShape : InitialShapes)
-			{
-				if (FVector::Dist(Position, InputShape.Position) < CVarInterOcclusionNeighborQueryDistance.GetValueOnAnyThread())
-				{
-					return true;
-				}
-			}
-
-			return false;
-		});
 
-		for (FInitialShape& NeighborShape : NeighborInitialShapes)
+		// Only batch generated components of other tiles, the components of this tile are already part of the generate call
+		UTile* const* NeighborTile = TilesByComponent.Find(VitruvioComponent);
+		if (!NeighborTile || *NeighborTile == Tile || !(*NeighborTile)->Contains(VitruvioComponent) || !VitruvioComponent->HasValidInputData())
 		{
-			NeighborShape.bOccluderOnly = true;
+			continue;
 		}
-		
-		NeighboringShapes.Append(MoveTemp(NeighborInitialShapes));
+
+		FInitialShape NeighborShape = VitruvioComponent->GetInitialShape();
+		NeighborShape.bOccluderOnly = true;
+		NeighboringShapes.Add(MoveTemp(NeighborShape));
 	}
 
 	return NeighboringShapes;
@@ -310,10 +332,60 @@ FIntPoint AVitruvioBatchActor::GetPosition(const UVitruvioComponent* VitruvioCom
 
 
 
+void AVitruvioBatchActor::AssignOutputClusters(TArray<FInitialShape>& InitialShapes) const
+{
+	switch (OutputGranularity)
+	{
+	case EBatchOutputGranularity::Tile:
+		return;
+	case EBatchOutputGranularity::InitialShape:
+	{
+		for (int32 Index = 0; Index < InitialShapes.Num(); ++Index)
+		{
+			InitialShapes[Index].OutputCluster = Index;
+		}
+		return;
+	}
+	case EBatchOutputGranularity::Cluster:
+	{
+		// Output clusters need to be dense, so the occupied cells are numbered in order of appearance
+		TMap<FIntPoint, int32> ClusterByCell;
+		const double CellSize = FMath::Max(ClusterSize, 1.0);
+		for (FInitialShape& InitialShape : InitialShapes)
+		{
+			const FIntPoint Cell(FMath::FloorToInt32(InitialShape.Position.X / CellSize), FMath::FloorToInt32(InitialShape.Position.Y / CellSize));
+			const int32 NextCluster = ClusterByCell.Num();
+			InitialShape.OutputCluster = ClusterByCell.FindOrAdd(Cell, NextCluster);
+		}
+		return;
+	}
+	}
+}
+
 void AVitruvioBatchActor::ProcessTiles()
 {
+	FPrtWorkerGovernor& PrtWorkerGovernor = VitruvioModule::Get().GetPrtWorkerGovernor();
+
 	for (UTile* Tile : Grid.GetTilesMarkedForGenerate())
 	{
+		const EPrtCallPriority Priority = Tile->bInteractiveGenerate ? EPrtCallPriority::Interactive : EPrtCallPriority::Background;
+
+		// Defer the remaining background tiles (they stay marked) until the PRT workers have caught up
+		if (Priority == EPrtCallPriority::Background && !PrtWorkerGovernor.CanAdmit())
+		{
+			if (!Tile->bGenerateDeferred)
+			{
+				Tile->bGenerateDeferred = true;
+				PrtWorkerGovernor.AddDeferredCall();
+			}
+			break;
+		}
+
+		Tile->UnmarkForGenerate();
+
+		// The partially applied result of this tile is outdated
+		GenerateProgresses.RemoveAll([Tile](const FBatchGenerateProgress& Progress) { return Progress.Item.Tile == Tile; });
+
 		// Initialize and cleanup the model component
 		UGeneratedModelStaticMeshComponent* VitruvioModelComponent = Tile->GeneratedModelComponent;
 		if (VitruvioModelComponent)
@@ -345,6 +417,8 @@ void AVitruvioBatchActor::ProcessTiles()
 		auto [InitialShapes, InitialShapeVitruvioComponents] = Tile->GetInitialShapes();
 		if (!InitialShapes.IsEmpty())
 		{
+			AssignOutputClusters(InitialShapes);
+
 			if (Tile->EvalAttributesToken)
 			{
 				Tile->EvalAttributesToken->Invalidate();
@@ -357,10 +431,12 @@ void AVitruvioBatchActor::ProcessTiles()
 			TArray<FInitialShape> OccluderOnlyShapes;
 			if (bEnableOcclusionQueries)
 			{
-				OccluderOnlyShapes = Grid.GetNeighboringShapes(Tile, InitialShapes);
+				const FVitruvioSpatialIndex& SpatialIndex = GetWorld()->GetSubsystem<UVitruvioBatchSubsystem>()->GetSpatialIndex();
+				OccluderOnlyShapes = Grid.GetNeighboringShapes(Tile, InitialShapes, SpatialIndex);
 			}
 			
-			FBatchGenerateResult GenerateResult = VitruvioModule::Get().BatchGenerateAsync(MoveTemp(InitialShapes), bEnableOcclusionQueries, MoveTemp(OccluderOnlyShapes));
+			FBatchGenerateResult GenerateResult = VitruvioModule::Get().BatchGenerateAsync(MoveTemp(InitialShapes), bEnableOcclusionQueries, MoveTemp(OccluderOnlyShapes), Priority,
+																						   bInstanceIdenticalInitialShapes, GetTileTraceTag(*Tile));
 			
 			Tile->GenerateToken = GenerateResult.Token;
 			Tile->bIsGenerating = true;
@@ -391,6 +467,18 @@ void AVitruvioBatchActor::ProcessTiles()
 
 	for (UTile* Tile : Grid.GetTilesMarkedForAttributeEvaluation())
 	{
+		if (!PrtWorkerGovernor.CanAdmit())
+		{
+			if (!Tile->bAttributeEvaluationDeferred)
+			{
+				Tile->bAttributeEvaluationDeferred = true;
+				PrtWorkerGovernor.AddDeferredCall();
+			}
+			break;
+		}
+
+		Tile->UnmarkForAttributeEvaluation();
+
 		auto [InitialShapes, InitialShapeVitruvioComponents] = Tile->GetInitialShapes();
 		if (!InitialShapes.IsEmpty())
 		{
@@ -399,7 +487,7 @@ void AVitruvioBatchActor::ProcessTiles()
 				Tile->EvalAttributesToken->Invalidate();
 			}
 			
-			FAttributeMapsResult AttributeMapsResult = VitruvioModule::Get().BatchEvaluateRuleAttributesAsync(MoveTemp(InitialShapes));
+			FAttributeMapsResult AttributeMapsResult = VitruvioModule::Get().BatchEvaluateRuleAttributesAsync(MoveTemp(InitialShapes), GetTileTraceTag(*Tile));
 			
 			Tile->EvalAttributesToken = AttributeMapsResult.Token;
 			Tile->bIsEvaluatingAttributes = true;
@@ -425,50 +513,69 @@ void AVitruvioBatchActor::ProcessTiles()
 			});
 		}
 	}
-	
-	Grid.UnmarkAllForGenerate();
-	Grid.UnmarkAllForAttributeEvaluation();
 }
 
-void AVitruvioBatchActor::ProcessGenerateQueue()
+bool AVitruvioBatchActor::ProcessGenerateProgress(FBatchGenerateProgress& Progress)
 {
-	ProcessGenerateQueueCriticalSection.Lock();
-	
-	if (!GenerateQueue.IsEmpty())
+	FBatchGenerateQueueItem& Item = Progress.Item;
+	UGeneratedModelStaticMeshComponent* VitruvioModelComponent = Item.Tile->GeneratedModelComponent;
+
+	switch (Progress.Stage)
 	{
-		FBatchGenerateQueueItem Item;
-		GenerateQueue.Dequeue(Item);
+	case EBatchGenerateStage::UpdateAttributes:
+	{
+		if (Item.GenerateResultDescription.EvaluatedAttributes.Num() == Item.VitruvioComponents.Num() &&
+			Progress.NextIndex < Item.VitruvioComponents.Num())
+		{
+			VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_UpdateAttributes, TEXT("Tile %d,%d"), Item.Tile->Location.X, Item.Tile->Location.Y);
 
-		ProcessGenerateQueueCriticalSection.Unlock();
+			const int32 ComponentIndex = Progress.NextIndex++;
+			UVitruvioComponent* VitruvioComponent = Item.VitruvioComponents[ComponentIndex];
+			Item.GenerateResultDescription.EvaluatedAttributes[ComponentIndex]->UpdateUnrealAttributeMap(VitruvioComponent->Attributes, VitruvioComponent);
+			VitruvioComponent->bAttributesReady = true;
+			VitruvioComponent->NotifyAttributesChanged();
+			return false;
+		}
 
-		if (Item.GenerateResultDescription.EvaluatedAttributes.Num() ==  Item.VitruvioComponents.Num())
+		Progress.MeshesToBuild = GetMeshesToBuild(Item.GenerateResultDescription);
+		Progress.NextIndex = 0;
+		Progress.Stage = EBatchGenerateStage::BuildMeshes;
+		return false;
+	}
+	case EBatchGenerateStage::BuildMeshes:
+	{
+		if (Progress.NextIndex < Progress.MeshesToBuild.Num())
 		{
-			for (int ComponentIndex = 0; ComponentIndex < Item.VitruvioComponents.Num(); ++ComponentIndex)
-			{
-				UVitruvioComponent* VitruvioComponent = Item.VitruvioComponents[ComponentIndex];
-				Item.GenerateResultDescription.EvaluatedAttributes[ComponentIndex]->UpdateUnrealAttributeMap(VitruvioComponent->Attributes, VitruvioComponent);
-				VitruvioComponent->bAttributesReady = true;
-				VitruvioComponent->NotifyAttributesChanged();
-			}
+			const auto& [Name, Mesh] = Progress.MeshesToBuild[Progress.NextIndex++];
+			Mesh->BuildAsync(Name, VitruvioModule::Get().GetMaterialCache(), VitruvioModule::Get().GetTextureCache(), Progress.MaterialIdentifiers,
+							 Progress.UniqueMaterialIdentifiers, OpaqueParent, MaskedParent, TranslucentParent, GetWorld(), {});
+			return false;
 		}
 
-		UGeneratedModelStaticMeshComponent* VitruvioModelComponent = Item.Tile->GeneratedModelComponent;
-
-		const FConvertedGenerateResult ConvertedResult = BuildGenerateResult(Item.GenerateResultDescription,
-	VitruvioModule::Get().GetMaterialCache(), VitruvioModule::Get().GetTextureCache(),
-				MaterialIdentifiers, UniqueMaterialIdentifiers, OpaqueParent, MaskedParent, TranslucentParent, GetWorld());
+		Progress.Stage = EBatchGenerateStage::WaitForMeshes;
+		return false;
+	}
+	case EBatchGenerateStage::WaitForMeshes:
+	{
+		Progress.Stage = EBatchGenerateStage::ConvertResult;
+		return false;
+	}
+	case EBatchGenerateStage::ConvertResult:
+	{
+		FConvertedGenerateResult ConvertedResult = ConvertGenerateResult(Item.GenerateResultDescription, VitruvioModule::Get().GetMaterialCache(),
+			VitruvioModule::Get().GetTextureCache(), Progress.MaterialIdentifiers, Progress.UniqueMaterialIdentifiers, OpaqueParent, MaskedParent, TranslucentParent);
 
 		if (ConvertedResult.ShapeMesh)
 		{
 			VitruvioModelComponent->SetStaticMesh(ConvertedResult.ShapeMesh->GetStaticMesh());
-			
+
 			// Reset Material replacements
 			for (int32 MaterialIndex = 0; MaterialIndex < VitruvioModelComponent->GetNumMaterials(); ++MaterialIndex)
 			{
 				VitruvioModelComponent->SetMaterial(MaterialIndex, VitruvioModelComponent->GetStaticMesh()->GetMaterial(MaterialIndex));
 			}
 
-			ApplyMaterialReplacements(VitruvioModelComponent, MaterialIdentifiers, MaterialReplacement);
+			ApplyMaterialReplacements(VitruvioModelComponent, Progress.MaterialIdentifiers, MaterialReplacement);
 		}
 
 		// Cleanup old hierarchical instances
@@ -479,22 +586,63 @@ void AVitruvioBatchActor::ProcessGenerateQueue()
 			InstanceComponent->DestroyComponent(true);
 		}
 
-		TMap<FString, int32> NameMap;
-		TSet<FInstance> Replaced = ApplyInstanceReplacements(VitruvioModelComponent, ConvertedResult.Instances, InstanceReplacement, NameMap);
-		for (const FInstance& Instance : ConvertedResult.Instances)
+		Progress.ClusterModels = Item.GenerateResultDescription.ClusterModels;
+		Progress.Instances = MoveTemp(ConvertedResult.Instances);
+		Progress.ReplacedInstances = ApplyInstanceReplacements(VitruvioModelComponent, Progress.Instances, InstanceReplacement, Progress.NameMap);
+		Progress.NextIndex = 0;
+		Progress.Stage = EBatchGenerateStage::RegisterClusters;
+		return false;
+	}
+	case EBatchGenerateStage::RegisterClusters:
+	{
+		while (Progress.NextIndex < Progress.ClusterModels.Num())
+		{
+			const TSharedPtr<FVitruvioMesh>& ClusterModel = Progress.ClusterModels[Progress.NextIndex++];
+			if (!ClusterModel || !ClusterModel->GetStaticMesh())
+			{
+				continue;
+			}
+
+			VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_RegisterClusters, TEXT("Tile %d,%d"), Item.Tile->Location.X, Item.Tile->Location.Y);
+
+			FString UniqueName = UniqueComponentName(TEXT("GeneratedModel"), Progress.NameMap);
+			auto ClusterComponent = NewObject<UGeneratedModelStaticMeshComponent>(VitruvioModelComponent, FName(UniqueName),
+																				  RF_Transient | RF_TextExportTransient | RF_DuplicateTransient);
+			ClusterComponent->SetStaticMesh(ClusterModel->GetStaticMesh());
+			ApplyMaterialReplacements(ClusterComponent, Progress.MaterialIdentifiers, MaterialReplacement);
+
+			// Attach and register cluster component
+			ClusterComponent->AttachToComponent(VitruvioModelComponent, FAttachmentTransformRules::KeepRelativeTransform);
+			ClusterComponent->CreationMethod = EComponentCreationMethod::Instance;
+			RootComponent->GetOwner()->AddOwnedComponent(ClusterComponent);
+			ClusterComponent->OnComponentCreated();
+			ClusterComponent->RegisterComponent();
+			return false;
+		}
+
+		Progress.NextIndex = 0;
+		Progress.Stage = EBatchGenerateStage::RegisterInstances;
+		return false;
+	}
+	case EBatchGenerateStage::RegisterInstances:
+	{
+		while (Progress.NextIndex < Progress.Instances.Num())
 		{
-			if (Replaced.Contains(Instance))
+			const FInstance& Instance = Progress.Instances[Progress.NextIndex++];
+			if (Progress.ReplacedInstances.Contains(Instance))
 			{
 				continue;
 			}
 
-			FString UniqueName = UniqueComponentName(Instance.Name, NameMap);
+			VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_RegisterInstances, TEXT("Tile %d,%d"), Item.Tile->Location.X, Item.Tile->Location.Y);
+
+			FString UniqueName = UniqueComponentName(Instance.Name, Progress.NameMap);
 			auto InstancedComponent = NewObject<UGeneratedModelHISMComponent>(VitruvioModelComponent, FName(UniqueName),
 																			  RF_Transient | RF_TextExportTransient | RF_DuplicateTransient);
 			const TArray<FTransform>& Transforms = Instance.Transforms;
 			InstancedComponent->SetStaticMesh(Instance.InstanceMesh->GetStaticMesh());
 			InstancedComponent->SetMeshIdentifier(Instance.InstanceMesh->GetIdentifier());
-			
+
 			// Add all instance transforms
 			for (const FTransform& Transform : Transforms)
 			{
@@ -513,8 +661,14 @@ void AVitruvioBatchActor::ProcessGenerateQueue()
 			RootComponent->GetOwner()->AddOwnedComponent(InstancedComponent);
 			InstancedComponent->OnComponentCreated();
 			InstancedComponent->RegisterComponent();
+			return false;
 		}
 
+		Progress.Stage = EBatchGenerateStage::Finish;
+		return false;
+	}
+	case EBatchGenerateStage::Finish:
+	{
 		for (auto& [VitruvioComponent, CallbackProxy] : Item.Tile->GenerateCallbackProxies)
 		{
 			CallbackProxy->OnAttributesEvaluatedBlueprint.Broadcast();
@@ -526,17 +680,60 @@ void AVitruvioBatchActor::ProcessGenerateQueue()
 
 		Item.Tile->GenerateCallbackProxies.Empty();
 		Item.Tile->bIsGenerating = false;
+		return true;
 	}
-	else
-	{
-		ProcessGenerateQueueCriticalSection.Unlock();
 	}
 
+	return true;
+}
+
+void AVitruvioBatchActor::ProcessGenerateQueue(double Deadline)
+{
+	// Results of a tile are applied in order, so a newer result never gets overwritten by an older one which is still waiting for its meshes
+	TSet<UTile*> WaitingTiles;
+	int32 ProgressIndex = 0;
+
+	do
+	{
+		if (ProgressIndex == GenerateProgresses.Num())
+		{
+			FBatchGenerateQueueItem Item;
+			{
+				FScopeLock QueueLock(&ProcessGenerateQueueCriticalSection);
+				if (!GenerateQueue.Dequeue(Item))
+				{
+					break;
+				}
+			}
+
+			GenerateProgresses.AddDefaulted_GetRef().Item = MoveTemp(Item);
+		}
+
+		FBatchGenerateProgress& Progress = GenerateProgresses[ProgressIndex];
+
+		// The meshes are built on worker threads, check again next frame and continue with the next result
+		if (WaitingTiles.Contains(Progress.Item.Tile) ||
+			(Progress.Stage == EBatchGenerateStage::WaitForMeshes &&
+			 !Algo::AllOf(Progress.MeshesToBuild, [](const TTuple<FString, TSharedPtr<FVitruvioMesh>>& NameAndMesh) {
+				 return NameAndMesh.Get<1>()->IsBuilt();
+			 })))
+		{
+			WaitingTiles.Add(Progress.Item.Tile);
+			++ProgressIndex;
+			continue;
+		}
+
+		if (ProcessGenerateProgress(Progress))
+		{
+			GenerateProgresses.RemoveAt(ProgressIndex);
+		}
+	} while (FPlatformTime::Seconds() < Deadline);
+
 	if (GenerateAllCallbackProxy)
 	{
 		TArray<UTile*> Tiles;
 		Grid.Tiles.GenerateValueArray(Tiles);
-		bool bAllGenerated = Algo::NoneOf(Tiles, [](const UTile* Tile) { return Tile->bIsGenerating; });
+		bool bAllGenerated = Algo::NoneOf(Tiles, [](const UTile* Tile) { return Tile->bIsGenerating || Tile->bMarkedForGenerate; });
 		if (bAllGenerated)
 		{
 			GenerateAllCallbackProxy->OnGenerateCompleted.Broadcast();
@@ -545,37 +742,52 @@ void AVitruvioBatchActor::ProcessGenerateQueue()
 	}
 }
 
-void AVitruvioBatchActor::ProcessAttributeEvaluationQueue()
+void AVitruvioBatchActor::ProcessAttributeEvaluationQueue(double Deadline)
 {
-	ProcessAttributeEvaluationQueueCriticalSection.Lock();
-	
-	if (!AttributeEvaluationQueue.IsEmpty())
+	do
 	{
-		FEvaluateAttributesQueueItem Item;
-		AttributeEvaluationQueue.Dequeue(Item);
+		if (!AttributeEvaluationProgress)
+		{
+			FEvaluateAttributesQueueItem Item;
+			{
+				FScopeLock QueueLock(&ProcessAttributeEvaluationQueueCriticalSection);
+				if (!AttributeEvaluationQueue.Dequeue(Item))
+				{
+					break;
+				}
+			}
 
-		ProcessAttributeEvaluationQueueCriticalSection.Unlock();
+			AttributeEvaluationProgress.Emplace();
+			AttributeEvaluationProgress->Item = MoveTemp(Item);
+		}
 
-		for (int ComponentIndex = 0; ComponentIndex < Item.VitruvioComponents.Num(); ++ComponentIndex)
+		FEvaluateAttributesQueueItem& Item = AttributeEvaluationProgress->Item;
+		if (AttributeEvaluationProgress->NextIndex < Item.VitruvioComponents.Num())
 		{
+			VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_UpdateAttributes, TEXT("Tile %d,%d"), Item.Tile->Location.X, Item.Tile->Location.Y);
+
+			const int32 ComponentIndex = AttributeEvaluationProgress->NextIndex++;
 			UVitruvioComponent* VitruvioComponent = Item.VitruvioComponents[ComponentIndex];
 			Item.AttributeMaps[ComponentIndex]->UpdateUnrealAttributeMap(VitruvioComponent->Attributes, VitruvioComponent);
 			VitruvioComponent->bAttributesReady = true;
 			VitruvioComponent->NotifyAttributesChanged();
 		}
-	}
-	else
-	{
-		ProcessAttributeEvaluationQueueCriticalSection.Unlock();
-	}
+
+		if (AttributeEvaluationProgress->NextIndex >= Item.VitruvioComponents.Num())
+		{
+			AttributeEvaluationProgress.Reset();
+		}
+	} while (FPlatformTime::Seconds() < Deadline);
 }
 
 void AVitruvioBatchActor::Tick(float DeltaSeconds)
 {
 	ProcessTiles();
-	
-	ProcessAttributeEvaluationQueue();
-	ProcessGenerateQueue();
+
+	// Both queues make progress every frame even if the budget is already used up
+	const double Deadline = FPlatformTime::Seconds() + CVarBatchGenerateFrameBudget.GetValueOnGameThread() / 1000.0;
+	ProcessAttributeEvaluationQueue(Deadline);
+	ProcessGenerateQueue(Deadline);
 }
 
 void AVitruvioBatchActor::RegisterVitruvioComponent(UVitruvioComponent* VitruvioComponent, bool bGenerateModel)
@@ -597,6 +809,8 @@ void AVitruvioBatchActor::UnregisterVitruvioComponent(UVitruvioComponent* Vitruv
 
 void AVitruvioBatchActor::UnregisterAllVitruvioComponents()
 {
+	GenerateProgresses.Empty();
+	AttributeEvaluationProgress.Reset();
 	Grid.Clear();
 	VitruvioComponents.Empty();
 }
@@ -617,9 +831,9 @@ void AVitruvioBatchActor::EvaluateAllAttributes(UGenerateCompletedCallbackProxy*
 	Grid.MarkAllForAttributeEvaluation();
 }
 
-void AVitruvioBatchActor::Generate(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy)
+void AVitruvioBatchActor::Generate(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy, EPrtCallPriority Priority)
 {
-	Grid.MarkForGenerate(VitruvioComponent, CallbackProxy);
+	Grid.MarkForGenerate(VitruvioComponent, CallbackProxy, Priority);
 }
 
 void AVitruvioBatchActor::GenerateAll(UGenerateCompletedCallbackProxy* CallbackProxy)
@@ -658,6 +872,8 @@ void AVitruvioBatchActor::PostEditChangeProperty(FPropertyChangedEvent& Property
 	if (PropertyChangedEvent.MemberProperty &&
 		PropertyChangedEvent.MemberProperty->GetFName() == GET_MEMBER_NAME_CHECKED(AVitruvioBatchActor, GridDimension))
 	{
+		GenerateProgresses.Empty();
+		AttributeEvaluationProgress.Reset();
 		Grid.Clear();
 		Grid.RegisterAll(VitruvioComponents, this);
 	}
@@ -669,7 +885,10 @@ void AVitruvioBatchActor::PostEditChangeProperty(FPropertyChangedEvent& Property
 	
 	if (PropertyChangedEvent.Property->GetFName() == GET_MEMBER_NAME_CHECKED(UVitruvioComponent, MaterialReplacement) ||
 		PropertyChangedEvent.Property->GetFName() == GET_MEMBER_NAME_CHECKED(UVitruvioComponent, InstanceReplacement) ||
-		PropertyChangedEvent.MemberProperty->GetFName() == GET_MEMBER_NAME_CHECKED(AVitruvioBatchActor, bEnableOcclusionQueries))
+		PropertyChangedEvent.MemberProperty->GetFName() == GET_MEMBER_NAME_CHECKED(AVitruvioBatchActor, bEnableOcclusionQueries) ||
+		PropertyChangedEvent.MemberProperty->GetFName() == GET_MEMBER_NAME_CHECKED(AVitruvioBatchActor, bInstanceIdenticalInitialShapes) ||
+		PropertyChangedEvent.MemberProperty->GetFName() == GET_MEMBER_NAME_CHECKED(AVitruvioBatchActor, OutputGranularity) ||
+		PropertyChangedEvent.MemberProperty->GetFName() == GET_MEMBER_NAME_CHECKED(AVitruvioBatchActor, ClusterSize))
 	{
 		GenerateAll();
 	}
@@ -43,9 +43,10 @@ void UVitruvioBatchSubsystem::EvaluateAllAttributes(UGenerateCompletedCallbackPr
 	GetBatchActor()->EvaluateAllAttributes(CallbackProxy);
 }
 
-void UVitruvioBatchSubsystem::Generate(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy)
+void UVitruvioBatchSubsystem::Generate(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy,
+									  EPrtCallPriority Priority)
 {
-	GetBatchActor()->Generate(VitruvioComponent, CallbackProxy);
+	GetBatchActor()->Generate(VitruvioComponent, CallbackProxy, Priority);
 }
 
 void UVitruvioBatchSubsystem::GenerateAll(UGenerateCompletedCallbackProxy* CallbackProxy)
@@ -147,6 +148,8 @@ void UVitruvioBatchSubsystem::Deinitialize()
 	GEngine->OnActorsMoved().Remove(OnActorsMoved);
 	GEngine->OnLevelActorDeleted().Remove(OnActorDeleted);
 #endif
+
+	SpatialIndex.Empty();
 	
 	UWorldSubsystem::Deinitialize();
 }
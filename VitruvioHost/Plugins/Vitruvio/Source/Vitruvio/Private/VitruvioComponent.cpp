@@ -22,6 +22,7 @@
 #include "GeneratedModelStaticMeshComponent.h"
 #include "UnrealCallbacks.h"
 #include "VitruvioModule.h"
+#include "VitruvioTrace.h"
 #include "VitruvioTypes.h"
 
 #include "Algo/Transform.h"
@@ -273,9 +274,13 @@ void ApplyMaterialReplacements(UStaticMeshComponent* StaticMeshComponent, const
 	for (int32 MaterialIndex = 0; MaterialIndex < StaticMeshComponent->GetNumMaterials(); ++MaterialIndex)
 	{
 		const UMaterialInterface* SourceMaterial = StaticMeshComponent->GetMaterial(MaterialIndex);
-		FString MaterialIdentifier = MaterialIdentifiers[SourceMaterial];
+		const FString* MaterialIdentifier = MaterialIdentifiers.Find(SourceMaterial);
+		if (!MaterialIdentifier)
+		{
+			continue;
+		}
 
-		if (UMaterialInterface** Result = ReplacementMaterials.Find(MaterialIdentifier))
+		if (UMaterialInterface** Result = ReplacementMaterials.Find(*MaterialIdentifier))
 		{
 			UMaterialInterface* ReplacementMaterial = *Result;
 			StaticMeshComponent->SetMaterial(MaterialIndex, ReplacementMaterial);
@@ -383,31 +388,65 @@ TSet<FInstance> ApplyInstanceReplacements(UGeneratedModelStaticMeshComponent* Ge
 	return Replaced;
 }
 
-FConvertedGenerateResult BuildGenerateResult(const FGenerateResultDescription& GenerateResult,
-									 TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
-									 TMap<FString, Vitruvio::FTextureData>& TextureCache,
-									 TMap<UMaterialInterface*, FString>& MaterialIdentifiers,
-									 TMap<FString, int32>& UniqueMaterialIdentifiers,
-									 UMaterial* OpaqueParent, UMaterial* MaskedParent, UMaterial* TranslucentParent,
-									 UWorld* World)
+void BuildGenerateResultAsync(const FGenerateResultDescription& GenerateResult,
+							  TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
+							  FTextureCache& TextureCache, TMap<UMaterialInterface*, FString>& MaterialIdentifiers,
+							  TMap<FString, int32>& UniqueMaterialIdentifiers, UMaterial* OpaqueParent, UMaterial* MaskedParent,
+							  UMaterial* TranslucentParent, UWorld* World, TFunction<void()> OnBuilt)
 {
 	MaterialIdentifiers.Empty();
 	UniqueMaterialIdentifiers.Empty();
 
-	// Build all meshes
+	const TArray<TTuple<FString, TSharedPtr<FVitruvioMesh>>> MeshesToBuild = GetMeshesToBuild(GenerateResult);
+
+	// Holds one extra count until all builds have been started, so OnBuilt is only called once even if all meshes are already built
+	TSharedRef<int32> NumPendingMeshes = MakeShared<int32>(MeshesToBuild.Num() + 1);
+	const auto OnMeshBuilt = [NumPendingMeshes, OnBuilt = MoveTemp(OnBuilt)]() {
+		if (--(*NumPendingMeshes) == 0)
+		{
+			OnBuilt();
+		}
+	};
+
+	for (const auto& [Name, Mesh] : MeshesToBuild)
+	{
+		Mesh->BuildAsync(Name, MaterialCache, TextureCache, MaterialIdentifiers, UniqueMaterialIdentifiers, OpaqueParent, MaskedParent,
+						 TranslucentParent, World, OnMeshBuilt);
+	}
+
+	OnMeshBuilt();
+}
+
+TArray<TTuple<FString, TSharedPtr<FVitruvioMesh>>> GetMeshesToBuild(const FGenerateResultDescription& GenerateResult)
+{
+	TArray<TTuple<FString, TSharedPtr<FVitruvioMesh>>> Meshes;
 	if (GenerateResult.GeneratedModel)
 	{
-		GenerateResult.GeneratedModel->Build(TEXT("GeneratedModel"), MaterialCache, TextureCache, MaterialIdentifiers, UniqueMaterialIdentifiers,
-			OpaqueParent, MaskedParent, TranslucentParent, World);
+		Meshes.Add(MakeTuple(FString(TEXT("GeneratedModel")), GenerateResult.GeneratedModel));
+	}
+
+	for (const TSharedPtr<FVitruvioMesh>& ClusterModel : GenerateResult.ClusterModels)
+	{
+		if (ClusterModel)
+		{
+			Meshes.Add(MakeTuple(FString(TEXT("GeneratedModel")), ClusterModel));
+		}
 	}
 
 	for (const auto& IdAndMesh : GenerateResult.InstanceMeshes)
 	{
-		FString Name = GenerateResult.InstanceNames[IdAndMesh.Key];
-		IdAndMesh.Value->Build(Name, MaterialCache, TextureCache, MaterialIdentifiers, UniqueMaterialIdentifiers,
-			OpaqueParent, MaskedParent, TranslucentParent, World);
+		Meshes.Add(MakeTuple(GenerateResult.InstanceNames[IdAndMesh.Key], IdAndMesh.Value));
 	}
+	return Meshes;
+}
 
+FConvertedGenerateResult ConvertGenerateResult(const FGenerateResultDescription& GenerateResult,
+											   TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
+											   FTextureCache& TextureCache,
+											   TMap<UMaterialInterface*, FString>& MaterialIdentifiers,
+											   TMap<FString, int32>& UniqueMaterialIdentifiers,
+											   UMaterial* OpaqueParent, UMaterial* MaskedParent, UMaterial* TranslucentParent)
+{
 	// Convert instances
 	TArray<FInstance> Instances;
 	for (const auto& [Key, Transform] : GenerateResult.Instances)
@@ -477,33 +516,42 @@ TArray<FInitialShape> UVitruvioComponent::GetNeighboringShapes() const
 {
 	TArray<FInitialShape> NeighboringShapes;
 
-	const FVector OwnerLocation = GetOwner()->GetActorLocation();
-
-	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	UVitruvioBatchSubsystem* BatchSubsystem = GetWorld()->GetSubsystem<UVitruvioBatchSubsystem>();
+	if (!BatchSubsystem)
 	{
-		AActor* Actor = *It;
+		return NeighboringShapes;
+	}
+
+	TArray<UVitruvioComponent*> NearbyComponents;
+	BatchSubsystem->GetSpatialIndex().QueryRadius(GetOwner()->GetActorLocation(), CVarInterOcclusionNeighborQueryDistance.GetValueOnGameThread(),
+												  NearbyComponents);
 
-		if (Actor == GetOwner())
+	for (UVitruvioComponent* VitruvioComponent : NearbyComponents)
+	{
+		if (VitruvioComponent->GetOwner() == GetOwner())
 		{
 			continue;
 		}
 
-		UVitruvioComponent* VitruvioComponent = Actor->FindComponentByClass<UVitruvioComponent>();
-		if (!VitruvioComponent || !VitruvioComponent->bEnableOcclusionQueries  || !VitruvioComponent->InitialShape || !VitruvioComponent->InitialShape->IsValid())
+		if (!VitruvioComponent->bEnableOcclusionQueries || !VitruvioComponent->InitialShape || !VitruvioComponent->InitialShape->IsValid())
 		{
 			continue;
 		}
 
-		const float Distance = FVector::Dist(OwnerLocation, Actor->GetActorLocation());
-		if (Distance < CVarInterOcclusionNeighborQueryDistance.GetValueOnGameThread())
-		{
-			NeighboringShapes.Add(VitruvioComponent->GetInitialShape());
-		}
+		NeighboringShapes.Add(VitruvioComponent->GetInitialShape());
 	}
 
 	return NeighboringShapes;
 }
 
+void UVitruvioComponent::UpdateSpatialIndex(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	if (UVitruvioBatchSubsystem* BatchSubsystem = GetWorld()->GetSubsystem<UVitruvioBatchSubsystem>())
+	{
+		BatchSubsystem->GetSpatialIndex().Update(this, UpdatedComponent->GetComponentLocation());
+	}
+}
+
 void UVitruvioComponent::CalculateRandomSeed()
 {
 	if (!bValidRandomSeed && InitialShape && InitialShape->IsValid())
@@ -878,6 +926,15 @@ void UVitruvioComponent::Initialize()
 
 	LoadInitialShape();
 
+	if (UVitruvioBatchSubsystem* BatchSubsystem = GetWorld()->GetSubsystem<UVitruvioBatchSubsystem>())
+	{
+		BatchSubsystem->GetSpatialIndex().Update(this, GetOwner()->GetActorLocation());
+	}
+	if (USceneComponent* RootComponent = GetOwner()->GetRootComponent())
+	{
+		OwnerTransformUpdated = RootComponent->TransformUpdated.AddUObject(this, &UVitruvioComponent::UpdateSpatialIndex);
+	}
+
 	OnHierarchyChanged.Broadcast(this);
 
 	CalculateRandomSeed();
@@ -911,13 +968,26 @@ void UVitruvioComponent::ProcessGenerateQueue()
 	FGenerateQueueItem Result;
 	GenerateQueue.Dequeue(Result);
 
-	FConvertedGenerateResult ConvertedResult = BuildGenerateResult(Result.GenerateResultDescription,
-VitruvioModule::Get().GetMaterialCache(), VitruvioModule::Get().GetTextureCache(),
-			MaterialIdentifiers, UniqueMaterialIdentifiers, OpaqueParent, MaskedParent, TranslucentParent, GetWorld());
+	const int32 MeshBuildId = ++PendingMeshBuildId;
+	BuildGenerateResultAsync(Result.GenerateResultDescription, VitruvioModule::Get().GetMaterialCache(), VitruvioModule::Get().GetTextureCache(),
+							 MaterialIdentifiers, UniqueMaterialIdentifiers, OpaqueParent, MaskedParent, TranslucentParent, GetWorld(),
+							 [WeakThis = MakeWeakObjectPtr(this), MeshBuildId, Result]() {
+								 // Results which have been superseded by a newer generate result while their meshes were building are discarded
+								 if (WeakThis.IsValid() && WeakThis->PendingMeshBuildId == MeshBuildId && !WeakThis->bBatchGenerate)
+								 {
+									 WeakThis->ApplyGenerateResult(Result);
+								 }
+							 });
+}
+
+void UVitruvioComponent::ApplyGenerateResult(const FGenerateQueueItem& Result)
+{
+	FConvertedGenerateResult ConvertedResult = ConvertGenerateResult(Result.GenerateResultDescription, VitruvioModule::Get().GetMaterialCache(),
+		VitruvioModule::Get().GetTextureCache(), MaterialIdentifiers, UniqueMaterialIdentifiers, OpaqueParent, MaskedParent, TranslucentParent);
 
 	Reports = ConvertedResult.Reports;
 
-	QUICK_SCOPE_CYCLE_COUNTER(STAT_VitruvioActor_CreateModelActors);
+	VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_RegisterInstances, TEXT("InitialShape %lld"), InitialShapeIndex);
 
 	UGeneratedModelStaticMeshComponent* VitruvioModelComponent = nullptr;
 
@@ -1047,7 +1117,10 @@ void UVitruvioComponent::ProcessAttributesEvaluationQueue()
 		FAttributesEvaluationQueueItem AttributesEvaluation;
 		AttributesEvaluationQueue.Dequeue(AttributesEvaluation);
 
-		AttributesEvaluation.AttributeMap->UpdateUnrealAttributeMap(Attributes, this);
+		{
+			VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_UpdateAttributes, TEXT("InitialShape %lld"), InitialShapeIndex);
+			AttributesEvaluation.AttributeMap->UpdateUnrealAttributeMap(Attributes, this);
+		}
 
 		bAttributesReady = true;
 		bNotifyAttributeChange = true;
@@ -1061,7 +1134,7 @@ void UVitruvioComponent::ProcessAttributesEvaluationQueue()
 
 		if (AttributesEvaluation.bForceRegenerate)
 		{
-			Generate(AttributesEvaluation.CallbackProxy);
+			Generate(AttributesEvaluation.CallbackProxy, {}, AttributesEvaluation.Priority);
 		}
 		else if (AttributesEvaluation.CallbackProxy)
 		{
@@ -1098,6 +1171,9 @@ void UVitruvioComponent::NotifyAttributesChanged()
 
 void UVitruvioComponent::RemoveGeneratedMeshes()
 {
+	// Discard results whose meshes are still building
+	++PendingMeshBuildId;
+
 	if (!InitialShape || !InitialShapeSceneComponent)
 	{
 		return;
@@ -1193,6 +1269,19 @@ void UVitruvioComponent::OnComponentDestroyed(bool bDestroyingHierarchy)
 
 	VitruvioModule::Get().InvalidateOcclusionHandle(InitialShapeIndex);
 
+	if (UWorld* World = GetWorld())
+	{
+		if (UVitruvioBatchSubsystem* BatchSubsystem = World->GetSubsystem<UVitruvioBatchSubsystem>())
+		{
+			BatchSubsystem->GetSpatialIndex().Remove(this);
+		}
+	}
+	if (GetOwner() && GetOwner()->GetRootComponent())
+	{
+		GetOwner()->GetRootComponent()->TransformUpdated.Remove(OwnerTransformUpdated);
+	}
+	OwnerTransformUpdated.Reset();
+
 #if WITH_EDITOR
 	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(PropertyChangeDelegate);
 	PropertyChangeDelegate.Reset();
@@ -1205,7 +1294,7 @@ void UVitruvioComponent::OnComponentDestroyed(bool bDestroyingHierarchy)
 #endif
 }
 
-void UVitruvioComponent::Generate(UGenerateCompletedCallbackProxy* CallbackProxy, const FGenerateOptions& GenerateOptions)
+void UVitruvioComponent::Generate(UGenerateCompletedCallbackProxy* CallbackProxy, const FGenerateOptions& GenerateOptions, EPrtCallPriority Priority)
 {
 	Initialize();
 	
@@ -1222,7 +1311,7 @@ void UVitruvioComponent::Generate(UGenerateCompletedCallbackProxy* CallbackProxy
 	if (bBatchGenerate)
 	{
 		UVitruvioBatchSubsystem* BatchGenerateSubsystem = GetWorld()->GetSubsystem<UVitruvioBatchSubsystem>();
-		BatchGenerateSubsystem->Generate(this, CallbackProxy);
+		BatchGenerateSubsystem->Generate(this, CallbackProxy, Priority);
 
 		return;
 	}
@@ -1391,7 +1480,7 @@ void UVitruvioComponent::OnPropertyChanged(UObject* Object, FPropertyChangedEven
 
 	if (bGenerateComponent || bGenerateBatch)
 	{
-		Generate();
+		Generate(nullptr, {}, EPrtCallPriority::Interactive);
 	}
 
 	if (!bBatchGenerate)
@@ -1403,7 +1492,7 @@ void UVitruvioComponent::OnPropertyChanged(UObject* Object, FPropertyChangedEven
 
 		if (HasValidInputData() && (!bAttributesReady || bIsAttributeUndo))
 		{
-			EvaluateRuleAttributes(true);
+			EvaluateRuleAttributes(true, nullptr, EPrtCallPriority::Interactive);
 		}
 	}
 }
@@ -1438,7 +1527,7 @@ void UVitruvioComponent::SetInitialShapeType(const TSubclassOf<UInitialShape>& T
 
 #endif // WITH_EDITOR
 
-void UVitruvioComponent::EvaluateRuleAttributes(bool ForceRegenerate, UGenerateCompletedCallbackProxy* CallbackProxy)
+void UVitruvioComponent::EvaluateRuleAttributes(bool ForceRegenerate, UGenerateCompletedCallbackProxy* CallbackProxy, EPrtCallPriority Priority)
 {
 	Initialize();
 	
@@ -1454,7 +1543,7 @@ void UVitruvioComponent::EvaluateRuleAttributes(bool ForceRegenerate, UGenerateC
 
 		if (ForceRegenerate)
 		{
-			BatchGenerateSubsystem->Generate(this, CallbackProxy);
+			BatchGenerateSubsystem->Generate(this, CallbackProxy, Priority);
 		}
 		else
 		{
@@ -1475,7 +1564,7 @@ void UVitruvioComponent::EvaluateRuleAttributes(bool ForceRegenerate, UGenerateC
 
 	EvalAttributesInvalidationToken = AttributesResult.Token;
 
-	AttributesResult.Result.Next([this, CallbackProxy, ForceRegenerate](const FAttributeMapResult::ResultType& Result) {
+	AttributesResult.Result.Next([this, CallbackProxy, ForceRegenerate, Priority](const FAttributeMapResult::ResultType& Result) {
 		FScopeLock Lock(&Result.Token->Lock);
 
 		if (Result.Token->IsInvalid())
@@ -1484,7 +1573,7 @@ void UVitruvioComponent::EvaluateRuleAttributes(bool ForceRegenerate, UGenerateC
 		}
 
 		EvalAttributesInvalidationToken.Reset();
-		AttributesEvaluationQueue.Enqueue({Result.Value, ForceRegenerate, CallbackProxy});
+		AttributesEvaluationQueue.Enqueue({Result.Value, ForceRegenerate, CallbackProxy, Priority});
 	});
 }
 
@@ -18,10 +18,18 @@
 #include "Materials/Material.h"
 #include "StaticMeshAttributes.h"
 #include "VitruvioModule.h"
+#include "VitruvioTrace.h"
 #include "PhysicsEngine/BodySetup.h"
 #include "Engine/CollisionProfile.h"
 #include "UObject/Package.h"
 #include "Engine/World.h"
+#include "Engine/StaticMesh.h"
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+
+TAutoConsoleVariable<bool> CVarReleaseMeshSourceData(TEXT("Esri.Vitruvio.ReleaseMeshSourceData"), true,
+													 TEXT("Whether generated meshes release their mesh description or render buffers once their static mesh has "
+														  "been built. The static mesh keeps its own copy for cooking in the editor."));
 
 namespace
 {
@@ -40,10 +48,152 @@ FString MakeUniqueMaterialName(FString Name, TMap<FString, int32>& UniqueMateria
 	return Name;
 }
 
+void ConfigureBodySetup(UBodySetup* BodySetup)
+{
+	BodySetup->DefaultInstance.SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+	BodySetup->CollisionTraceFlag = ECollisionTraceFlag::CTF_UseComplexAsSimple;
+	BodySetup->bDoubleSidedGeometry = true;
+	BodySetup->bMeshCollideAll = true;
+	BodySetup->InvalidatePhysicsData();
+}
+
+// Lays out the triangles of a mesh description like the direct render buffers: one vertex per vertex instance and one section per polygon
+// group. Only reads the mesh description, unlike UStaticMesh::BuildFromMeshDescription it is safe to call off the game thread.
+Vitruvio::FRenderMeshData CreateRenderMeshData(const FMeshDescription& MeshDescription)
+{
+	const FStaticMeshConstAttributes MeshAttributes(MeshDescription);
+	const TVertexAttributesConstRef<FVector3f> VertexPositions = MeshAttributes.GetVertexPositions();
+	const TVertexInstanceAttributesConstRef<FVector3f> VertexInstanceNormals = MeshAttributes.GetVertexInstanceNormals();
+	const TVertexInstanceAttributesConstRef<FVector3f> VertexInstanceTangents = MeshAttributes.GetVertexInstanceTangents();
+	const TVertexInstanceAttributesConstRef<float> VertexInstanceBinormalSigns = MeshAttributes.GetVertexInstanceBinormalSigns();
+	const TVertexInstanceAttributesConstRef<FVector2f> VertexInstanceUVs = MeshAttributes.GetVertexInstanceUVs();
+
+	// Trailing channels without any uvs are dropped, the materials only sample the uv sets the mesh has (see UnrealCallbacks)
+	int32 NumUVChannels = VertexInstanceUVs.GetNumChannels();
+	const auto IsChannelUsed = [&MeshDescription, &VertexInstanceUVs](int32 UVIndex) {
+		for (const FVertexInstanceID VertexInstanceId : MeshDescription.VertexInstances().GetElementIDs())
+		{
+			if (!VertexInstanceUVs.Get(VertexInstanceId, UVIndex).IsZero())
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+	while (NumUVChannels > 1 && !IsChannelUsed(NumUVChannels - 1))
+	{
+		--NumUVChannels;
+	}
+
+	Vitruvio::FRenderMeshData RenderMeshData;
+	RenderMeshData.NumUVChannels = FMath::Max(NumUVChannels, 1);
+	const int32 NumVertices = MeshDescription.VertexInstances().Num();
+	RenderMeshData.Positions.Reserve(NumVertices);
+	RenderMeshData.TangentX.Reserve(NumVertices);
+	RenderMeshData.TangentY.Reserve(NumVertices);
+	RenderMeshData.TangentZ.Reserve(NumVertices);
+	RenderMeshData.UVs.SetNumZeroed(NumVertices * RenderMeshData.NumUVChannels);
+
+	// Vertex instance ids are not necessarily compact
+	TArray<uint32> VertexIndices;
+	VertexIndices.SetNumUninitialized(MeshDescription.VertexInstances().GetArraySize());
+	for (const FVertexInstanceID VertexInstanceId : MeshDescription.VertexInstances().GetElementIDs())
+	{
+		const uint32 VertexIndex = RenderMeshData.Positions.Num();
+		VertexIndices[VertexInstanceId.GetValue()] = VertexIndex;
+
+		const FVector3f Normal = VertexInstanceNormals[VertexInstanceId];
+		const FVector3f Tangent = VertexInstanceTangents[VertexInstanceId];
+		RenderMeshData.Positions.Add(VertexPositions[MeshDescription.GetVertexInstanceVertex(VertexInstanceId)]);
+		RenderMeshData.TangentX.Add(Tangent);
+		RenderMeshData.TangentY.Add(FVector3f::CrossProduct(Normal, Tangent).GetSafeNormal() * VertexInstanceBinormalSigns[VertexInstanceId]);
+		RenderMeshData.TangentZ.Add(Normal);
+		for (int32 UVIndex = 0; UVIndex < NumUVChannels; ++UVIndex)
+		{
+			RenderMeshData.UVs[VertexIndex * RenderMeshData.NumUVChannels + UVIndex] = VertexInstanceUVs.Get(VertexInstanceId, UVIndex);
+		}
+	}
+
+	// The material slots are added in polygon group order (see FVitruvioMesh::CreateStaticMesh)
+	RenderMeshData.Indices.Reserve(MeshDescription.Triangles().Num() * 3);
+	for (const FPolygonGroupID PolygonGroupId : MeshDescription.PolygonGroups().GetElementIDs())
+	{
+		Vitruvio::FRenderMeshData::FSection& Section = RenderMeshData.Sections.AddDefaulted_GetRef();
+		Section.FirstIndex = RenderMeshData.Indices.Num();
+		Section.MinVertexIndex = TNumericLimits<uint32>::Max();
+
+		for (const FPolygonID PolygonId : MeshDescription.GetPolygonGroupPolygonIDs(PolygonGroupId))
+		{
+			for (const FTriangleID TriangleId : MeshDescription.GetPolygonTriangles(PolygonId))
+			{
+				for (const FVertexInstanceID VertexInstanceId : MeshDescription.GetTriangleVertexInstances(TriangleId))
+				{
+					const uint32 VertexIndex = VertexIndices[VertexInstanceId.GetValue()];
+					RenderMeshData.Indices.Add(VertexIndex);
+					Section.MinVertexIndex = FMath::Min(Section.MinVertexIndex, VertexIndex);
+					Section.MaxVertexIndex = FMath::Max(Section.MaxVertexIndex, VertexIndex);
+				}
+				++Section.NumTriangles;
+			}
+		}
+
+		if (Section.NumTriangles == 0)
+		{
+			Section.MinVertexIndex = 0;
+		}
+	}
+
+	return RenderMeshData;
+}
+
+TUniquePtr<FStaticMeshRenderData> CreateRenderData(const Vitruvio::FRenderMeshData& RenderMeshData)
+{
+	TUniquePtr<FStaticMeshRenderData> RenderData = MakeUnique<FStaticMeshRenderData>();
+	RenderData->AllocateLODResources(1);
+
+	FStaticMeshLODResources& LODResources = RenderData->LODResources[0];
+	const int32 NumVertices = RenderMeshData.Positions.Num();
+
+	LODResources.VertexBuffers.PositionVertexBuffer.Init(RenderMeshData.Positions);
+	LODResources.VertexBuffers.StaticMeshVertexBuffer.SetUseFullPrecisionUVs(true);
+	LODResources.VertexBuffers.StaticMeshVertexBuffer.Init(NumVertices, RenderMeshData.NumUVChannels);
+	for (int32 VertexIndex = 0; VertexIndex < NumVertices; ++VertexIndex)
+	{
+		LODResources.VertexBuffers.StaticMeshVertexBuffer.SetVertexTangents(VertexIndex, RenderMeshData.TangentX[VertexIndex],
+																			RenderMeshData.TangentY[VertexIndex],
+																			RenderMeshData.TangentZ[VertexIndex]);
+		for (int32 UVIndex = 0; UVIndex < RenderMeshData.NumUVChannels; ++UVIndex)
+		{
+			LODResources.VertexBuffers.StaticMeshVertexBuffer.SetVertexUV(
+				VertexIndex, UVIndex, RenderMeshData.UVs[VertexIndex * RenderMeshData.NumUVChannels + UVIndex]);
+		}
+	}
+	LODResources.VertexBuffers.ColorVertexBuffer.InitFromSingleColor(FColor::White, NumVertices);
+
+	for (int32 SectionIndex = 0; SectionIndex < RenderMeshData.Sections.Num(); ++SectionIndex)
+	{
+		const Vitruvio::FRenderMeshData::FSection& SectionData = RenderMeshData.Sections[SectionIndex];
+		FStaticMeshSection& Section = LODResources.Sections.AddDefaulted_GetRef();
+		Section.MaterialIndex = SectionIndex;
+		Section.FirstIndex = SectionData.FirstIndex;
+		Section.NumTriangles = SectionData.NumTriangles;
+		Section.MinVertexIndex = SectionData.MinVertexIndex;
+		Section.MaxVertexIndex = SectionData.MaxVertexIndex;
+		Section.bEnableCollision = true;
+		Section.bCastShadow = true;
+	}
+	LODResources.IndexBuffer.SetIndices(RenderMeshData.Indices, EIndexBufferStride::AutoDetect);
+
+	RenderData->Bounds = FBoxSphereBounds(FBox(FBox3f(RenderMeshData.Positions)));
+	RenderData->ScreenSize[0].Default = 1.0f;
+
+	return RenderData;
+}
+
 } // namespace
 
 UMaterialInstanceDynamic* CacheMaterial(UMaterial* OpaqueParent, UMaterial* MaskedParent, UMaterial* TranslucentParent,
-										TMap<FString, Vitruvio::FTextureData>& TextureCache,
+										FTextureCache& TextureCache,
 										TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
 										const Vitruvio::FMaterialAttributeContainer& MaterialAttributes, TMap<FString, int32>& UniqueMaterialNames,
 										TMap<UMaterialInterface*, FString>& MaterialIdentifiers, UObject* Outer)
@@ -59,6 +209,8 @@ UMaterialInstanceDynamic* CacheMaterial(UMaterial* OpaqueParent, UMaterial* Mask
 		return Material;
 	}
 
+	VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_CreateMaterials, TEXT("%s"), *MaterialIdentifier);
+
 	const FString UniqueMaterialIdentifier = MakeUniqueMaterialName(MaterialIdentifier, UniqueMaterialNames);
 	UMaterialInstanceDynamic* Material = GameThread_CreateMaterialInstance(Outer, UniqueMaterialIdentifier, OpaqueParent, MaskedParent,
 																		   TranslucentParent, MaterialAttributes, TextureCache);
@@ -71,11 +223,7 @@ UMaterialInstanceDynamic* CacheMaterial(UMaterial* OpaqueParent, UMaterial* Mask
 
 void InitializeBodySetup(UBodySetup* BodySetup)
 {
-	BodySetup->DefaultInstance.SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
-	BodySetup->CollisionTraceFlag = ECollisionTraceFlag::CTF_UseComplexAsSimple;
-	BodySetup->bDoubleSidedGeometry = true;
-	BodySetup->bMeshCollideAll = true;
-	BodySetup->InvalidatePhysicsData();
+	ConfigureBodySetup(BodySetup);
 	BodySetup->CreatePhysicsMeshes();
 }
 
@@ -89,56 +237,178 @@ FVitruvioMesh::~FVitruvioMesh()
 	VitruvioModule* VitruvioModule = VitruvioModule::GetUnchecked();
 	if (StaticMesh && VitruvioModule)
 	{
-		VitruvioModule->UnregisterMesh(StaticMesh);
+		VitruvioModule->UnregisterMesh(StaticMesh, CollisionDataProvider);
+	}
+}
+
+SIZE_T FVitruvioMesh::GetAllocatedSize() const
+{
+	return sizeof(FVitruvioMesh) + Identifier.GetAllocatedSize() + Materials.GetAllocatedSize() + SourceDataSize.Load();
+}
+
+SIZE_T FVitruvioMesh::ComputeSourceDataSize() const
+{
+	if (!HasMeshDescription())
+	{
+		return RenderMeshData.GetAllocatedSize();
 	}
+
+	if (MeshDescription.IsEmpty())
+	{
+		return 0;
+	}
+
+	const FStaticMeshConstAttributes MeshAttributes(MeshDescription);
+	const int32 NumUVChannels = MeshAttributes.GetVertexInstanceUVs().GetNumChannels();
+
+	const SIZE_T VertexInstanceSize = sizeof(FVertexID) + 2 * sizeof(FVector3f) + sizeof(float) + sizeof(FVector4f) + NumUVChannels * sizeof(FVector2f);
+	const SIZE_T TriangleSize = 3 * sizeof(FVertexInstanceID) + sizeof(FPolygonID) + sizeof(FPolygonGroupID);
+
+	SIZE_T Size = MeshDescription.Vertices().Num() * sizeof(FVector3f);
+	Size += MeshDescription.VertexInstances().Num() * VertexInstanceSize;
+	Size += MeshDescription.Triangles().Num() * TriangleSize;
+	return Size;
+}
+
+void FVitruvioMesh::ReleaseSourceData()
+{
+	check(IsInGameThread());
+
+	MeshDescription = FMeshDescription();
+	RenderMeshData = Vitruvio::FRenderMeshData();
+	SourceDataSize = 0;
 }
 
-void FVitruvioMesh::Build(const FString& Name, TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
-						  TMap<FString, Vitruvio::FTextureData>& TextureCache, TMap<UMaterialInterface*, FString>& UniqueMaterialIdentifiers,
-						  TMap<FString, int32>& UniqueMaterialNames, UMaterial* OpaqueParent, UMaterial* MaskedParent, UMaterial* TranslucentParent,
-						  UWorld* World)
+void FVitruvioMesh::BuildAsync(const FString& Name, TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
+							   FTextureCache& TextureCache, TMap<UMaterialInterface*, FString>& UniqueMaterialIdentifiers,
+							   TMap<FString, int32>& UniqueMaterialNames, UMaterial* OpaqueParent, UMaterial* MaskedParent,
+							   UMaterial* TranslucentParent, UWorld* World, TFunction<void()> OnBuilt)
 {
 	check(IsInGameThread());
 
-	if (StaticMesh)
+	if (BuildState == EBuildState::NotBuilt)
+	{
+		{
+			VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_BuildMesh, TEXT("%s"), *Name);
+			CreateStaticMesh(Name, MaterialCache, TextureCache, UniqueMaterialIdentifiers, UniqueMaterialNames, OpaqueParent, MaskedParent,
+							 TranslucentParent, World);
+		}
+
+		// The task chain keeps this mesh alive and hands the last reference back to the game thread
+		AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [This = AsShared()]() mutable {
+			FBuildData BuildData = This->PrepareBuildData();
+			AsyncTask(ENamedThreads::GameThread, [This = MoveTemp(This), BuildData = MoveTemp(BuildData)]() mutable {
+				This->FinishBuild(MoveTemp(BuildData));
+			});
+		});
+	}
+
+	// Shared meshes (cached results, prototypes and identical shapes) only create their materials for the first caller
+	AddMaterialIdentifiers(UniqueMaterialIdentifiers);
+
+	if (BuildState == EBuildState::Built)
 	{
+		if (OnBuilt)
+		{
+			OnBuilt();
+		}
 		return;
 	}
 
+	if (OnBuilt)
+	{
+		OnBuiltCallbacks.Add(MoveTemp(OnBuilt));
+	}
+}
+
+void FVitruvioMesh::AddMaterialIdentifiers(TMap<UMaterialInterface*, FString>& OutMaterialIdentifiers) const
+{
+	const TArray<FStaticMaterial>& StaticMaterials = StaticMesh->GetStaticMaterials();
+	for (int32 MaterialIndex = 0; MaterialIndex < StaticMaterials.Num() && MaterialIndex < MaterialIdentifiers.Num(); ++MaterialIndex)
+	{
+		if (StaticMaterials[MaterialIndex].MaterialInterface)
+		{
+			OutMaterialIdentifiers.Add(StaticMaterials[MaterialIndex].MaterialInterface, MaterialIdentifiers[MaterialIndex]);
+		}
+	}
+}
+
+void FVitruvioMesh::CreateStaticMesh(const FString& Name,
+									 TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
+									 FTextureCache& TextureCache,
+									 TMap<UMaterialInterface*, FString>& UniqueMaterialIdentifiers, TMap<FString, int32>& UniqueMaterialNames,
+									 UMaterial* OpaqueParent, UMaterial* MaskedParent, UMaterial* TranslucentParent, UWorld* World)
+{
+	check(IsInGameThread());
+
+	BuildState = EBuildState::Building;
+
 	FString MeshName = Name.Replace(TEXT("."), TEXT(""));
 	const FName StaticMeshName = MakeUniqueObjectName(nullptr, UStaticMesh::StaticClass(), FName(MeshName));
 	StaticMesh = NewObject<UStaticMesh>(GetTransientPackage(), StaticMeshName, RF_Transient | RF_DuplicateTransient | RF_TextExportTransient);
 	CollisionDataProvider = NewObject<UCustomCollisionDataProvider>(World, NAME_None, RF_Transient | RF_DuplicateTransient | RF_TextExportTransient);
 	
-	VitruvioModule::Get().RegisterMesh(StaticMesh);
-
-	TMap<UMaterialInstanceDynamic*, FName> MaterialSlots;
+	// The build data is prepared on a worker thread, both have to survive garbage collections until the build has finished
+	VitruvioModule::Get().RegisterMesh(StaticMesh, CollisionDataProvider);
 
-	FStaticMeshAttributes MeshAttributes(MeshDescription);
-
-	TArray<FVector3f> Vertices;
-	auto VertexPositions = MeshAttributes.GetVertexPositions();
-	for (int32 VertexIndex = 0; VertexIndex < VertexPositions.GetNumElements(); ++VertexIndex)
+	if (!HasMeshDescription())
 	{
-		Vertices.Add(VertexPositions[FVertexID(VertexIndex)]);
+		// The sections of the render data reference the materials by index
+		for (const Vitruvio::FMaterialAttributeContainer& MaterialAttributes : Materials)
+		{
+			StaticMesh->AddMaterial(CacheMaterial(OpaqueParent, MaskedParent, TranslucentParent, TextureCache, MaterialCache, MaterialAttributes,
+												  UniqueMaterialNames, UniqueMaterialIdentifiers, StaticMesh));
+		}
+		return;
 	}
 
-	TArray<FTriIndices> Indices;
-	const auto PolygonGroups = MeshDescription.PolygonGroups();
+	FStaticMeshAttributes MeshAttributes(MeshDescription);
 	size_t MaterialIndex = 0;
 
-	for (const auto& PolygonGroupId : PolygonGroups.GetElementIDs())
+	for (const auto& PolygonGroupId : MeshDescription.PolygonGroups().GetElementIDs())
 	{
 		UMaterialInstanceDynamic* Material = CacheMaterial(OpaqueParent, MaskedParent, TranslucentParent, TextureCache, MaterialCache,
 														   Materials[MaterialIndex], UniqueMaterialNames, UniqueMaterialIdentifiers, StaticMesh);
 
 		const FName SlotName = StaticMesh->AddMaterial(Material);
 		MeshAttributes.GetPolygonGroupMaterialSlotNames()[PolygonGroupId] = SlotName;
-		MaterialSlots.Add(Material, SlotName);
 
 		++MaterialIndex;
+	}
+}
 
-		// cache collision data
+FVitruvioMesh::FBuildData FVitruvioMesh::PrepareBuildData() const
+{
+	VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_PrepareMeshData, TEXT("%s"), *Identifier);
+
+	FBuildData BuildData;
+
+	if (!HasMeshDescription())
+	{
+		BuildData.RenderData = CreateRenderData(RenderMeshData);
+
+		// Vertices are not shared between faces, welding them keeps the collision data small until it is cooked
+		BuildData.CollisionData.Set(RenderMeshData.Positions, RenderMeshData.Indices, true);
+
+		return BuildData;
+	}
+
+	BuildData.RenderData = CreateRenderData(CreateRenderMeshData(MeshDescription));
+
+	// cache collision data
+	const FStaticMeshConstAttributes MeshAttributes(MeshDescription);
+	const auto VertexPositions = MeshAttributes.GetVertexPositions();
+	TArray<FVector3f> CollisionVertices;
+	CollisionVertices.Reserve(VertexPositions.GetNumElements());
+	for (int32 VertexIndex = 0; VertexIndex < VertexPositions.GetNumElements(); ++VertexIndex)
+	{
+		CollisionVertices.Add(VertexPositions[FVertexID(VertexIndex)]);
+	}
+
+	TArray<uint32> CollisionIndices;
+	CollisionIndices.Reserve(MeshDescription.Triangles().Num() * 3);
+	for (const FPolygonGroupID PolygonGroupId : MeshDescription.PolygonGroups().GetElementIDs())
+	{
 		for (FPolygonID PolygonID : MeshDescription.GetPolygonGroupPolygonIDs(PolygonGroupId))
 		{
 			for (FTriangleID TriangleID : MeshDescription.GetPolygonTriangles(PolygonID))
@@ -149,27 +419,70 @@ void FVitruvioMesh::Build(const FString& Name, TMap<Vitruvio::FMaterialAttribute
 				auto VertexID1 = MeshDescription.GetVertexInstanceVertex(TriangleVertexInstances[1]);
 				auto VertexID2 = MeshDescription.GetVertexInstanceVertex(TriangleVertexInstances[2]);
 
-				FTriIndices TriIndex;
-				TriIndex.v0 = VertexID0.GetValue();
-				TriIndex.v1 = VertexID1.GetValue();
-				TriIndex.v2 = VertexID2.GetValue();
-				Indices.Add(TriIndex);
+				CollisionIndices.Add(VertexID0.GetValue());
+				CollisionIndices.Add(VertexID1.GetValue());
+				CollisionIndices.Add(VertexID2.GetValue());
 			}
 		}
 	}
 
-	TArray<const FMeshDescription*> MeshDescriptionPtrs;
-	MeshDescriptionPtrs.Emplace(&MeshDescription);
+	// The vertices of a mesh description are already shared between faces
+	BuildData.CollisionData.Set(MoveTemp(CollisionVertices), CollisionIndices, false);
 
-	UStaticMesh::FBuildMeshDescriptionsParams Params;
-	Params.bCommitMeshDescription = true;
-	Params.bFastBuild = true;
-	StaticMesh->BuildFromMeshDescriptions(MeshDescriptionPtrs, Params);
-	
-	Vitruvio::FCollisionData CollisionData = {Indices, Vertices};
-	CollisionDataProvider->SetCollisionData(CollisionData);
+	return BuildData;
+}
+
+void FVitruvioMesh::FinishBuild(FBuildData&& BuildData)
+{
+	check(IsInGameThread());
+
+	VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_FinishMeshBuild, TEXT("%s"), *Identifier);
+
+	// Same hookup as UStaticMesh::BuildFromMeshDescriptions, but with the render data already built
+	StaticMesh->NeverStream = true;
+	StaticMesh->SetRenderData(MoveTemp(BuildData.RenderData));
+	StaticMesh->CalculateExtendedBounds();
+	StaticMesh->InitResources();
+
+#if WITH_EDITOR
+	// The cooker reads the mesh description back from the static mesh, meshes built directly from render buffers can not be cooked
+	if (HasMeshDescription())
+	{
+		StaticMesh->SetNumSourceModels(1);
+		StaticMesh->CreateMeshDescription(0, MeshDescription);
+		UStaticMesh::FCommitMeshDescriptionParams CommitParams;
+		CommitParams.bMarkPackageDirty = false;
+		CommitParams.bUseHashAsGuid = true;
+		StaticMesh->CommitMeshDescription(0, CommitParams);
+	}
+#endif
+
+	CollisionDataProvider->SetCollisionData(MoveTemp(BuildData.CollisionData));
+
+	// Everything the static mesh needs has been copied into its render data, collision data provider and (in the editor) source model
+	if (CVarReleaseMeshSourceData.GetValueOnGameThread())
+	{
+		ReleaseSourceData();
+	}
 
 	UBodySetup* BodySetup = NewObject<UBodySetup>(CollisionDataProvider, NAME_None, RF_Transient | RF_DuplicateTransient | RF_TextExportTransient | RF_Transactional);
-	InitializeBodySetup(BodySetup);
 	StaticMesh->SetBodySetup(BodySetup);
+
+	ConfigureBodySetup(BodySetup);
+	BodySetup->CreatePhysicsMeshesAsync(FOnAsyncPhysicsCookFinished::CreateSPLambda(AsShared(), [this](bool) { MarkBuilt(); }));
+}
+
+void FVitruvioMesh::MarkBuilt()
+{
+	check(IsInGameThread());
+
+	BuildState = EBuildState::Built;
+	ResourceSize = StaticMesh->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+
+	// Callbacks might start new builds, so move them out first
+	TArray<TFunction<void()>> Callbacks = MoveTemp(OnBuiltCallbacks);
+	for (const TFunction<void()>& Callback : Callbacks)
+	{
+		Callback();
+	}
 }
\ No newline at end of file
@@ -21,13 +21,17 @@
 #include "PRTUtils.h"
 #include "TextureDecoding.h"
 #include "UnrealCallbacks.h"
+#include "VitruvioTrace.h"
 
 #include "Util/PolygonWindings.h"
+#include "Util/ShapeCanonicalization.h"
 
 #include "Async/Async.h"
 #include "HAL/FileManager.h"
 #include "HAL/PlatformFileManager.h"
 #include "Interfaces/IPluginManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopeExit.h"
 #include "Modules/ModuleManager.h"
 
 #include "UObject/UObjectBaseUtility.h"
@@ -57,27 +61,167 @@ namespace
 {
 constexpr const wchar_t* ATTRIBUTE_EVAL_ENCODER_ID = L"com.esri.prt.core.AttributeEvalEncoder";
 
-struct FStartRuleInfo
+TAutoConsoleVariable<int32> CVarRulePackageStoreBudget(TEXT("Esri.Vitruvio.RulePackageStoreBudget"), 1024,
+	TEXT("The size in MB the rule package store (Saved/Vitruvio/RulePackages) is trimmed to on startup. Least recently used rule packages are removed first."));
+TAutoConsoleVariable<int32> CVarRulePackageStoreMaxAge(TEXT("Esri.Vitruvio.RulePackageStoreMaxAge"), 30,
+	TEXT("The number of days after which unused rule packages are removed from the rule package store on startup."));
+
+// Written next to a stored rpk once it has been completely moved into the store, contains the size of the rpk
+const TCHAR* RPK_MARKER_EXTENSION = TEXT(".complete");
+
+// Serializes writes to the rpk store, rule packages with identical content might be loaded concurrently
+FCriticalSection RpkStoreLock;
+
+bool IsRpkStored(const FString& RpkFilePath, const FString& MarkerFilePath, int64 DataSize)
 {
-	ResolveMapSPtr ResolveMap;
-	FString RuleFile;
-	FString StartRule;
-	RuleFileInfoPtr RuleFileInfo;
-};
+	FString Marker;
+	if (!FFileHelper::LoadFileToString(Marker, *MarkerFilePath))
+	{
+		return false;
+	}
+	return Marker == LexToString(DataSize) && FPlatformFileManager::Get().GetPlatformFile().FileSize(*RpkFilePath) == DataSize;
+}
+
+bool IsDirectoryWritable(const FString& Directory)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!PlatformFile.CreateDirectoryTree(*Directory))
+	{
+		return false;
+	}
+
+	const FString ProbeFilePath = FPaths::CreateTempFilename(*Directory, TEXT("Vitruvio_"), TEXT(".tmp"));
+	if (!FFileHelper::SaveStringToFile(FString(), *ProbeFilePath))
+	{
+		return false;
+	}
+	PlatformFile.DeleteFile(*ProbeFilePath);
+	return true;
+}
+
+/**
+ * Removes incomplete entries, entries unused for longer than Esri.Vitruvio.RulePackageStoreMaxAge days and, least recently used first,
+ * entries exceeding Esri.Vitruvio.RulePackageStoreBudget from the rpk store. An entry consists of the rpk, its marker and its unpack folder.
+ */
+void CleanupRpkStore(const FString& RpkStoreFolder)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	struct FStoreEntry
+	{
+		int64 Size = 0;
+		FDateTime LastUse = FDateTime::MinValue();
+		bool bComplete = false;
+	};
+
+	TMap<FString, FStoreEntry> Entries;
+	PlatformFile.IterateDirectoryStat(*RpkStoreFolder, [&](const TCHAR* Path, const FFileStatData& StatData) {
+		const FString Name = FPaths::GetBaseFilename(Path);
+		FStoreEntry& Entry = Entries.FindOrAdd(Name);
+
+		if (StatData.bIsDirectory)
+		{
+			PlatformFile.IterateDirectoryStatRecursively(Path, [&Entry](const TCHAR*, const FFileStatData& UnpackedStatData) {
+				Entry.Size += UnpackedStatData.bIsDirectory ? 0 : UnpackedStatData.FileSize;
+				return true;
+			});
+		}
+		else
+		{
+			Entry.Size += StatData.FileSize;
+			if (FPaths::GetExtension(Path, true) == RPK_MARKER_EXTENSION)
+			{
+				Entry.bComplete = true;
+				Entry.LastUse = StatData.ModificationTime;
+			}
+		}
+		return true;
+	});
+
+	auto RemoveEntry = [&](const FString& Name) {
+		const FString BasePath = FPaths::Combine(RpkStoreFolder, Name);
+		PlatformFile.DeleteFile(*(BasePath + RPK_MARKER_EXTENSION));
+		PlatformFile.DeleteFile(*(BasePath + TEXT(".rpk")));
+		PlatformFile.DeleteFile(*(BasePath + TEXT(".tmp")));
+		PlatformFile.DeleteDirectoryRecursively(*BasePath);
+		Entries.Remove(Name);
+	};
+
+	const FDateTime MinLastUse = FDateTime::UtcNow() - FTimespan::FromDays(FMath::Max(CVarRulePackageStoreMaxAge.GetValueOnAnyThread(), 0));
+	TArray<FString> Names;
+	Entries.GenerateKeyArray(Names);
+	for (const FString& Name : Names)
+	{
+		// Leftovers of interrupted writes never got a marker
+		const FStoreEntry& Entry = Entries[Name];
+		if (!Entry.bComplete || Entry.LastUse < MinLastUse)
+		{
+			RemoveEntry(Name);
+		}
+	}
+
+	int64 TotalSize = 0;
+	for (const auto& [Name, Entry] : Entries)
+	{
+		TotalSize += Entry.Size;
+	}
+
+	const int64 Budget = static_cast<int64>(FMath::Max(CVarRulePackageStoreBudget.GetValueOnAnyThread(), 0)) * 1024 * 1024;
+	if (TotalSize > Budget)
+	{
+		Entries.ValueSort([](const FStoreEntry& A, const FStoreEntry& B) { return A.LastUse < B.LastUse; });
+		Entries.GenerateKeyArray(Names);
+		for (const FString& Name : Names)
+		{
+			if (TotalSize <= Budget)
+			{
+				break;
+			}
+			TotalSize -= Entries[Name].Size;
+			RemoveEntry(Name);
+		}
+	}
+}
+
+FRuleInfoPtr CreateRuleInfo(const ResolveMapSPtr& ResolveMap, prt::Cache* Cache)
+{
+	VITRUVIO_SCOPE(STAT_Vitruvio_RuleFileInfo);
+
+	const std::wstring RuleFile = ResolveMap->findCGBKey();
+	const wchar_t* RuleFileUri = ResolveMap->getString(RuleFile.c_str());
+
+	prt::Status InfoStatus;
+	const RuleFileInfoPtr RuleFileInfo = prt_make_shared<const prt::RuleFileInfo>(prt::createRuleFileInfo(RuleFileUri, Cache, &InfoStatus));
+	if (!RuleFileInfo || InfoStatus != prt::STATUS_OK)
+	{
+		UE_LOG(LogUnrealPrt, Error, TEXT("could not get rule file info from rule file %s"), RuleFileUri)
+		return {};
+	}
+
+	const TSharedPtr<FRuleInfo> RuleInfo = MakeShared<FRuleInfo>();
+	RuleInfo->ResolveMap = ResolveMap;
+	RuleInfo->RuleFile = RuleFile;
+	RuleInfo->StartRule = prtu::detectStartRule(RuleFileInfo);
+	RuleInfo->RuleFileInfo = RuleFileInfo;
+	RuleInfo->AttributeSchema = Vitruvio::CreateAttributeSchema(RuleFileInfo);
+	return RuleInfo;
+}
 
 class FLoadResolveMapTask
 {
 	TLazyObjectPtr<URulePackage> LazyRulePackagePtr;
 	TPromise<ResolveMapSPtr> Promise;
 	TMap<TLazyObjectPtr<URulePackage>, ResolveMapSPtr>& ResolveMapCache;
+	TMap<FString, ResolveMapSPtr>& ContentResolveMapCache;
 	FCriticalSection& LoadResolveMapLock;
 	FString RpkFolder;
 
 public:
 	FLoadResolveMapTask(TPromise<ResolveMapSPtr>&& InPromise, const FString RpkFolder, const TLazyObjectPtr<URulePackage> LazyRulePackagePtr,
-						TMap<TLazyObjectPtr<URulePackage>, ResolveMapSPtr>& ResolveMapCache, FCriticalSection& LoadResolveMapLock)
+						TMap<TLazyObjectPtr<URulePackage>, ResolveMapSPtr>& ResolveMapCache,
+						TMap<FString, ResolveMapSPtr>& ContentResolveMapCache, FCriticalSection& LoadResolveMapLock)
 		: LazyRulePackagePtr(LazyRulePackagePtr), Promise(MoveTemp(InPromise)), ResolveMapCache(ResolveMapCache),
-		  LoadResolveMapLock(LoadResolveMapLock), RpkFolder(RpkFolder)
+		  ContentResolveMapCache(ContentResolveMapCache), LoadResolveMapLock(LoadResolveMapLock), RpkFolder(RpkFolder)
 	{
 	}
 
@@ -102,47 +246,101 @@ public:
 
 	void DoTask(ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
 	{
-		const FString UriPath = LazyRulePackagePtr->GetPathName();
+		VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_LoadResolveMap, TEXT("%s"), *LazyRulePackagePtr->GetName());
 
-		// Create rpk on disk for PRT
-		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
-
-		const FString RpkFile = FPaths::GetBaseFilename(UriPath, false) + TEXT(".rpk");
-		const FString RpkFilePath = FPaths::Combine(RpkFolder, RpkFile);
-		const FString RpkFolderPath = FPaths::GetPath(RpkFilePath);
+		const FString& ContentHash = LazyRulePackagePtr->ContentHash;
 
-		IFileManager::Get().Delete(*RpkFilePath);
-		PlatformFile.CreateDirectoryTree(*RpkFolderPath);
+		// Rule packages with identical content share one resolve map
+		{
+			FScopeLock Lock(&LoadResolveMapLock);
+			if (const ResolveMapSPtr* ContentResolveMap = ContentResolveMapCache.Find(ContentHash))
+			{
+				ResolveMapCache.Add(LazyRulePackagePtr, *ContentResolveMap);
+				Promise.SetValue(*ContentResolveMap);
+				return;
+			}
+		}
 
-		IFileHandle* RpkHandle = PlatformFile.OpenWrite(*RpkFilePath);
-		if (RpkHandle)
+		// The rpk store is content addressed, an rpk with a complete marker has already been written (and unpacked) by a previous session
+		const FString RpkBasePath = FPaths::Combine(RpkFolder, ContentHash);
+		const FString RpkFilePath = RpkBasePath + TEXT(".rpk");
+		const FString UnpackFolder = RpkBasePath;
+		if (!WriteRpk(RpkFilePath, RpkBasePath + RPK_MARKER_EXTENSION, UnpackFolder))
 		{
-			// Write file to disk
-			RpkHandle->Write(LazyRulePackagePtr->Data.GetData(), LazyRulePackagePtr->Data.Num());
-			RpkHandle->Flush();
-			delete RpkHandle;
+			Promise.SetValue(nullptr);
+			return;
+		}
 
-			// Create rpk
-			const std::wstring AbsoluteRpkPath(TCHAR_TO_WCHAR(*FPaths::ConvertRelativePathToFull(RpkFilePath)));
+		// Create rpk
+		const std::wstring AbsoluteRpkPath(TCHAR_TO_WCHAR(*FPaths::ConvertRelativePathToFull(RpkFilePath)));
+		const std::wstring AbsoluteUnpackPath(TCHAR_TO_WCHAR(*FPaths::ConvertRelativePathToFull(UnpackFolder)));
 
-			const std::wstring RpkFileUri = prtu::toFileURI(AbsoluteRpkPath);
-			prt::Status Status;
-			const ResolveMapSPtr ResolveMapPtr(prt::createResolveMap(RpkFileUri.c_str(), nullptr, &Status), PRTDestroyer());
+		const std::wstring RpkFileUri = prtu::toFileURI(AbsoluteRpkPath);
+		const std::wstring UnpackFolderUri = prtu::toFileURI(AbsoluteUnpackPath);
+		prt::Status Status;
+		const ResolveMapSPtr ResolveMapPtr(prt::createResolveMap(RpkFileUri.c_str(), UnpackFolderUri.c_str(), &Status), PRTDestroyer());
+		{
+			FScopeLock Lock(&LoadResolveMapLock);
+			ResolveMapCache.Add(LazyRulePackagePtr, ResolveMapPtr);
+			if (ResolveMapPtr)
 			{
-				FScopeLock Lock(&LoadResolveMapLock);
-				ResolveMapCache.Add(LazyRulePackagePtr, ResolveMapPtr);
-				Promise.SetValue(ResolveMapPtr);
+				ContentResolveMapCache.Add(ContentHash, ResolveMapPtr);
 			}
+			Promise.SetValue(ResolveMapPtr);
 		}
-		else
+	}
+
+private:
+	bool WriteRpk(const FString& RpkFilePath, const FString& MarkerFilePath, const FString& UnpackFolder) const
+	{
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+		FScopeLock Lock(&RpkStoreLock);
+
+		const int64 DataSize = LazyRulePackagePtr->GetDataSize();
+		if (IsRpkStored(RpkFilePath, MarkerFilePath, DataSize))
 		{
-			Promise.SetValue(nullptr);
+			// The marker time is the last use of the entry for the store cleanup
+			PlatformFile.SetTimeStamp(*MarkerFilePath, FDateTime::UtcNow());
+			return PlatformFile.CreateDirectoryTree(*UnpackFolder);
+		}
+
+		// Whatever is left of an incomplete entry is replaced
+		PlatformFile.DeleteFile(*MarkerFilePath);
+		PlatformFile.DeleteFile(*RpkFilePath);
+		PlatformFile.DeleteDirectoryRecursively(*UnpackFolder);
+		PlatformFile.CreateDirectoryTree(*UnpackFolder);
+
+		// Only read the rpk data if it is not in the store yet, it is released again once written
+		const TArray<uint8> Data = LazyRulePackagePtr->LoadData();
+
+		// Write to a temporary file first so that an interrupted write never leaves a truncated rpk in the store
+		const FString TempRpkFilePath = FPaths::CreateTempFilename(*RpkFolder, TEXT("Vitruvio_"), TEXT(".tmp"));
+		IFileHandle* RpkHandle = PlatformFile.OpenWrite(*TempRpkFilePath);
+		if (!RpkHandle)
+		{
+			return false;
+		}
+
+		RpkHandle->Write(Data.GetData(), Data.Num());
+		RpkHandle->Flush();
+		delete RpkHandle;
+
+		if (!PlatformFile.MoveFile(*RpkFilePath, *TempRpkFilePath))
+		{
+			PlatformFile.DeleteFile(*TempRpkFilePath);
+			return false;
 		}
+
+		// Only written once the rpk is complete, an rpk without marker is never used
+		return FFileHelper::SaveStringToFile(LexToString(DataSize), *MarkerFilePath);
 	}
 };
 
 void SetInitialShapeGeometry(const InitialShapeBuilderUPtr& InitialShapeBuilder, const FInitialShape& InitialShape)
 {
+	VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_BuildInitialShapes, TEXT("InitialShape %lld"), InitialShape.InitialShapeIndex);
+
 	std::vector<double> vertexCoords;
 	std::vector<uint32_t> indices;
 	std::vector<uint32_t> faceCounts;
@@ -221,7 +419,8 @@ void SetInitialShapeGeometry(const InitialShapeBuilderUPtr& InitialShapeBuilder,
 }
 
 AttributeMapUPtr EvaluateRuleAttributes(const std::wstring& RuleFile, const std::wstring& StartRule, 
-										const ResolveMapSPtr& ResolveMapPtr, const FInitialShape& InitialShape, prt::Cache* Cache)
+										const ResolveMapSPtr& ResolveMapPtr, const FInitialShape& InitialShape, prt::Cache* Cache,
+										const prt::AttributeMap* GenerateOptions)
 {
 	TArray<AttributeMapBuilderUPtr> AttributeMapBuilders;
 	AttributeMapBuilders.Add(AttributeMapBuilderUPtr(prt::AttributeMapBuilder::create()));
@@ -241,12 +440,30 @@ AttributeMapUPtr EvaluateRuleAttributes(const std::wstring& RuleFile, const std:
 	const AttributeMapUPtr AttributeEncodeOptions = prtu::createValidatedOptions(ATTRIBUTE_EVAL_ENCODER_ID);
 	const AttributeMapNOPtrVector EncoderOptions = {AttributeEncodeOptions.get()};
 
-	generate(InitialShapes.data(), InitialShapes.size(), nullptr, EncoderIds.data(), EncoderIds.size(), EncoderOptions.data(), &UnrealCallbacks,
-				  Cache, nullptr);
+	{
+		VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_EvaluateAttributes, TEXT("InitialShape %lld"), InitialShape.InitialShapeIndex);
+		generate(InitialShapes.data(), InitialShapes.size(), nullptr, EncoderIds.data(), EncoderIds.size(), EncoderOptions.data(), &UnrealCallbacks,
+				 Cache, nullptr, GenerateOptions);
+	}
 
 	return AttributeMapUPtr(AttributeMapBuilders[0]->createAttributeMap());
 }
 
+// Additional job threads so that interactive calls can start even if all admitted background calls are waiting for PRT workers
+constexpr int32 NumInteractivePrtJobThreads = 2;
+
+int32 GetNumPrtJobThreads(const FPrtWorkerGovernor& PrtWorkerGovernor)
+{
+	return PrtWorkerGovernor.GetWorkerBudget() + PrtWorkerGovernor.GetMaxQueuedCalls() + NumInteractivePrtJobThreads;
+}
+
+template <typename CallableType>
+auto EnqueuePrtJob(FQueuedThreadPool& PrtJobPool, EPrtCallPriority Priority, CallableType&& Callable)
+{
+	const EQueuedWorkPriority QueuedWorkPriority = Priority == EPrtCallPriority::Interactive ? EQueuedWorkPriority::High : EQueuedWorkPriority::Normal;
+	return AsyncPool(PrtJobPool, Forward<CallableType>(Callable), nullptr, QueuedWorkPriority);
+}
+
 TArray<int64> GetInitialShapeIndices(const TArray<FInitialShape>& InitialShapes)
 {
 	TArray<int64> Indices;
@@ -257,6 +474,12 @@ TArray<int64> GetInitialShapeIndices(const TArray<FInitialShape>& InitialShapes)
 	return Indices;
 }
 
+// Only evaluated by VITRUVIO_SCOPE_TAGGED while the Vitruvio trace channel is enabled
+FString FormatTracePrefix(const FString& TraceTag)
+{
+	return TraceTag.IsEmpty() ? FString() : TraceTag + TEXT(": ");
+}
+
 void CleanupTempRpkFolder()
 {
 	FString TempDir(WCHAR_TO_TCHAR(prtu::temp_directory_path().c_str()));
@@ -311,6 +534,50 @@ FString GetPrtDllPath()
 	return FPaths::Combine(*BaseDir, TEXT("com.esri.prt.core.dll"));
 }
 
+// Lets the encoder stream the meshes part by part instead of concatenating them first (see IUnrealCallbacks::beginMesh), reference instance
+// materials by id (see IUnrealCallbacks::addMaterial) and pass on the geometry in chunks of initial shapes (see IUnrealCallbacks::endChunk),
+// or per initial shape if the callbacks keep output clusters apart (see IUnrealCallbacks::beginInitialShape).
+// Callbacks which convert meshes directly into render data let the encoder prepare the render streams instead (see
+// IUnrealCallbacks::addRenderMesh). Options the loaded encoder does not declare are left out, since validation would otherwise reject all
+// options. Such encoders keep calling addMesh and addInstance for the whole generate call.
+AttributeMapUPtr CreateUnrealEncoderOptions(const UnrealCallbacks& Callbacks, const TSet<FString>& SupportedOptions)
+{
+	AttributeMapBuilderUPtr OptionsBuilder(prt::AttributeMapBuilder::create());
+	if (SupportedOptions.Contains(TEXT("streamMeshes")))
+	{
+		OptionsBuilder->setBool(L"streamMeshes", true);
+	}
+	if (SupportedOptions.Contains(TEXT("emitMaterialIds")))
+	{
+		OptionsBuilder->setBool(L"emitMaterialIds", true);
+	}
+	if (SupportedOptions.Contains(TEXT("streamChunkSize")))
+	{
+		OptionsBuilder->setInt(L"streamChunkSize", FMath::Max(Callbacks.GetStreamChunkSize(), 0));
+	}
+	if (SupportedOptions.Contains(TEXT("splitInitialShapes")))
+	{
+		OptionsBuilder->setBool(L"splitInitialShapes", Callbacks.HasOutputClusters());
+	}
+
+	if (Callbacks.UsesDirectMeshConversion() && SupportedOptions.Contains(TEXT("emitRenderStreams")) && SupportedOptions.Contains(TEXT("vertexOffset")))
+	{
+		const FVector& Offset = Callbacks.GetOffset();
+		const double VertexOffset[3] = {Offset.X, Offset.Y, Offset.Z};
+
+		OptionsBuilder->setBool(L"emitRenderStreams", true);
+		OptionsBuilder->setFloatArray(L"vertexOffset", VertexOffset, 3);
+	}
+
+	const AttributeMapUPtr UnvalidatedOptions(OptionsBuilder->createAttributeMapAndReset());
+	if (AttributeMapUPtr Options = prtu::createValidatedOptions(UNREAL_GEOMETRY_ENCODER_ID, UnvalidatedOptions.get()))
+	{
+		return Options;
+	}
+
+	return prtu::createValidatedOptions(UNREAL_GEOMETRY_ENCODER_ID);
+}
+
 } // namespace
 
 void VitruvioModule::InitializePrt()
@@ -338,10 +605,41 @@ void VitruvioModule::InitializePrt()
 
 	PrtCache.reset(prt::CacheObject::create(prt::CacheObject::CACHE_TYPE_DEFAULT));
 
-	const FString TempDir(WCHAR_TO_TCHAR(prtu::temp_directory_path().c_str()));
-	RpkFolder = FPaths::CreateTempFilename(*TempDir, TEXT("Vitruvio_"), TEXT(""));
+	UnrealEncoderOptionKeys.Empty();
+	if (const AttributeMapUPtr DefaultEncoderOptions = prtu::createValidatedOptions(UNREAL_GEOMETRY_ENCODER_ID))
+	{
+		size_t KeyCount = 0;
+		wchar_t const* const* Keys = DefaultEncoderOptions->getKeys(&KeyCount);
+		for (size_t KeyIndex = 0; KeyIndex < KeyCount; ++KeyIndex)
+		{
+			UnrealEncoderOptionKeys.Add(WCHAR_TO_TCHAR(Keys[KeyIndex]));
+		}
+	}
+
+	RpkFolder = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Vitruvio"), TEXT("RulePackages"));
+	if (IsDirectoryWritable(RpkFolder))
+	{
+		CleanupRpkStore(RpkFolder);
+	}
+	else
+	{
+		// eg. packaged builds installed to a read only location, fall back to a temporary folder which is deleted on shutdown
+		const FString TempDir(WCHAR_TO_TCHAR(prtu::temp_directory_path().c_str()));
+		RpkFolder = FPaths::CreateTempFilename(*TempDir, TEXT("Vitruvio_"), TEXT(""));
+		bTemporaryRpkFolder = true;
+	}
+
+	OcclusionCache.Reset();
 
-	OcclusionSet.reset(prt::OcclusionSet::create());
+	// Stack size 0 uses the platform default since PRT needs more than the thread pool default. The threads are created upfront, the wrapper
+	// limits how many of them run jobs so that the pool follows changes of the worker budget and queue bound (see GetPrtJobPool).
+	const int32 NumPrtJobThreads = GetNumPrtJobThreads(PrtWorkerGovernor);
+	const int32 MaxPrtJobThreads = FMath::Max(NumPrtJobThreads, 2 * FPlatformMisc::NumberOfCoresIncludingHyperthreads() + NumInteractivePrtJobThreads);
+	PrtJobThreadPool = FQueuedThreadPool::Allocate();
+	PrtJobThreadPool->Create(MaxPrtJobThreads, 0, TPri_Normal, TEXT("VitruvioPrtJobs"));
+
+	PrtJobConcurrency = NumPrtJobThreads;
+	PrtJobPool = new FQueuedThreadPoolWrapper(PrtJobThreadPool, NumPrtJobThreads);
 }
 
 void VitruvioModule::StartupModule()
@@ -375,6 +673,19 @@ void VitruvioModule::ShutdownModule()
 
 	UE_LOG(LogUnrealPrt, Display, TEXT("PRT calls finished. Shutting down."))
 
+	if (PrtJobPool)
+	{
+		PrtJobPool->Destroy();
+		delete PrtJobPool;
+		PrtJobPool = nullptr;
+	}
+	if (PrtJobThreadPool)
+	{
+		PrtJobThreadPool->Destroy();
+		delete PrtJobThreadPool;
+		PrtJobThreadPool = nullptr;
+	}
+
 	if (PrtDllHandle)
 	{
 		FPlatformProcess::FreeDllHandle(PrtDllHandle);
@@ -385,13 +696,28 @@ void VitruvioModule::ShutdownModule()
 		PrtLibrary->destroy();
 	}
 
-	CleanupTempRpkFolder();
+	TextureCache.UnwatchDirectories();
 
-	
+	CleanupTempRpkFolder();
+	if (bTemporaryRpkFolder)
+	{
+		FPlatformFileManager::Get().GetPlatformFile().DeleteDirectoryRecursively(*RpkFolder);
+	}
 
 	UE_LOG(LogUnrealPrt, Display, TEXT("Shutdown complete"))
 }
 
+FQueuedThreadPool& VitruvioModule::GetPrtJobPool() const
+{
+	// Esri.Vitruvio.PrtWorkerThreads and Esri.Vitruvio.MaxQueuedPrtCalls can change at runtime
+	const int32 NumPrtJobThreads = GetNumPrtJobThreads(PrtWorkerGovernor);
+	if (PrtJobConcurrency.Exchange(NumPrtJobThreads) != NumPrtJobThreads)
+	{
+		PrtJobPool->SetMaxConcurrency(NumPrtJobThreads);
+	}
+	return *PrtJobPool;
+}
+
 Vitruvio::FTextureData VitruvioModule::DecodeTexture(UObject* Outer, const FString& Path, const FString& Key) const
 {
 	const prt::AttributeMap* TextureMetadataAttributeMap = prt::createTextureMetadata(*Path, PrtCache.get());
@@ -405,21 +731,37 @@ Vitruvio::FTextureData VitruvioModule::DecodeTexture(UObject* Outer, const FStri
 	return Vitruvio::DecodeTexture(Outer, Key, Path, TextureMetadata, std::move(Buffer), BufferSize);
 }
 
-FBatchGenerateResult VitruvioModule::BatchGenerateAsync(TArray<FInitialShape> InitialShapes, bool bEnableOcclusionQueries, TArray<FInitialShape> OccluderOnlyShapes) const
+FBatchGenerateResult VitruvioModule::BatchGenerateAsync(TArray<FInitialShape> InitialShapes, bool bEnableOcclusionQueries, TArray<FInitialShape> OccluderOnlyShapes,
+														 EPrtCallPriority Priority, bool bInstanceIdenticalShapes, FString TraceTag) const
 {
     const FBatchGenerateResult::FTokenPtr Token = MakeShared<FGenerateToken>();
     	
 	CHECK_PRT_INITIALIZED_ASYNC(FBatchGenerateResult, Token)
 
-	FBatchGenerateResult::FFutureType ResultFuture = Async(EAsyncExecution::Thread, [this, Token, bEnableOcclusionQueries, InitialShapes = MoveTemp(InitialShapes), OccluderOnlyShapes = MoveTemp(OccluderOnlyShapes)]() mutable {
-		FGenerateResultDescription Result = BatchGenerate(MoveTemp(InitialShapes), bEnableOcclusionQueries, MoveTemp(OccluderOnlyShapes));
+	PrtWorkerGovernor.BeginCall();
+
+	FBatchGenerateResult::FFutureType ResultFuture = EnqueuePrtJob(GetPrtJobPool(), Priority, [this, Token, bEnableOcclusionQueries, Priority, bInstanceIdenticalShapes, InitialShapes = MoveTemp(InitialShapes), OccluderOnlyShapes = MoveTemp(OccluderOnlyShapes), TraceTag = MoveTemp(TraceTag)]() mutable {
+		ON_SCOPE_EXIT
+		{
+			PrtWorkerGovernor.EndCall();
+		};
+
+		// Skip calls which have been superseded while they were queued
+		if (Token->IsInvalid())
+		{
+			return FBatchGenerateResult::ResultType { Token, {} };
+		}
+
+		FGenerateResultDescription Result = BatchGenerate(MoveTemp(InitialShapes), bEnableOcclusionQueries, MoveTemp(OccluderOnlyShapes), Priority,
+														  bInstanceIdenticalShapes, TraceTag);
 		return FBatchGenerateResult::ResultType { Token, MoveTemp(Result) };
 	});
 
 	return FBatchGenerateResult { MoveTemp(ResultFuture), Token };
 }
 
-FGenerateResultDescription VitruvioModule::BatchGenerate(TArray<FInitialShape> InitialShapes, bool bEnableOcclusionQueries, TArray<FInitialShape> OccluderOnlyShapes) const
+FGenerateResultDescription VitruvioModule::BatchGenerate(TArray<FInitialShape> InitialShapes, bool bEnableOcclusionQueries, TArray<FInitialShape> OccluderOnlyShapes,
+														  EPrtCallPriority Priority, bool bInstanceIdenticalShapes, const FString& TraceTag) const
 {
 	if (InitialShapes.IsEmpty())
 	{
@@ -428,10 +770,33 @@ FGenerateResultDescription VitruvioModule::BatchGenerate(TArray<FInitialShape> I
 	
 	CHECK_PRT_INITIALIZED()
 
+	// Identical initial shapes would still get different occlusion results
+	if (bInstanceIdenticalShapes && !bEnableOcclusionQueries)
+	{
+		return BatchGenerateInstanced(MoveTemp(InitialShapes), Priority, TraceTag);
+	}
+
+	TArray<int64> InitialShapeIndices = GetInitialShapeIndices(InitialShapes);
+
+	const FGenerateResultCache::FKey CacheKey = FGenerateResultCache::ComputeKey(true, InitialShapes, bEnableOcclusionQueries, OccluderOnlyShapes);
+
+	// Cache hits are counted like generate calls, so every completion notification is preceded by a matching increment
 	GenerateCallsCounter.Add(InitialShapes.Num());
 
+	if (const TSharedPtr<const FGenerateResultDescription> CachedResult = GenerateResultCache.Get(CacheKey))
+	{
+		if (bEnableOcclusionQueries)
+		{
+			// Occlusion handles of these shapes might stem from a different state, recreate them lazily if they are queried again
+			InvalidateOcclusionHandles(InitialShapeIndices);
+		}
+
+		GenerateCallsCounter.Subtract(InitialShapes.Num());
+		NotifyGenerateCompleted();
+		return *CachedResult;
+	}
+
 	const int NumInitialShapes = InitialShapes.Num();
-	TArray<int64> InitialShapeIndices = GetInitialShapeIndices(InitialShapes);
 	TArray<int64> OccluderShapeIndices = GetInitialShapeIndices(OccluderOnlyShapes);
 	
 	TMap<URulePackage*, TArray<FInitialShape>> RulePackages;
@@ -447,38 +812,34 @@ FGenerateResultDescription VitruvioModule::BatchGenerate(TArray<FInitialShape> I
 	ExtractRulePackage(MoveTemp(InitialShapes));
 	ExtractRulePackage(MoveTemp(OccluderOnlyShapes));
 
-	TArray<TTuple<TFuture<ResolveMapSPtr>, TArray<FInitialShape>>> ResolveMapFutures;
+	TArray<TTuple<URulePackage*, TFuture<ResolveMapSPtr>, TArray<FInitialShape>>> ResolveMapFutures;
 	for (auto& [RulePackage, InitialShapesByRpk] : RulePackages)
 	{
-		ResolveMapFutures.Add(MakeTuple(LoadResolveMapAsync(RulePackage), MoveTemp(InitialShapesByRpk)));
+		ResolveMapFutures.Add(MakeTuple(RulePackage, LoadResolveMapAsync(RulePackage), MoveTemp(InitialShapesByRpk)));
 	}
 
-	TArray<TTuple<FStartRuleInfo, TArray<FInitialShape>>> RuleInfoInitialShapes;
-	for (auto& [ResolveMapFuture, InitialShapesByRpk] : ResolveMapFutures)
+	TArray<TTuple<FRuleInfoPtr, TArray<FInitialShape>>> RuleInfoInitialShapes;
+	for (auto& [RulePackage, ResolveMapFuture, InitialShapesByRpk] : ResolveMapFutures)
 	{
-		const ResolveMapSPtr ResolveMap = ResolveMapFuture.Get();
-
-		const std::wstring RuleFile = ResolveMap->findCGBKey();
-		const wchar_t* RuleFileUri = ResolveMap->getString(RuleFile.c_str());
-
-		const RuleFileInfoPtr RuleFileInfo = prt_make_shared<const prt::RuleFileInfo>(prt::createRuleFileInfo(RuleFileUri));
-		const std::wstring StartRule = prtu::detectStartRule(RuleFileInfo);
-		
-		FStartRuleInfo StartRuleInfo { ResolveMap, RuleFile.c_str(), StartRule.c_str(), RuleFileInfo };
+		const FRuleInfoPtr RuleInfo = GetRuleInfo(RulePackage, ResolveMapFuture.Get());
+		if (!RuleInfo)
+		{
+			continue;
+		}
 
-		RuleInfoInitialShapes.Add(MakeTuple(StartRuleInfo, MoveTemp(InitialShapesByRpk)));
+		RuleInfoInitialShapes.Add(MakeTuple(RuleInfo, MoveTemp(InitialShapesByRpk)));
 	}
 	
 	auto ForeachInitialShape = [&RuleInfoInitialShapes](bool bOccluders, bool bNonOccluders, auto Fun)
 	{
 		int InitialShapeIndex = 0;
-		for (auto& [StartRuleInfo, InitialShapesByRpk] : RuleInfoInitialShapes)
+		for (auto& [RuleInfo, InitialShapesByRpk] : RuleInfoInitialShapes)
 		{
 			for (const FInitialShape& InitialShape : InitialShapesByRpk)
 			{
 				if ((bOccluders && InitialShape.bOccluderOnly) || (bNonOccluders && !InitialShape.bOccluderOnly))
 				{
-					Fun(InitialShapeIndex, InitialShape, StartRuleInfo);
+					Fun(InitialShapeIndex, InitialShape, RuleInfo);
 
 					InitialShapeIndex++;
 				}
@@ -490,20 +851,18 @@ FGenerateResultDescription VitruvioModule::BatchGenerate(TArray<FInitialShape> I
 	AttributeMapVector AttributeMaps;
 	
 	TMap<int64, const prt::InitialShape*> InitialShapeByIndex;
-	TMap<const prt::InitialShape*, int64> IndexByInitialShape;
 
-	ForeachInitialShape(false, true, [&](int32, const FInitialShape& InitialShape, const FStartRuleInfo& StartRuleInfo)
+	ForeachInitialShape(false, true, [&](int32, const FInitialShape& InitialShape, const FRuleInfoPtr& RuleInfo)
 	{
 		InitialShapeBuilderUPtr InitialShapeBuilder(prt::InitialShapeBuilder::create());
 		SetInitialShapeGeometry(InitialShapeBuilder, InitialShape);
 
 		AttributeMapUPtr Attributes = Vitruvio::CreateAttributeMap(InitialShape.Attributes);
-		InitialShapeBuilder->setAttributes(*StartRuleInfo.RuleFile, *StartRuleInfo.StartRule, InitialShape.RandomSeed, L"",
-			Attributes.get(), StartRuleInfo.ResolveMap.get());
+		InitialShapeBuilder->setAttributes(RuleInfo->RuleFile.c_str(), RuleInfo->StartRule.c_str(), InitialShape.RandomSeed, L"",
+			Attributes.get(), RuleInfo->ResolveMap.get());
 		InitialShapeUPtr Shape(InitialShapeBuilder->createInitialShape());
 
 		InitialShapeByIndex.Add(InitialShape.InitialShapeIndex, Shape.get());
-		IndexByInitialShape.Add(Shape.get(), InitialShape.InitialShapeIndex);
 		InitialShapeUPtrs.push_back(std::move(Shape));
 		AttributeMaps.push_back(std::move(Attributes));
 	});
@@ -523,15 +882,20 @@ FGenerateResultDescription VitruvioModule::BatchGenerate(TArray<FInitialShape> I
 		const AttributeMapUPtr AttributeEncodeOptions = prtu::createValidatedOptions(ATTRIBUTE_EVAL_ENCODER_ID);
 		const AttributeMapNOPtrVector EncoderOptions = {AttributeEncodeOptions.get()};
 
-		AttributeMapBuilderUPtr GenerateOptionsBuilder(prt::AttributeMapBuilder::create());
-		GenerateOptionsBuilder->setInt(L"numberWorkerThreads", FPlatformMisc::NumberOfCores());
-		const AttributeMapUPtr GenerateOptions(GenerateOptionsBuilder->createAttributeMapAndReset());
-
 		TArray<const prt::InitialShape*> InitialShapesPtrs;
 		InitialShapeByIndex.GenerateValueArray(InitialShapesPtrs);
-		prt::Status GenerateStatus = generate(InitialShapesPtrs.GetData(), InitialShapesPtrs.Num(), nullptr, EncoderIds.data(),
-			EncoderIds.size(), EncoderOptions.data(), OutputHandler.Get(),
-					  PrtCache.get(), nullptr, GenerateOptions.get());
+
+		const FPrtWorkerGovernor::FScopedWorkers Workers(PrtWorkerGovernor, InitialShapesPtrs.Num(), Priority);
+		AttributeMapBuilderUPtr GenerateOptionsBuilder(prt::AttributeMapBuilder::create());
+		GenerateOptionsBuilder->setInt(L"numberWorkerThreads", Workers.GetNumWorkers());
+		const AttributeMapUPtr GenerateOptions(GenerateOptionsBuilder->createAttributeMapAndReset());
+		prt::Status GenerateStatus;
+		{
+			VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_EvaluateAttributes, TEXT("%s%d InitialShapes"), *FormatTracePrefix(TraceTag), InitialShapesPtrs.Num());
+			GenerateStatus = generate(InitialShapesPtrs.GetData(), InitialShapesPtrs.Num(), nullptr, EncoderIds.data(),
+				EncoderIds.size(), EncoderOptions.data(), OutputHandler.Get(),
+						  PrtCache.get(), nullptr, GenerateOptions.get());
+		}
 
 		if (GenerateStatus != prt::STATUS_OK)
 		{
@@ -540,11 +904,11 @@ FGenerateResultDescription VitruvioModule::BatchGenerate(TArray<FInitialShape> I
 			return {};
 		}
 		
-		ForeachInitialShape(false, true, [&](int32 Index, const FInitialShape&, const FStartRuleInfo& StartRuleInfo)
+		ForeachInitialShape(false, true, [&](int32 Index, const FInitialShape&, const FRuleInfoPtr& RuleInfo)
 		{
 			const FAttributeMapPtr AttributeMap = MakeShared<FAttributeMap>(
 				AttributeMapUPtr(EvaluateAttributeMapBuilders[Index]->createAttributeMapAndReset()),
-				StartRuleInfo.RuleFileInfo);
+				RuleInfo);
 			EvaluatedAttributes.Add(AttributeMap);
 		});
 	}
@@ -553,122 +917,134 @@ FGenerateResultDescription VitruvioModule::BatchGenerate(TArray<FInitialShape> I
 	TArray<AttributeMapBuilderUPtr> GenerateAttributeMapBuilders;
 	TSharedPtr<UnrealCallbacks> GenerateOutputHandler(new UnrealCallbacks(GenerateAttributeMapBuilders));
 	
-	auto UnlockOcclusionLock = [bEnableOcclusionQueries](FCriticalSection& OcclusionLock)
-	{
-		if (bEnableOcclusionQueries)
-		{
-			OcclusionLock.Unlock();
-		}
-	};
+	// Pins the occlusion set used by this call, invalidated handles are disposed once no call uses the set anymore
+	TOptional<FOcclusionCache::FScopedSnapshot> OcclusionSnapshot;
 
 	if (bEnableOcclusionQueries)
 	{
-		OcclusionLock.Lock();
-					
 		InvalidateOcclusionHandles(InitialShapeIndices);
 
 		ForeachInitialShape(true, false, [&]
-			(int32, const FInitialShape& InitialShape, const FStartRuleInfo& StartRuleInfo)
+			(int32, const FInitialShape& InitialShape, const FRuleInfoPtr& RuleInfo)
 		{
 			InitialShapeBuilderUPtr InitialShapeBuilder(prt::InitialShapeBuilder::create());
 			AttributeMapBuilderUPtr AttributeMapBuilder(prt::AttributeMapBuilder::create());
 			SetInitialShapeGeometry(InitialShapeBuilder, InitialShape);
 			
 			AttributeMapUPtr Attributes = Vitruvio::CreateAttributeMap(InitialShape.Attributes);
-			InitialShapeBuilder->setAttributes(*StartRuleInfo.RuleFile, *StartRuleInfo.StartRule, InitialShape.RandomSeed, L"",
-				Attributes.get(), StartRuleInfo.ResolveMap.get());
+			InitialShapeBuilder->setAttributes(RuleInfo->RuleFile.c_str(), RuleInfo->StartRule.c_str(), InitialShape.RandomSeed, L"",
+				Attributes.get(), RuleInfo->ResolveMap.get());
 			
 			InitialShapeUPtr Shape(InitialShapeBuilder->createInitialShape());
 
 			InitialShapeByIndex.Add(InitialShape.InitialShapeIndex, Shape.get());
-			IndexByInitialShape.Add(Shape.get(), InitialShape.InitialShapeIndex);
 			InitialShapeUPtrs.push_back(std::move(Shape));
 			AttributeMaps.push_back(std::move(Attributes));
 		});
-			
-		if (!InitialShapeByIndex.IsEmpty())
+
+		TArray<int64> OcclusionInitialShapeIndices;
+		InitialShapeByIndex.GenerateKeyArray(OcclusionInitialShapeIndices);
+		OcclusionSnapshot.Emplace(OcclusionCache, OcclusionInitialShapeIndices);
+
+		const TArray<int64>& MissingInitialShapeIndices = OcclusionSnapshot->GetMissingInitialShapeIndices();
+		if (!MissingInitialShapeIndices.IsEmpty())
 		{
 			TArray<prt::OcclusionSet::Handle> NewOcclusionHandles;
 			TArray<const prt::InitialShape*> OcclusionShapesArray;
 
-			for (const auto& [InitialShape, InitialShapeIndex] : IndexByInitialShape)
+			for (const int64 InitialShapeIndex : MissingInitialShapeIndices)
 			{
-				if (!OcclusionHandleCache.Contains(InitialShapeIndex))
-				{
-					OcclusionShapesArray.Add(InitialShape);
-				}
+				OcclusionShapesArray.Add(InitialShapeByIndex[InitialShapeIndex]);
 			}
 			
 			NewOcclusionHandles.SetNum(OcclusionShapesArray.Num());
+
+			const FPrtWorkerGovernor::FScopedWorkers OccluderWorkers(PrtWorkerGovernor, OcclusionShapesArray.Num(), Priority);
+			AttributeMapBuilderUPtr OccluderOptionsBuilder(prt::AttributeMapBuilder::create());
+			OccluderOptionsBuilder->setInt(L"numberWorkerThreads", OccluderWorkers.GetNumWorkers());
+			const AttributeMapUPtr OccluderOptions(OccluderOptionsBuilder->createAttributeMapAndReset());
 	
-			const prt::Status GenerateOccludersStatus =  generateOccluders(OcclusionShapesArray.GetData(), OcclusionShapesArray.Num(), NewOcclusionHandles.GetData(), nullptr, 0,
-	nullptr, GenerateOutputHandler.Get(), PrtCache.get(), OcclusionSet.get());
+			prt::Status GenerateOccludersStatus;
+			{
+				VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_GenerateOccluders, TEXT("%s%d InitialShapes"), *FormatTracePrefix(TraceTag), OcclusionShapesArray.Num());
+				GenerateOccludersStatus = generateOccluders(OcclusionShapesArray.GetData(), OcclusionShapesArray.Num(), NewOcclusionHandles.GetData(), nullptr, 0,
+	nullptr, GenerateOutputHandler.Get(), PrtCache.get(), OcclusionSnapshot->GetOcclusionSet(), OccluderOptions.get());
+			}
 
 			if (GenerateOccludersStatus != prt::STATUS_OK)
 			{
 				GenerateCallsCounter.Decrement();
-
-				UnlockOcclusionLock(OcclusionLock);
 				
 				UE_LOG(LogUnrealPrt, Error, TEXT("PRT generateOccluders failed: %hs"), prt::getStatusDescription(GenerateOccludersStatus))
 				return {};
 			}
 
-			for (int32 OcclusionShapeIndex = 0; OcclusionShapeIndex < OcclusionShapesArray.Num(); ++OcclusionShapeIndex)
-			{
-				const prt::InitialShape* InitialShape = OcclusionShapesArray[OcclusionShapeIndex];
-				prt::OcclusionSet::Handle OcclusionHandle = NewOcclusionHandles[OcclusionShapeIndex];
-				int64 OcclusionInitialShapeIndex = IndexByInitialShape[InitialShape];
-
-				OcclusionHandleCache.Add(OcclusionInitialShapeIndex, OcclusionHandle);
-			}
+			OcclusionSnapshot->AddOccluders(MissingInitialShapeIndices, NewOcclusionHandles);
 		}
 	}
 
 	// Generate
+	TArray<int32> OutputClusters;
+	bool bHasOutputClusters = false;
+	ForeachInitialShape(false, true, [&](int32, const FInitialShape& InitialShape, const FRuleInfoPtr&)
+	{
+		OutputClusters.Add(InitialShape.OutputCluster);
+		bHasOutputClusters |= InitialShape.OutputCluster != 0;
+	});
+	
+	// Encoders without splitInitialShapes can not keep the clusters apart, all initial shapes form one generated model then
+	if (bHasOutputClusters && UnrealEncoderOptionKeys.Contains(TEXT("splitInitialShapes")))
+	{
+		GenerateOutputHandler->SetOutputClusters(MoveTemp(OutputClusters));
+	}
+
 	AttributeMapBuilderUPtr AttributeMapBuilder(prt::AttributeMapBuilder::create());
 
 	const std::vector UnrealEncoderIds = { UNREAL_GEOMETRY_ENCODER_ID };
-	const AttributeMapUPtr UnrealEncoderOptions(prtu::createValidatedOptions(UNREAL_GEOMETRY_ENCODER_ID));
+	const AttributeMapUPtr UnrealEncoderOptions(CreateUnrealEncoderOptions(*GenerateOutputHandler, UnrealEncoderOptionKeys));
 	const AttributeMapNOPtrVector GenerateEncoderOptions = {UnrealEncoderOptions.get()};
 
+	const FPrtWorkerGovernor::FScopedWorkers Workers(PrtWorkerGovernor, NumInitialShapes, Priority);
 	AttributeMapBuilderUPtr GenerateOptionsBuilder(prt::AttributeMapBuilder::create());
-	GenerateOptionsBuilder->setInt(L"numberWorkerThreads", FPlatformMisc::NumberOfCores());
+	GenerateOptionsBuilder->setInt(L"numberWorkerThreads", Workers.GetNumWorkers());
 	const AttributeMapUPtr GenerateOptions(GenerateOptionsBuilder->createAttributeMapAndReset());
 
-	prt::OcclusionSet* OcclusionSetPtr = bEnableOcclusionQueries ? OcclusionSet.get() : nullptr;
+	prt::OcclusionSet* OcclusionSetPtr = bEnableOcclusionQueries ? OcclusionSnapshot->GetOcclusionSet() : nullptr;
 	TArray<const prt::InitialShape*> InitialShapePtrs;
 	TArray<prt::OcclusionSet::Handle> OcclusionHandles;
 
-	ForeachInitialShape(false,  true, [&](int32, const FInitialShape& InitialShape, const FStartRuleInfo& StartRuleInfo)
+	ForeachInitialShape(false,  true, [&](int32, const FInitialShape& InitialShape, const FRuleInfoPtr& RuleInfo)
 	{
 		const prt::InitialShape* InitialShapePtr = InitialShapeByIndex[InitialShape.InitialShapeIndex];
 		InitialShapePtrs.Add(InitialShapePtr);
 
 		if (bEnableOcclusionQueries)
 		{
-			OcclusionHandles.Add(OcclusionHandleCache[InitialShape.InitialShapeIndex]);
+			OcclusionHandles.Add(OcclusionSnapshot->GetHandle(InitialShape.InitialShapeIndex));
 		}
 	});
 
 	if (bEnableOcclusionQueries)
 	{
-		ForeachInitialShape(true, false, [&](int32, const FInitialShape& InitialShape, const FStartRuleInfo& StartRuleInfo)
+		ForeachInitialShape(true, false, [&](int32, const FInitialShape& InitialShape, const FRuleInfoPtr& RuleInfo)
 		{
-			OcclusionHandles.Add(OcclusionHandleCache[InitialShape.InitialShapeIndex]);
+			OcclusionHandles.Add(OcclusionSnapshot->GetHandle(InitialShape.InitialShapeIndex));
 		});
 	}
 
 	prt::OcclusionSet::Handle* OcclusionHandlesPtr = bEnableOcclusionQueries ? OcclusionHandles.GetData() : nullptr;
 	
-	prt::Status GenerateStatus = generate(InitialShapePtrs.GetData(), InitialShapePtrs.Num(), OcclusionHandlesPtr,
-		UnrealEncoderIds.data(), UnrealEncoderIds.size(), GenerateEncoderOptions.data(), GenerateOutputHandler.Get(),
-		PrtCache.get(), OcclusionSetPtr, GenerateOptions.get());
+	prt::Status GenerateStatus;
+	{
+		VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_Generate, TEXT("%s%d InitialShapes"), *FormatTracePrefix(TraceTag), InitialShapePtrs.Num());
+		GenerateStatus = generate(InitialShapePtrs.GetData(), InitialShapePtrs.Num(), OcclusionHandlesPtr,
+			UnrealEncoderIds.data(), UnrealEncoderIds.size(), GenerateEncoderOptions.data(), GenerateOutputHandler.Get(),
+			PrtCache.get(), OcclusionSetPtr, GenerateOptions.get());
+	}
 
 	if (GenerateStatus != prt::STATUS_OK)
 	{
 		GenerateCallsCounter.Subtract(NumInitialShapes);
-		UnlockOcclusionLock(OcclusionLock);
 		
 		UE_LOG(LogUnrealPrt, Error, TEXT("PRT generate failed: %hs"), prt::getStatusDescription(GenerateStatus))
 		return {};
@@ -677,22 +1053,211 @@ FGenerateResultDescription VitruvioModule::BatchGenerate(TArray<FInitialShape> I
 	CHECK_PRT_INITIALIZED()
 
 	GenerateCallsCounter.Subtract(NumInitialShapes);
-	UnlockOcclusionLock(OcclusionLock);
 
 	NotifyGenerateCompleted();
-    
-    return FGenerateResultDescription { GenerateOutputHandler->GetGeneratedModel(), GenerateOutputHandler->GetInstances(),
-    	GenerateOutputHandler->GetInstanceMeshes(), GenerateOutputHandler->GetInstanceNames(), {}, EvaluatedAttributes };
+
+	FGenerateResultDescription Result { GenerateOutputHandler->GetGeneratedModel(), GenerateOutputHandler->GetInstances(),
+		GenerateOutputHandler->GetInstanceMeshes(), GenerateOutputHandler->GetInstanceNames(), {}, EvaluatedAttributes,
+		GenerateOutputHandler->GetClusterModels(), GenerateOutputHandler->GetClusterInstances() };
+	GenerateResultCache.Add(CacheKey, Result);
+
+	return Result;
 }
 
-FAttributeMapsResult VitruvioModule::BatchEvaluateRuleAttributesAsync(TArray<FInitialShape> InitialShapes) const
+FGenerateResultDescription VitruvioModule::BatchGenerateInstanced(TArray<FInitialShape> InitialShapes, EPrtCallPriority Priority, const FString& TraceTag) const
+{
+	struct FIdenticalShapes
+	{
+		FInitialShape CanonicalShape;
+		TArray<int32> ShapeIndices;
+		TArray<FTransform> Transforms;
+	};
+
+	// The generate key of the canonical shape covers the canonical polygon, rule package, random seed and user-set attributes
+	TMap<FGenerateResultCache::FKey, FIdenticalShapes> IdenticalShapesByKey;
+	TArray<FGenerateResultCache::FKey> ShapeKeys;
+	for (int32 ShapeIndex = 0; ShapeIndex < InitialShapes.Num(); ++ShapeIndex)
+	{
+		TArray<FInitialShape> CanonicalShapes;
+		const FTransform Transform = Vitruvio::CanonicalizeInitialShape(InitialShapes[ShapeIndex], CanonicalShapes.AddDefaulted_GetRef());
+		const FGenerateResultCache::FKey Key = FGenerateResultCache::ComputeKey(true, CanonicalShapes, false, {});
+
+		FIdenticalShapes& IdenticalShapes = IdenticalShapesByKey.FindOrAdd(Key);
+		if (IdenticalShapes.ShapeIndices.IsEmpty())
+		{
+			IdenticalShapes.CanonicalShape = MoveTemp(CanonicalShapes[0]);
+		}
+		IdenticalShapes.ShapeIndices.Add(ShapeIndex);
+		IdenticalShapes.Transforms.Add(Transform);
+		ShapeKeys.Add(Key);
+	}
+
+	const int32 NumInitialShapes = InitialShapes.Num();
+	TArray<FInitialShape> UniqueShapes;
+	TArray<int32> UniqueShapeIndices;
+	for (int32 ShapeIndex = 0; ShapeIndex < NumInitialShapes; ++ShapeIndex)
+	{
+		if (IdenticalShapesByKey[ShapeKeys[ShapeIndex]].ShapeIndices.Num() == 1)
+		{
+			UniqueShapes.Add(MoveTemp(InitialShapes[ShapeIndex]));
+			UniqueShapeIndices.Add(ShapeIndex);
+		}
+	}
+
+	FGenerateResultDescription Result = BatchGenerate(MoveTemp(UniqueShapes), false, {}, Priority, false, TraceTag);
+
+	// The evaluated attributes are reported in the order of the initial shapes
+	TArray<FAttributeMapPtr> EvaluatedAttributes;
+	EvaluatedAttributes.SetNum(NumInitialShapes);
+	bool bHasEvaluatedAttributes = Result.EvaluatedAttributes.Num() == UniqueShapeIndices.Num();
+	for (int32 UniqueIndex = 0; bHasEvaluatedAttributes && UniqueIndex < UniqueShapeIndices.Num(); ++UniqueIndex)
+	{
+		EvaluatedAttributes[UniqueShapeIndices[UniqueIndex]] = Result.EvaluatedAttributes[UniqueIndex];
+	}
+
+	// The canonical results are cached under the key of the canonical shape alone, so identical initial shapes of other tiles share the
+	// generated meshes no matter with which other shapes they were generated
+	TMap<FGenerateResultCache::FKey, FGenerateResultDescription> CanonicalResults;
+	TArray<FGenerateResultCache::FKey> MissingKeys;
+	for (const auto& [Key, IdenticalShapes] : IdenticalShapesByKey)
+	{
+		if (IdenticalShapes.ShapeIndices.Num() == 1)
+		{
+			continue;
+		}
+
+		if (const TSharedPtr<const FGenerateResultDescription> CachedResult = GenerateResultCache.Get(Key))
+		{
+			CanonicalResults.Add(Key, *CachedResult);
+		}
+		else
+		{
+			MissingKeys.Add(Key);
+		}
+	}
+
+	// All missing canonical shapes are generated in one call with an output cluster each. Encoders which can not split the initial shapes
+	// fall back to one call per canonical shape.
+	if (MissingKeys.Num() > 1 && UnrealEncoderOptionKeys.Contains(TEXT("splitInitialShapes")))
+	{
+		// Shapes are generated grouped by their rule package, sorting them the same way keeps the evaluated attributes in cluster order
+		TMap<URulePackage*, TArray<FGenerateResultCache::FKey>> MissingKeysByRulePackage;
+		for (const FGenerateResultCache::FKey Key : MissingKeys)
+		{
+			MissingKeysByRulePackage.FindOrAdd(IdenticalShapesByKey[Key].CanonicalShape.RulePackage).Add(Key);
+		}
+		MissingKeys.Reset();
+		for (const auto& [RulePackage, Keys] : MissingKeysByRulePackage)
+		{
+			MissingKeys.Append(Keys);
+		}
+
+		TArray<FInitialShape> CanonicalShapes;
+		for (int32 ClusterIndex = 0; ClusterIndex < MissingKeys.Num(); ++ClusterIndex)
+		{
+			FInitialShape& CanonicalShape = CanonicalShapes.Add_GetRef(IdenticalShapesByKey[MissingKeys[ClusterIndex]].CanonicalShape);
+			CanonicalShape.OutputCluster = ClusterIndex;
+		}
+
+		const FGenerateResultDescription ClusterResult = BatchGenerate(MoveTemp(CanonicalShapes), false, {}, Priority, false, TraceTag);
+		const bool bHasClusterAttributes = ClusterResult.EvaluatedAttributes.Num() == MissingKeys.Num();
+		for (int32 ClusterIndex = 0; ClusterIndex < MissingKeys.Num(); ++ClusterIndex)
+		{
+			FGenerateResultDescription CanonicalResult;
+			CanonicalResult.GeneratedModel = ClusterResult.ClusterModels.IsValidIndex(ClusterIndex) ? ClusterResult.ClusterModels[ClusterIndex] : nullptr;
+			if (ClusterResult.ClusterInstances.IsValidIndex(ClusterIndex))
+			{
+				CanonicalResult.Instances = ClusterResult.ClusterInstances[ClusterIndex];
+			}
+			for (const auto& [InstanceKey, InstanceTransforms] : CanonicalResult.Instances)
+			{
+				CanonicalResult.InstanceMeshes.Add(InstanceKey.MeshId, ClusterResult.InstanceMeshes.FindRef(InstanceKey.MeshId));
+				CanonicalResult.InstanceNames.Add(InstanceKey.MeshId, ClusterResult.InstanceNames.FindRef(InstanceKey.MeshId));
+			}
+			if (bHasClusterAttributes)
+			{
+				CanonicalResult.EvaluatedAttributes.Add(ClusterResult.EvaluatedAttributes[ClusterIndex]);
+			}
+
+			GenerateResultCache.Add(MissingKeys[ClusterIndex], CanonicalResult);
+			CanonicalResults.Add(MissingKeys[ClusterIndex], MoveTemp(CanonicalResult));
+		}
+	}
+	else
+	{
+		for (const FGenerateResultCache::FKey Key : MissingKeys)
+		{
+			CanonicalResults.Add(Key, BatchGenerate({IdenticalShapesByKey[Key].CanonicalShape}, false, {}, Priority, false, TraceTag));
+		}
+	}
+
+	for (const auto& [Key, CanonicalResult] : CanonicalResults)
+	{
+		const FIdenticalShapes& IdenticalShapes = IdenticalShapesByKey[Key];
+
+		if (CanonicalResult.GeneratedModel)
+		{
+			// Keyed on the materials of the generated model as well, they are applied as overrides to the shared mesh
+			const FString MeshId = FString::Printf(TEXT("IdenticalShape_%016llx"), Key);
+			Result.InstanceMeshes.Add(MeshId, CanonicalResult.GeneratedModel);
+			Result.InstanceNames.Add(MeshId, TEXT("GeneratedModel"));
+			Result.Instances.FindOrAdd({MeshId, CanonicalResult.GeneratedModel->GetMaterials()}).Append(IdenticalShapes.Transforms);
+		}
+
+		for (const auto& [InstanceKey, InstanceTransforms] : CanonicalResult.Instances)
+		{
+			TArray<FTransform>& Transforms = Result.Instances.FindOrAdd(InstanceKey);
+			Transforms.Reserve(Transforms.Num() + InstanceTransforms.Num() * IdenticalShapes.Transforms.Num());
+			for (const FTransform& ShapeTransform : IdenticalShapes.Transforms)
+			{
+				for (const FTransform& InstanceTransform : InstanceTransforms)
+				{
+					Transforms.Add(InstanceTransform * ShapeTransform);
+				}
+			}
+		}
+		Result.InstanceMeshes.Append(CanonicalResult.InstanceMeshes);
+		Result.InstanceNames.Append(CanonicalResult.InstanceNames);
+
+		bHasEvaluatedAttributes &= CanonicalResult.EvaluatedAttributes.Num() == 1;
+		for (const int32 ShapeIndex : IdenticalShapes.ShapeIndices)
+		{
+			EvaluatedAttributes[ShapeIndex] = bHasEvaluatedAttributes ? CanonicalResult.EvaluatedAttributes[0] : nullptr;
+		}
+	}
+
+	if (bHasEvaluatedAttributes)
+	{
+		Result.EvaluatedAttributes = MoveTemp(EvaluatedAttributes);
+	}
+	else
+	{
+		Result.EvaluatedAttributes.Empty();
+	}
+
+	return Result;
+}
+
+FAttributeMapsResult VitruvioModule::BatchEvaluateRuleAttributesAsync(TArray<FInitialShape> InitialShapes, FString TraceTag) const
 {
 	FAttributeMapsResult::FTokenPtr InvalidationToken = MakeShared<FEvalAttributesToken>();
 
 	CHECK_PRT_INITIALIZED_ASYNC(FAttributeMapsResult, InvalidationToken)
 
-	FAttributeMapsResult::FFutureType AttributeMapPtrFuture = Async(EAsyncExecution::Thread, [this, InvalidationToken, InitialShapes = MoveTemp(InitialShapes)]() mutable {
-		TArray<FAttributeMapPtr> Result = BatchEvaluateRuleAttributes(MoveTemp(InitialShapes));
+	PrtWorkerGovernor.BeginCall();
+
+	FAttributeMapsResult::FFutureType AttributeMapPtrFuture = EnqueuePrtJob(GetPrtJobPool(), EPrtCallPriority::Background, [this, InvalidationToken, InitialShapes = MoveTemp(InitialShapes), TraceTag = MoveTemp(TraceTag)]() mutable {
+		ON_SCOPE_EXIT
+		{
+			PrtWorkerGovernor.EndCall();
+		};
+
+		if (InvalidationToken->IsInvalid())
+		{
+			return FAttributeMapsResult::ResultType { InvalidationToken, {} };
+		}
+
+		TArray<FAttributeMapPtr> Result = BatchEvaluateRuleAttributes(MoveTemp(InitialShapes), TraceTag);
 		return FAttributeMapsResult::ResultType { InvalidationToken, MoveTemp(Result) };
 	});
 
@@ -705,7 +1270,19 @@ FGenerateResult VitruvioModule::GenerateAsync(TArray<FInitialShape> InitialShape
 
 	CHECK_PRT_INITIALIZED_ASYNC(FGenerateResult, Token)
 
-	FGenerateResult::FFutureType ResultFuture = Async(EAsyncExecution::Thread, [this, Token, InitialShapes = MoveTemp(InitialShapes)]() mutable {
+	PrtWorkerGovernor.BeginCall();
+
+	FGenerateResult::FFutureType ResultFuture = EnqueuePrtJob(GetPrtJobPool(), EPrtCallPriority::Interactive, [this, Token, InitialShapes = MoveTemp(InitialShapes)]() mutable {
+		ON_SCOPE_EXIT
+		{
+			PrtWorkerGovernor.EndCall();
+		};
+
+		if (Token->IsInvalid())
+		{
+			return FGenerateResult::ResultType{Token, {}};
+		}
+
 		FGenerateResultDescription Result = Generate(MoveTemp(InitialShapes));
 		return FGenerateResult::ResultType{Token, MoveTemp(Result)};
 	});
@@ -722,23 +1299,34 @@ FGenerateResultDescription VitruvioModule::Generate(TArray<FInitialShape> Initia
 		return {};
 	}
 
+	const FGenerateResultCache::FKey CacheKey = FGenerateResultCache::ComputeKey(false, InitialShapes, InitialShapes.Num() > 1, {});
 	GenerateCallsCounter.Increment();
 
+	if (const TSharedPtr<const FGenerateResultDescription> CachedResult = GenerateResultCache.Get(CacheKey))
+	{
+		GenerateCallsCounter.Decrement();
+		NotifyGenerateCompleted();
+		return *CachedResult;
+	}
+
 	const FInitialShape& FirstInitialShape = InitialShapes[0];
 	const ResolveMapSPtr ResolveMap = LoadResolveMapAsync(FirstInitialShape.RulePackage).Get();
+	const FRuleInfoPtr RuleInfo = GetRuleInfo(FirstInitialShape.RulePackage, ResolveMap);
+	if (!RuleInfo)
+	{
+		GenerateCallsCounter.Decrement();
+		return {};
+	}
 
-	const std::wstring RuleFile = ResolveMap->findCGBKey();
-	const wchar_t* RuleFileUri = ResolveMap->getString(RuleFile.c_str());
-
-	const RuleFileInfoPtr StartRuleInfo = prt_make_shared<const prt::RuleFileInfo>(prt::createRuleFileInfo(RuleFileUri));
-	const std::wstring StartRule = prtu::detectStartRule(StartRuleInfo);
+	const std::wstring& RuleFile = RuleInfo->RuleFile;
+	const std::wstring& StartRule = RuleInfo->StartRule;
 
 	TArray<AttributeMapBuilderUPtr> AttributeMapBuilders;
 	AttributeMapBuilders.Add(AttributeMapBuilderUPtr(prt::AttributeMapBuilder::create()));
 	const TSharedPtr<UnrealCallbacks> OutputHandler(new UnrealCallbacks(AttributeMapBuilders, FirstInitialShape.Position));
 
 	const std::vector<const wchar_t*> EncoderIds = {UNREAL_GEOMETRY_ENCODER_ID};
-	const AttributeMapUPtr UnrealEncoderOptions(prtu::createValidatedOptions(UNREAL_GEOMETRY_ENCODER_ID));
+	const AttributeMapUPtr UnrealEncoderOptions(CreateUnrealEncoderOptions(*OutputHandler, UnrealEncoderOptionKeys));
 	const AttributeMapNOPtrVector EncoderOptions = {UnrealEncoderOptions.get()};
 	
 	AttributeMapVector AttributeMaps;
@@ -761,69 +1349,71 @@ FGenerateResultDescription VitruvioModule::Generate(TArray<FInitialShape> Initia
 
 	bool bInterOcclusion = InitialShapes.Num() > 1;
 	TArray<prt::OcclusionSet::Handle> OcclusionHandles;
+	TOptional<FOcclusionCache::FScopedSnapshot> OcclusionSnapshot;
 	
 	if (bInterOcclusion)
 	{
-		OcclusionLock.Lock();
-	
-		TMap<const prt::InitialShape*, int64> OcclusionInitialShapeIndexMap;
-		for (int ShapeIndex = 0; ShapeIndex < InitialShapes.Num(); ++ShapeIndex)
-		{
-			const FInitialShape& InitialShape = InitialShapes[ShapeIndex];
-
-			if (!OcclusionHandleCache.Contains(InitialShape.InitialShapeIndex))
-			{
-				OcclusionInitialShapeIndexMap.Add(Shapes[ShapeIndex], InitialShape.InitialShapeIndex);
-			}
-		}
+		OcclusionSnapshot.Emplace(OcclusionCache, GetInitialShapeIndices(InitialShapes));
 
-		if (!OcclusionInitialShapeIndexMap.IsEmpty())
+		const TArray<int64>& MissingInitialShapeIndices = OcclusionSnapshot->GetMissingInitialShapeIndices();
+		if (!MissingInitialShapeIndices.IsEmpty())
 		{
 			TArray<prt::OcclusionSet::Handle> NewOcclusionHandles;
-			NewOcclusionHandles.SetNum(OcclusionInitialShapeIndexMap.Num());
+			NewOcclusionHandles.SetNum(MissingInitialShapeIndices.Num());
 
 			TArray<const prt::InitialShape*> OcclusionShapesArray;
-			OcclusionInitialShapeIndexMap.GenerateKeyArray(OcclusionShapesArray);
+			for (const int64 InitialShapeIndex : MissingInitialShapeIndices)
+			{
+				const int32 ShapeIndex = InitialShapes.IndexOfByPredicate([InitialShapeIndex](const FInitialShape& InitialShape)
+				{
+					return InitialShape.InitialShapeIndex == InitialShapeIndex;
+				});
+				OcclusionShapesArray.Add(Shapes[ShapeIndex]);
+			}
+
+			const FPrtWorkerGovernor::FScopedWorkers OccluderWorkers(PrtWorkerGovernor, OcclusionShapesArray.Num(), EPrtCallPriority::Interactive);
+			AttributeMapBuilderUPtr OccluderOptionsBuilder(prt::AttributeMapBuilder::create());
+			OccluderOptionsBuilder->setInt(L"numberWorkerThreads", OccluderWorkers.GetNumWorkers());
+			const AttributeMapUPtr OccluderOptions(OccluderOptionsBuilder->createAttributeMapAndReset());
 	
-			const prt::Status GenerateOccludersStatus =  generateOccluders(OcclusionShapesArray.GetData(), OcclusionShapesArray.Num(), NewOcclusionHandles.GetData(), nullptr, 0,
-	nullptr, OutputHandler.Get(), PrtCache.get(), OcclusionSet.get());
+			prt::Status GenerateOccludersStatus;
+			{
+				VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_GenerateOccluders, TEXT("%d InitialShapes"), OcclusionShapesArray.Num());
+				GenerateOccludersStatus = generateOccluders(OcclusionShapesArray.GetData(), OcclusionShapesArray.Num(), NewOcclusionHandles.GetData(), nullptr, 0,
+	nullptr, OutputHandler.Get(), PrtCache.get(), OcclusionSnapshot->GetOcclusionSet(), OccluderOptions.get());
+			}
 
 			if (GenerateOccludersStatus != prt::STATUS_OK)
 			{
 				GenerateCallsCounter.Decrement();
 
-				OcclusionLock.Unlock();
 				UE_LOG(LogUnrealPrt, Error, TEXT("PRT generateOccluders failed: %hs"), prt::getStatusDescription(GenerateOccludersStatus))
 				return {};
 			}
 
-			for (int32 OcclusionShapeIndex = 0; OcclusionShapeIndex < OcclusionShapesArray.Num(); ++OcclusionShapeIndex)
-			{
-				const prt::InitialShape* InitialShape = OcclusionShapesArray[OcclusionShapeIndex];
-				prt::OcclusionSet::Handle OcclusionHandle = NewOcclusionHandles[OcclusionShapeIndex];
-				int64 OcclusionInitialShapeIndex = OcclusionInitialShapeIndexMap[InitialShape];
-
-				OcclusionHandleCache.Add(OcclusionInitialShapeIndex, OcclusionHandle);
-			}
+			OcclusionSnapshot->AddOccluders(MissingInitialShapeIndices, NewOcclusionHandles);
 		}
 
 		for (const FInitialShape& InitialShape : InitialShapes)
 		{
-			if (OcclusionHandleCache.Contains(InitialShape.InitialShapeIndex))
-			{
-				OcclusionHandles.Add(OcclusionHandleCache[InitialShape.InitialShapeIndex]);
-			}
+			OcclusionHandles.Add(OcclusionSnapshot->GetHandle(InitialShape.InitialShapeIndex));
 		}
 	}
 
-	const prt::Status GenerateStatus = generate(Shapes.data(), 1, bInterOcclusion ? OcclusionHandles.GetData() : nullptr, EncoderIds.data(), EncoderIds.size(),
-													 EncoderOptions.data(), OutputHandler.Get(), PrtCache.get(), bInterOcclusion ? OcclusionSet.get() : nullptr);
-
-	if (bInterOcclusion)
+	prt::Status GenerateStatus;
 	{
-		OcclusionLock.Unlock();
+		VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_Generate, TEXT("InitialShape %lld"), FirstInitialShape.InitialShapeIndex);
+
+		const FPrtWorkerGovernor::FScopedWorkers Workers(PrtWorkerGovernor, 1, EPrtCallPriority::Interactive);
+		AttributeMapBuilderUPtr GenerateOptionsBuilder(prt::AttributeMapBuilder::create());
+		GenerateOptionsBuilder->setInt(L"numberWorkerThreads", Workers.GetNumWorkers());
+		const AttributeMapUPtr GenerateOptions(GenerateOptionsBuilder->createAttributeMapAndReset());
+
+		GenerateStatus = generate(Shapes.data(), 1, bInterOcclusion ? OcclusionHandles.GetData() : nullptr, EncoderIds.data(), EncoderIds.size(),
+								  EncoderOptions.data(), OutputHandler.Get(), PrtCache.get(), bInterOcclusion ? OcclusionSnapshot->GetOcclusionSet() : nullptr,
+								  GenerateOptions.get());
 	}
-	
+
 	GenerateCallsCounter.Decrement();
 	if (GenerateStatus != prt::STATUS_OK)
 	{
@@ -835,8 +1425,11 @@ FGenerateResultDescription VitruvioModule::Generate(TArray<FInitialShape> Initia
 	
 	NotifyGenerateCompleted();
 
-	return FGenerateResultDescription{ OutputHandler->GetGeneratedModel(), OutputHandler->GetInstances(), OutputHandler->GetInstanceMeshes(),
+	FGenerateResultDescription Result{ OutputHandler->GetGeneratedModel(), OutputHandler->GetInstances(), OutputHandler->GetInstanceMeshes(),
 									  OutputHandler->GetInstanceNames(), OutputHandler->GetReports() };
+	GenerateResultCache.Add(CacheKey, Result);
+
+	return Result;
 }
 
 FAttributeMapResult VitruvioModule::EvaluateRuleAttributesAsync(FInitialShape InitialShape) const
@@ -846,29 +1439,32 @@ FAttributeMapResult VitruvioModule::EvaluateRuleAttributesAsync(FInitialShape In
 	CHECK_PRT_INITIALIZED_ASYNC(FAttributeMapResult, InvalidationToken)
 
 	LoadAttributesCounter.Increment();
+	PrtWorkerGovernor.BeginCall();
 
-	FAttributeMapResult::FFutureType AttributeMapPtrFuture = Async(EAsyncExecution::Thread, [this, InvalidationToken, InitialShape = MoveTemp(InitialShape)]() mutable {
-		const ResolveMapSPtr ResolveMap = LoadResolveMapAsync(InitialShape.RulePackage).Get();
-
-		const std::wstring RuleFile = ResolveMap->findCGBKey();
-		const wchar_t* RuleFileUri = ResolveMap->getString(RuleFile.c_str());
-
-		const RuleFileInfoPtr StartRuleInfo = prt_make_shared<const prt::RuleFileInfo>(prt::createRuleFileInfo(RuleFileUri));
-		const std::wstring StartRule = prtu::detectStartRule(StartRuleInfo);
+	FAttributeMapResult::FFutureType AttributeMapPtrFuture = EnqueuePrtJob(GetPrtJobPool(), EPrtCallPriority::Interactive, [this, InvalidationToken, InitialShape = MoveTemp(InitialShape)]() mutable {
+		ON_SCOPE_EXIT
+		{
+			PrtWorkerGovernor.EndCall();
+		};
 
-		prt::Status InfoStatus;
-		RuleFileInfoUPtr RuleInfo(prt::createRuleFileInfo(RuleFileUri, PrtCache.get(), &InfoStatus));
-		if (!RuleInfo || InfoStatus != prt::STATUS_OK)
+		const ResolveMapSPtr ResolveMap = LoadResolveMapAsync(InitialShape.RulePackage).Get();
+		const FRuleInfoPtr RuleInfo = GetRuleInfo(InitialShape.RulePackage, ResolveMap);
+		if (!RuleInfo)
 		{
-			UE_LOG(LogUnrealPrt, Error, TEXT("could not get rule file info from rule file %s"), RuleFileUri)
+			LoadAttributesCounter.Decrement();
 			return FAttributeMapResult::ResultType{
 				InvalidationToken,
 				nullptr,
 			};
 		}
 
-		AttributeMapUPtr DefaultAttributeMap(EvaluateRuleAttributes(RuleFile.c_str(),
-			StartRule.c_str(), ResolveMap, InitialShape, PrtCache.get()));
+		const FPrtWorkerGovernor::FScopedWorkers Workers(PrtWorkerGovernor, 1, EPrtCallPriority::Interactive);
+		AttributeMapBuilderUPtr GenerateOptionsBuilder(prt::AttributeMapBuilder::create());
+		GenerateOptionsBuilder->setInt(L"numberWorkerThreads", Workers.GetNumWorkers());
+		const AttributeMapUPtr GenerateOptions(GenerateOptionsBuilder->createAttributeMapAndReset());
+
+		AttributeMapUPtr DefaultAttributeMap(EvaluateRuleAttributes(RuleInfo->RuleFile,
+			RuleInfo->StartRule, ResolveMap, InitialShape, PrtCache.get(), GenerateOptions.get()));
 
 		LoadAttributesCounter.Decrement();
 
@@ -877,14 +1473,14 @@ FAttributeMapResult VitruvioModule::EvaluateRuleAttributesAsync(FInitialShape In
 			return FAttributeMapResult::ResultType{InvalidationToken, nullptr};
 		}
 
-		const TSharedPtr<FAttributeMap> AttributeMap = MakeShared<FAttributeMap>(std::move(DefaultAttributeMap), std::move(RuleInfo));
+		const TSharedPtr<FAttributeMap> AttributeMap = MakeShared<FAttributeMap>(std::move(DefaultAttributeMap), RuleInfo);
 		return FAttributeMapResult::ResultType{InvalidationToken, AttributeMap};
 	});
 
 	return {MoveTemp(AttributeMapPtrFuture), InvalidationToken};
 }
 
-TArray<FAttributeMapPtr> VitruvioModule::BatchEvaluateRuleAttributes(TArray<FInitialShape> InitialShapes) const
+TArray<FAttributeMapPtr> VitruvioModule::BatchEvaluateRuleAttributes(TArray<FInitialShape> InitialShapes, const FString& TraceTag) const
 {
 	CHECK_PRT_INITIALIZED()
 	
@@ -896,36 +1492,32 @@ TArray<FAttributeMapPtr> VitruvioModule::BatchEvaluateRuleAttributes(TArray<FIni
 		RulePackages.FindOrAdd(InitialShape.RulePackage).Add(MoveTemp(InitialShape));
 	}
 
-	TArray<TTuple<TFuture<ResolveMapSPtr>, TArray<FInitialShape>>> ResolveMapFutures;
+	TArray<TTuple<URulePackage*, TFuture<ResolveMapSPtr>, TArray<FInitialShape>>> ResolveMapFutures;
 	for (auto& [RulePackage, InitialShapesByRpk] : RulePackages)
 	{
-		ResolveMapFutures.Add(MakeTuple(LoadResolveMapAsync(RulePackage), MoveTemp(InitialShapesByRpk)));
+		ResolveMapFutures.Add(MakeTuple(RulePackage, LoadResolveMapAsync(RulePackage), MoveTemp(InitialShapesByRpk)));
 	}
 
-	TArray<TTuple<FStartRuleInfo, TArray<FInitialShape>>> RuleInfoInitialShapes;
-	for (auto& [ResolveMapFuture, InitialShapesByRpk] : ResolveMapFutures)
+	TArray<TTuple<FRuleInfoPtr, TArray<FInitialShape>>> RuleInfoInitialShapes;
+	for (auto& [RulePackage, ResolveMapFuture, InitialShapesByRpk] : ResolveMapFutures)
 	{
-		const ResolveMapSPtr ResolveMap = ResolveMapFuture.Get();
-
-		const std::wstring RuleFile = ResolveMap->findCGBKey();
-		const wchar_t* RuleFileUri = ResolveMap->getString(RuleFile.c_str());
-
-		const RuleFileInfoPtr RuleFileInfo = prt_make_shared<const prt::RuleFileInfo>(prt::createRuleFileInfo(RuleFileUri));
-		const std::wstring StartRule = prtu::detectStartRule(RuleFileInfo);
-		
-		FStartRuleInfo StartRuleInfo { ResolveMap, RuleFile.c_str(), StartRule.c_str(), RuleFileInfo };
+		const FRuleInfoPtr RuleInfo = GetRuleInfo(RulePackage, ResolveMapFuture.Get());
+		if (!RuleInfo)
+		{
+			continue;
+		}
 
-		RuleInfoInitialShapes.Add(MakeTuple(StartRuleInfo, MoveTemp(InitialShapesByRpk)));
+		RuleInfoInitialShapes.Add(MakeTuple(RuleInfo, MoveTemp(InitialShapesByRpk)));
 	}
 	
 	auto ForeachInitialShape = [&](auto Fun)
 	{
 		int InitialShapeIndex = 0;
-		for (auto& [StartRuleInfo, InitialShapesByRpk] : RuleInfoInitialShapes)
+		for (auto& [RuleInfo, InitialShapesByRpk] : RuleInfoInitialShapes)
 		{
 			for (const FInitialShape& InitialShape : InitialShapesByRpk)
 			{
-				Fun(InitialShapeIndex, InitialShape, StartRuleInfo);
+				Fun(InitialShapeIndex, InitialShape, RuleInfo);
 
 				InitialShapeIndex++;
 			}
@@ -937,14 +1529,14 @@ TArray<FAttributeMapPtr> VitruvioModule::BatchEvaluateRuleAttributes(TArray<FIni
 	InitialShapeNOPtrVector InitialShapePtrs;
 	AttributeMapVector AttributeMaps;
 	
-	ForeachInitialShape([&](int32 InitialShapeIndex, const FInitialShape& InitialShape, const FStartRuleInfo& StartRuleInfo)
+	ForeachInitialShape([&](int32 InitialShapeIndex, const FInitialShape& InitialShape, const FRuleInfoPtr& RuleInfo)
 	{
 		InitialShapeBuilderUPtr InitialShapeBuilder(prt::InitialShapeBuilder::create());
 		SetInitialShapeGeometry(InitialShapeBuilder, InitialShape);
 
 		AttributeMapUPtr Attributes = Vitruvio::CreateAttributeMap(InitialShape.Attributes);
-		InitialShapeBuilder->setAttributes(*StartRuleInfo.RuleFile, *StartRuleInfo.StartRule, InitialShape.RandomSeed, L"",
-			Attributes.get(), StartRuleInfo.ResolveMap.get());
+		InitialShapeBuilder->setAttributes(RuleInfo->RuleFile.c_str(), RuleInfo->StartRule.c_str(), InitialShape.RandomSeed, L"",
+			Attributes.get(), RuleInfo->ResolveMap.get());
 		InitialShapeUPtr Shape(InitialShapeBuilder->createInitialShape());
 		InitialShapePtrs.push_back(Shape.get());
 		InitialShapeUPtrs.push_back(std::move(Shape));
@@ -967,13 +1559,18 @@ TArray<FAttributeMapPtr> VitruvioModule::BatchEvaluateRuleAttributes(TArray<FIni
 		const AttributeMapUPtr AttributeEncodeOptions = prtu::createValidatedOptions(ATTRIBUTE_EVAL_ENCODER_ID);
 		const AttributeMapNOPtrVector EncoderOptions = {AttributeEncodeOptions.get()};
 
+		const FPrtWorkerGovernor::FScopedWorkers Workers(PrtWorkerGovernor, static_cast<int32>(InitialShapePtrs.size()));
 		AttributeMapBuilderUPtr GenerateOptionsBuilder(prt::AttributeMapBuilder::create());
-		GenerateOptionsBuilder->setInt(L"numberWorkerThreads", FPlatformMisc::NumberOfCores());
+		GenerateOptionsBuilder->setInt(L"numberWorkerThreads", Workers.GetNumWorkers());
 		const AttributeMapUPtr GenerateOptions(GenerateOptionsBuilder->createAttributeMapAndReset());
 
-		prt::Status GenerateStatus = generate(InitialShapePtrs.data(), InitialShapePtrs.size(), nullptr, EncoderIds.data(),
-			EncoderIds.size(), EncoderOptions.data(), OutputHandler.Get(),
-					  PrtCache.get(), nullptr, GenerateOptions.get());
+		prt::Status GenerateStatus;
+		{
+			VITRUVIO_SCOPE_TAGGED(STAT_Vitruvio_EvaluateAttributes, TEXT("%s%d InitialShapes"), *FormatTracePrefix(TraceTag), static_cast<int32>(InitialShapePtrs.size()));
+			GenerateStatus = generate(InitialShapePtrs.data(), InitialShapePtrs.size(), nullptr, EncoderIds.data(),
+				EncoderIds.size(), EncoderOptions.data(), OutputHandler.Get(),
+						  PrtCache.get(), nullptr, GenerateOptions.get());
+		}
 
 		if (GenerateStatus != prt::STATUS_OK)
 		{
@@ -982,11 +1579,11 @@ TArray<FAttributeMapPtr> VitruvioModule::BatchEvaluateRuleAttributes(TArray<FIni
 			return {};
 		}
 		
-		ForeachInitialShape([&](int32 InitialShapeIndex, const FInitialShape& InitialShape, const FStartRuleInfo& StartRuleInfo)
+		ForeachInitialShape([&](int32 InitialShapeIndex, const FInitialShape& InitialShape, const FRuleInfoPtr& RuleInfo)
 		{
 			const FAttributeMapPtr AttributeMap = MakeShared<FAttributeMap>(
 				AttributeMapUPtr(EvaluateAttributeMapBuilders[InitialShapeIndex]->createAttributeMapAndReset()),
-				StartRuleInfo.RuleFileInfo);
+				RuleInfo);
 			EvaluatedAttributes.Add(AttributeMap);
 		});
 	}
@@ -1001,59 +1598,49 @@ void VitruvioModule::EvictFromResolveMapCache(URulePackage* RulePackage)
 {
 	const TLazyObjectPtr<URulePackage> LazyRulePackagePtr(RulePackage);
 	FScopeLock Lock(&LoadResolveMapLock);
-	ResolveMapCache.Remove(LazyRulePackagePtr);
+	ResolveMapSPtr ResolveMap;
+	if (ResolveMapCache.RemoveAndCopyValue(LazyRulePackagePtr, ResolveMap))
+	{
+		for (auto It = ContentResolveMapCache.CreateIterator(); It; ++It)
+		{
+			if (It.Value() == ResolveMap)
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+	RuleInfoCache.Remove(LazyRulePackagePtr);
 	PrtCache->flushAll();
+	GenerateResultCache.Empty();
 }
 
-void VitruvioModule::RegisterMesh(UStaticMesh* StaticMesh)
+void VitruvioModule::RegisterMesh(UStaticMesh* StaticMesh, UCustomCollisionDataProvider* CollisionDataProvider)
 {
 	FScopeLock Lock(&RegisterMeshLock);
 	RegisteredMeshes.Add(StaticMesh);
+	RegisteredCollisionDataProviders.Add(CollisionDataProvider);
 }
 
-void VitruvioModule::UnregisterMesh(UStaticMesh* StaticMesh)
+void VitruvioModule::UnregisterMesh(UStaticMesh* StaticMesh, UCustomCollisionDataProvider* CollisionDataProvider)
 {
 	FScopeLock Lock(&RegisterMeshLock);
 	RegisteredMeshes.Remove(StaticMesh);
+	RegisteredCollisionDataProviders.Remove(CollisionDataProvider);
 }
 
 void VitruvioModule::InvalidateOcclusionHandle(int64 InitialShapeIndex)
 {
-	FScopeLock Lock(&OcclusionLock);
-
-	if (OcclusionHandleCache.Contains(InitialShapeIndex))
-	{
-		TArray InvalidateHandles = { OcclusionHandleCache[InitialShapeIndex] };
-		OcclusionSet->dispose(InvalidateHandles.GetData(), InvalidateHandles.Num());
-		OcclusionHandleCache.Remove(InitialShapeIndex);
-	}
+	OcclusionCache.Invalidate({InitialShapeIndex});
 }
 
 void VitruvioModule::InvalidateOcclusionHandles(const TArray<int64>& InitialShapeIndices) const
 {
-	FScopeLock Lock(&OcclusionLock);
-
-	TArray<prt::OcclusionSet::Handle> InvalidateHandles;
-	for (int32 Index = 0; Index < InitialShapeIndices.Num(); ++Index)
-	{
-		int64 InitialShapeIndex = InitialShapeIndices[Index];
-		if (OcclusionHandleCache.Contains(InitialShapeIndex))
-		{
-			InvalidateHandles.Add(OcclusionHandleCache[InitialShapeIndex]);
-		}
-
-		OcclusionHandleCache.Remove(InitialShapeIndex);
-	}
-
-	OcclusionSet->dispose(InvalidateHandles.GetData(), InvalidateHandles.Num());
+	OcclusionCache.Invalidate(InitialShapeIndices);
 }
 
 void VitruvioModule::InvalidateAllOcclusionHandles()
 {
-	FScopeLock Lock(&OcclusionLock);
-
-	OcclusionHandleCache.Empty();
-	OcclusionSet.reset(prt::OcclusionSet::create());
+	OcclusionCache.Reset();
 }
 
 void VitruvioModule::NotifyGenerateCompleted() const
@@ -1092,6 +1679,38 @@ void VitruvioModule::NotifyGenerateCompleted() const
 	});
 }
 
+FRuleInfoPtr VitruvioModule::GetRuleInfo(URulePackage* RulePackage, const ResolveMapSPtr& ResolveMap) const
+{
+	if (!ResolveMap)
+	{
+		return {};
+	}
+
+	const TLazyObjectPtr<URulePackage> LazyRulePackagePtr(RulePackage);
+	{
+		FScopeLock Lock(&LoadResolveMapLock);
+		const FRuleInfoPtr* CachedRuleInfo = RuleInfoCache.Find(LazyRulePackagePtr);
+		if (CachedRuleInfo && (*CachedRuleInfo)->ResolveMap == ResolveMap)
+		{
+			return *CachedRuleInfo;
+		}
+	}
+
+	// Parse outside of the lock, concurrent misses for the same rule package at most parse it twice
+	FRuleInfoPtr RuleInfo = CreateRuleInfo(ResolveMap, PrtCache.get());
+	if (RuleInfo)
+	{
+		FScopeLock Lock(&LoadResolveMapLock);
+		const ResolveMapSPtr* CachedResolveMap = ResolveMapCache.Find(LazyRulePackagePtr);
+		if (CachedResolveMap && *CachedResolveMap == ResolveMap)
+		{
+			RuleInfoCache.Add(LazyRulePackagePtr, RuleInfo);
+		}
+	}
+
+	return RuleInfo;
+}
+
 TFuture<ResolveMapSPtr> VitruvioModule::LoadResolveMapAsync(URulePackage* const RulePackage) const
 {
 	TPromise<ResolveMapSPtr> Promise;
@@ -1144,7 +1763,7 @@ TFuture<ResolveMapSPtr> VitruvioModule::LoadResolveMapAsync(URulePackage* const
 			FScopeLock Lock(&LoadResolveMapLock);
 			// Task which does the actual resolve map loading which might take a long time
 			LoadTask = TGraphTask<FLoadResolveMapTask>::CreateTask().ConstructAndDispatchWhenReady(MoveTemp(Promise), RpkFolder, LazyRulePackagePtr,
-																								   ResolveMapCache, LoadResolveMapLock);
+																								   ResolveMapCache, ContentResolveMapCache, LoadResolveMapLock);
 			ResolveMapEventGraphRefCache.Add(LazyRulePackagePtr, LoadTask);
 		}
 
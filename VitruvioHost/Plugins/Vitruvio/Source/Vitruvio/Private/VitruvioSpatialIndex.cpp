@@ -0,0 +1,109 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "VitruvioSpatialIndex.h"
+
+namespace
+{
+
+// Matches the default inter-occlusion neighbor query distance (in cm), so that a default query visits at most 3x3 cells
+constexpr double CellSize = 10000.0;
+
+} // namespace
+
+FIntPoint FVitruvioSpatialIndex::GetCell(const FVector& Position)
+{
+	return FIntPoint(FMath::FloorToInt32(Position.X / CellSize), FMath::FloorToInt32(Position.Y / CellSize));
+}
+
+void FVitruvioSpatialIndex::Update(UVitruvioComponent* VitruvioComponent, const FVector& Position)
+{
+	const FIntPoint NewCell = GetCell(Position);
+
+	if (FVector* OldPosition = Positions.Find(VitruvioComponent))
+	{
+		const FIntPoint OldCell = GetCell(*OldPosition);
+		*OldPosition = Position;
+
+		if (OldCell == NewCell)
+		{
+			TArray<FEntry>& Entries = Cells.FindChecked(NewCell);
+			Entries.FindByPredicate([VitruvioComponent](const FEntry& Entry) { return Entry.Key == VitruvioComponent; })->Position = Position;
+			return;
+		}
+
+		RemoveFromCell(OldCell, VitruvioComponent);
+	}
+	else
+	{
+		Positions.Add(VitruvioComponent, Position);
+	}
+
+	Cells.FindOrAdd(NewCell).Add({VitruvioComponent, VitruvioComponent, Position});
+}
+
+void FVitruvioSpatialIndex::Remove(UVitruvioComponent* VitruvioComponent)
+{
+	FVector Position;
+	if (Positions.RemoveAndCopyValue(VitruvioComponent, Position))
+	{
+		RemoveFromCell(GetCell(Position), VitruvioComponent);
+	}
+}
+
+void FVitruvioSpatialIndex::Empty()
+{
+	Cells.Empty();
+	Positions.Empty();
+}
+
+void FVitruvioSpatialIndex::QueryRadius(const FVector& Center, double Radius, TArray<UVitruvioComponent*>& OutVitruvioComponents) const
+{
+	const FIntPoint MinCell = GetCell(Center - FVector(Radius, Radius, 0));
+	const FIntPoint MaxCell = GetCell(Center + FVector(Radius, Radius, 0));
+	const double RadiusSquared = Radius * Radius;
+
+	for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+	{
+		for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+		{
+			const TArray<FEntry>* Entries = Cells.Find(FIntPoint(X, Y));
+			if (!Entries)
+			{
+				continue;
+			}
+
+			for (const FEntry& Entry : *Entries)
+			{
+				if (FVector::DistSquared(Center, Entry.Position) < RadiusSquared && Entry.VitruvioComponent.IsValid())
+				{
+					OutVitruvioComponents.Add(Entry.VitruvioComponent.Get());
+				}
+			}
+		}
+	}
+}
+
+void FVitruvioSpatialIndex::RemoveFromCell(const FIntPoint& Cell, const UVitruvioComponent* VitruvioComponent)
+{
+	if (TArray<FEntry>* Entries = Cells.Find(Cell))
+	{
+		Entries->RemoveAllSwap([VitruvioComponent](const FEntry& Entry) { return Entry.Key == VitruvioComponent; });
+		if (Entries->IsEmpty())
+		{
+			Cells.Remove(Cell);
+		}
+	}
+}
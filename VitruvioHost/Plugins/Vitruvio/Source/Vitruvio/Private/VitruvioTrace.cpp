@@ -0,0 +1,35 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "VitruvioTrace.h"
+
+UE_TRACE_CHANNEL_DEFINE(VitruvioChannel)
+
+DEFINE_STAT(STAT_Vitruvio_LoadResolveMap);
+DEFINE_STAT(STAT_Vitruvio_RuleFileInfo);
+DEFINE_STAT(STAT_Vitruvio_BuildInitialShapes);
+DEFINE_STAT(STAT_Vitruvio_EvaluateAttributes);
+DEFINE_STAT(STAT_Vitruvio_GenerateOccluders);
+DEFINE_STAT(STAT_Vitruvio_Generate);
+DEFINE_STAT(STAT_Vitruvio_ConvertMesh);
+DEFINE_STAT(STAT_Vitruvio_ComputeTangents);
+DEFINE_STAT(STAT_Vitruvio_BuildMesh);
+DEFINE_STAT(STAT_Vitruvio_PrepareMeshData);
+DEFINE_STAT(STAT_Vitruvio_FinishMeshBuild);
+DEFINE_STAT(STAT_Vitruvio_CreateMaterials);
+DEFINE_STAT(STAT_Vitruvio_DecodeTexture);
+DEFINE_STAT(STAT_Vitruvio_RegisterInstances);
+DEFINE_STAT(STAT_Vitruvio_RegisterClusters);
+DEFINE_STAT(STAT_Vitruvio_UpdateAttributes);
@@ -0,0 +1,60 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+
+// Insights channel for all Vitruvio generate phases, enable with -trace=cpu,Vitruvio
+UE_TRACE_CHANNEL_EXTERN(VitruvioChannel)
+
+DECLARE_STATS_GROUP(TEXT("Vitruvio"), STATGROUP_Vitruvio, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Load Resolve Map"), STAT_Vitruvio_LoadResolveMap, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Create Rule File Info"), STAT_Vitruvio_RuleFileInfo, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Initial Shapes"), STAT_Vitruvio_BuildInitialShapes, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PRT Evaluate Attributes"), STAT_Vitruvio_EvaluateAttributes, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PRT Generate Occluders"), STAT_Vitruvio_GenerateOccluders, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PRT Generate"), STAT_Vitruvio_Generate, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Convert Mesh"), STAT_Vitruvio_ConvertMesh, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Compute Tangents"), STAT_Vitruvio_ComputeTangents, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Mesh"), STAT_Vitruvio_BuildMesh, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Prepare Mesh Render Data"), STAT_Vitruvio_PrepareMeshData, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Finish Mesh Build"), STAT_Vitruvio_FinishMeshBuild, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Create Materials"), STAT_Vitruvio_CreateMaterials, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode Texture"), STAT_Vitruvio_DecodeTexture, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Register Instance Components"), STAT_Vitruvio_RegisterInstances, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Register Cluster Components"), STAT_Vitruvio_RegisterClusters, STATGROUP_Vitruvio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Attributes"), STAT_Vitruvio_UpdateAttributes, STATGROUP_Vitruvio, );
+
+/**
+ * \brief Counts the enclosing scope in the given Vitruvio cycle stat and emits a span of the same name on the Vitruvio trace channel.
+ */
+#define VITRUVIO_SCOPE(Stat)                                                                                                                         \
+	SCOPE_CYCLE_COUNTER(Stat);                                                                                                                       \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Stat, VitruvioChannel)
+
+/**
+ * \brief Like VITRUVIO_SCOPE, but tags the trace span with a formatted suffix (eg. tile coordinates or the initial shape index). The suffix is
+ * only formatted while the Vitruvio trace channel is enabled.
+ */
+#define VITRUVIO_SCOPE_TAGGED(Stat, Format, ...)                                                                                                     \
+	SCOPE_CYCLE_COUNTER(Stat);                                                                                                                       \
+	TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL(UE_TRACE_CHANNELEXPR_IS_ENABLED(VitruvioChannel)                                                 \
+													  ? *(FString(TEXT(#Stat " ")) + FString::Printf(Format, ##__VA_ARGS__))                      \
+													  : TEXT(#Stat),                                                                              \
+												  VitruvioChannel)
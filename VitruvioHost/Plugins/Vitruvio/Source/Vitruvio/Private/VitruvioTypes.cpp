@@ -176,4 +176,74 @@ uint32 GetTypeHash(const FInstanceCacheKey& Object)
 	return HashCombine(GetTypeHash(Object.MeshId), GetArrayHash(Object.MaterialOverrides));
 }
 
+void FCollisionData::Set(TArray<FVector3f> InVertices, TArrayView<const uint32> InIndices, bool bWeld)
+{
+	TArray<uint32> WeldedIndices;
+	if (bWeld)
+	{
+		TMap<FVector3f, uint32> WeldedVertexIndices;
+		WeldedVertexIndices.Reserve(InVertices.Num());
+		Vertices.Reset(InVertices.Num());
+		WeldedIndices.Reserve(InIndices.Num());
+
+		for (const uint32 Index : InIndices)
+		{
+			const FVector3f& Vertex = InVertices[Index];
+			const uint32* WeldedIndex = WeldedVertexIndices.Find(Vertex);
+			if (!WeldedIndex)
+			{
+				WeldedIndex = &WeldedVertexIndices.Add(Vertex, Vertices.Add(Vertex));
+			}
+			WeldedIndices.Add(*WeldedIndex);
+		}
+
+		Vertices.Shrink();
+		InIndices = WeldedIndices;
+	}
+	else
+	{
+		Vertices = MoveTemp(InVertices);
+	}
+
+	SmallIndices.Empty();
+	Indices.Empty();
+	if (Vertices.Num() <= TNumericLimits<uint16>::Max() + 1)
+	{
+		SmallIndices.SetNumUninitialized(InIndices.Num());
+		for (int32 Index = 0; Index < InIndices.Num(); ++Index)
+		{
+			SmallIndices[Index] = static_cast<uint16>(InIndices[Index]);
+		}
+	}
+	else
+	{
+		Indices.Append(InIndices.GetData(), InIndices.Num());
+	}
+}
+
+void FCollisionData::Unpack(TArray<FVector3f>& OutVertices, TArray<FTriIndices>& OutIndices) const
+{
+	OutVertices = Vertices;
+
+	const auto UnpackTriangles = [&OutIndices, this](const auto& PackedIndices) {
+		OutIndices.SetNumUninitialized(NumTriangles());
+		for (int32 TriangleIndex = 0; TriangleIndex < OutIndices.Num(); ++TriangleIndex)
+		{
+			FTriIndices& TriIndex = OutIndices[TriangleIndex];
+			TriIndex.v0 = PackedIndices[TriangleIndex * 3 + 0];
+			TriIndex.v1 = PackedIndices[TriangleIndex * 3 + 1];
+			TriIndex.v2 = PackedIndices[TriangleIndex * 3 + 2];
+		}
+	};
+
+	if (!SmallIndices.IsEmpty())
+	{
+		UnpackTriangles(SmallIndices);
+	}
+	else
+	{
+		UnpackTriangles(Indices);
+	}
+}
+
 } // namespace Vitruvio
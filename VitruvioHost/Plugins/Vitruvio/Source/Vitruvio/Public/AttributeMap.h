@@ -18,18 +18,35 @@
 #include "RuleAttributes.h"
 
 #include "PRTTypes.h"
+#include "Util/AttributeConversion.h"
+
+#include <string>
+
+/**
+ * \brief Rule file information derived from a resolve map. Created once per rule package and cached alongside its resolve map.
+ */
+struct FRuleInfo
+{
+	ResolveMapSPtr ResolveMap;
+	std::wstring RuleFile;
+	std::wstring StartRule;
+	RuleFileInfoPtr RuleFileInfo;
+	Vitruvio::FAttributeSchema AttributeSchema;
+};
+
+using FRuleInfoPtr = TSharedPtr<const FRuleInfo>;
 
 class VITRUVIO_API FAttributeMap
 {
 public:
 	FAttributeMap() {}
 
-	FAttributeMap(AttributeMapUPtr AttributeMap, const RuleFileInfoPtr& RuleInfo) : AttributeMap(std::move(AttributeMap)), RuleInfo(RuleInfo) {}
+	FAttributeMap(AttributeMapUPtr AttributeMap, const FRuleInfoPtr& RuleInfo) : AttributeMap(std::move(AttributeMap)), RuleInfo(RuleInfo) {}
 
 	void UpdateUnrealAttributeMap(TMap<FString, URuleAttribute*>& AttributeMapOut, UObject* const Outer);
 
 	const AttributeMapUPtr AttributeMap;
-	const RuleFileInfoPtr RuleInfo;
+	const FRuleInfoPtr RuleInfo;
 };
 
 using FAttributeMapPtr = TSharedPtr<FAttributeMap>;
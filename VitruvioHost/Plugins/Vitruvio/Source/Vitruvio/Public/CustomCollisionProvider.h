@@ -19,20 +19,17 @@ protected:
 			return false;
 		}
 
-		TriCollisionData->Indices = CollisionData.Indices;
-		TArray<uint16> MaterialIndices;
-		MaterialIndices.SetNumZeroed(CollisionData.Indices.Num());
-		TriCollisionData->MaterialIndices = MaterialIndices;
-		TriCollisionData->Vertices = CollisionData.Vertices;
+		CollisionData.Unpack(TriCollisionData->Vertices, TriCollisionData->Indices);
+		TriCollisionData->MaterialIndices.SetNumZeroed(TriCollisionData->Indices.Num());
 		TriCollisionData->bFlipNormals = true;
 		return true;
 	}
 	
 public:
 
-	void SetCollisionData(const Vitruvio::FCollisionData& InCollisionData)
+	void SetCollisionData(Vitruvio::FCollisionData&& InCollisionData)
 	{
-		CollisionData = InCollisionData;
+		CollisionData = MoveTemp(InCollisionData);
 	}
 
 	void ClearCollisionData()
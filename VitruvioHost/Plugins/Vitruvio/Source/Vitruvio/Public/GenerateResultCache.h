@@ -0,0 +1,89 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "HAL/ThreadSafeCounter.h"
+
+struct FGenerateResultDescription;
+struct FInitialShape;
+
+/**
+ * \brief Memoizes generate results by the content of the generate inputs (rule package content hash, geometry, user-set attributes, random seed and
+ * occlusion context). Entries are evicted in least recently used order once the memory budget
+ * (Esri.Vitruvio.GenerateResultCacheBudget) is exceeded.
+ */
+class FGenerateResultCache
+{
+public:
+	using FKey = uint64;
+
+	/**
+	 * \brief Computes the content key for a generate call.
+	 *
+	 * \param bBatchGenerate whether the key is used for a batch generate call (results are not interchangeable with single generate calls)
+	 * \param InitialShapes the initial shapes to generate (including occluders for single generate calls)
+	 * \param bEnableOcclusionQueries whether occlusion queries are enabled
+	 * \param OccluderOnlyShapes additional shapes only used as occluders
+	 */
+	static FKey ComputeKey(bool bBatchGenerate, const TArray<FInitialShape>& InitialShapes, bool bEnableOcclusionQueries,
+						   const TArray<FInitialShape>& OccluderOnlyShapes);
+
+	VITRUVIO_API TSharedPtr<const FGenerateResultDescription> Get(FKey Key);
+	VITRUVIO_API void Add(FKey Key, const FGenerateResultDescription& Result);
+	VITRUVIO_API void Empty();
+
+	/**
+	 * Re-queries the sizes of all cached results, the sizes of their meshes change once they have been built.
+	 */
+	VITRUVIO_API void UpdateSizes();
+
+	int32 GetNumHits() const
+	{
+		return Hits.GetValue();
+	}
+
+	int32 GetNumMisses() const
+	{
+		return Misses.GetValue();
+	}
+
+	int32 GetNumEvictions() const
+	{
+		return Evictions.GetValue();
+	}
+
+	VITRUVIO_API SIZE_T GetAllocatedSize() const;
+
+private:
+	struct FEntry
+	{
+		TSharedPtr<const FGenerateResultDescription> Result;
+		SIZE_T Size = 0;
+		uint64 LastAccess = 0;
+	};
+
+	void EvictToBudget(SIZE_T Budget);
+
+	mutable FCriticalSection GenerateResultCacheCriticalSection;
+
+	TMap<FKey, FEntry> Cache;
+	SIZE_T TotalSize = 0;
+	uint64 AccessCounter = 0;
+
+	FThreadSafeCounter Hits;
+	FThreadSafeCounter Misses;
+	FThreadSafeCounter Evictions;
+};
@@ -1,30 +1,91 @@
-/* Copyright 2024 Esri
- *
- * Licensed under the Apache License Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- *     http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an "AS IS" BASIS,
- * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- */
-
-#pragma once
-#include "VitruvioMesh.h"
-
-class FMeshCache
-{
-public:
-	VITRUVIO_API TSharedPtr<FVitruvioMesh> Get(const FString& Uri);
-	VITRUVIO_API TSharedPtr<FVitruvioMesh> InsertOrGet(const FString& Uri, const TSharedPtr<FVitruvioMesh>& Mesh);
-	VITRUVIO_API void Empty();
-
-private:
-	FCriticalSection MeshCacheCriticalSection;
-
-	TMap<FString, TSharedPtr<FVitruvioMesh>> Cache;
-};
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include "VitruvioMesh.h"
+
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeCounter64.h"
+
+/**
+ * \brief Shares the prototype meshes between generate calls by their id. Once the memory budget (Esri.Vitruvio.MeshCacheBudget) is exceeded,
+ * meshes which are no longer referenced outside of the cache are evicted in least recently used order.
+ */
+class FMeshCache
+{
+public:
+	VITRUVIO_API TSharedPtr<FVitruvioMesh> Get(const FString& Uri);
+	VITRUVIO_API TSharedPtr<FVitruvioMesh> InsertOrGet(const FString& Uri, const TSharedPtr<FVitruvioMesh>& Mesh);
+	VITRUVIO_API void Empty();
+
+	/**
+	 * Re-queries the sizes of all cached meshes. Meshes shrink once they have been built and their source data is released.
+	 */
+	VITRUVIO_API void UpdateSizes();
+
+	int32 GetNumHits() const
+	{
+		return Hits.GetValue();
+	}
+
+	int32 GetNumMisses() const
+	{
+		return Misses.GetValue();
+	}
+
+	int32 GetNumEvictions() const
+	{
+		return Evictions.GetValue();
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return static_cast<SIZE_T>(TotalSize.GetValue());
+	}
+
+private:
+	struct FEntry
+	{
+		TSharedPtr<FVitruvioMesh> Mesh;
+		// Estimated when the mesh is inserted, updated by UpdateSizes
+		SIZE_T Size = 0;
+		// Updated under the read lock of the shard
+		int64 LastAccess = 0;
+	};
+
+	// Callbacks of concurrent generate calls look up prototypes in parallel, so the cache is split into independently locked shards
+	static constexpr int32 NumShards = 16;
+
+	struct FShard
+	{
+		FRWLock Lock;
+		TMap<FString, FEntry> Entries;
+	};
+
+	FShard& GetShard(const FString& Uri);
+	void EvictToBudget(SIZE_T Budget);
+
+	FShard Shards[NumShards];
+
+	FThreadSafeCounter64 TotalSize;
+	FThreadSafeCounter64 AccessCounter;
+
+	FThreadSafeCounter Hits;
+	FThreadSafeCounter Misses;
+	FThreadSafeCounter Evictions;
+
+	// Only one thread evicts at a time, the others skip eviction as the budget is enforced anyway
+	FCriticalSection EvictionCriticalSection;
+};
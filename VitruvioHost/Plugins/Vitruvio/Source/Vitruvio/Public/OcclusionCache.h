@@ -0,0 +1,109 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "PRTTypes.h"
+
+/**
+ * \brief Caches the occlusion handles of initial shapes in a shared PRT occlusion set. The cache lock is only held while handles are looked
+ * up, registered or invalidated and never during a PRT call. Generate calls pin the occlusion set they use with an FScopedSnapshot.
+ * Disposing handles modifies the occlusion set, so invalidated handles are only disposed once all snapshots which might still use them are
+ * gone and no PRT call can use the set concurrently.
+ */
+class FOcclusionCache
+{
+	struct FPendingHandle
+	{
+		// The last cache version whose snapshots might use the handle
+		uint64 Version;
+		prt::OcclusionSet::Handle Handle;
+	};
+
+	struct FOcclusionSetState
+	{
+		OcclusionSetUPtr OcclusionSet;
+		// The versions of the live snapshots of this set in ascending order (versions only increase)
+		TArray<uint64> SnapshotVersions;
+		TArray<FPendingHandle> PendingDisposal;
+	};
+
+public:
+	/**
+	 * \brief Pins the cached occlusion handles of the given initial shapes (and the occlusion set they belong to) for the lifetime of
+	 * this object.
+	 */
+	class FScopedSnapshot
+	{
+	public:
+		VITRUVIO_API FScopedSnapshot(FOcclusionCache& Cache, const TArray<int64>& InitialShapeIndices);
+		VITRUVIO_API ~FScopedSnapshot();
+
+		FScopedSnapshot(const FScopedSnapshot&) = delete;
+		FScopedSnapshot& operator=(const FScopedSnapshot&) = delete;
+
+		/**
+		 * \return the initial shape indices which had no cached handle when the snapshot was taken. Their occluders have to be generated
+		 * into GetOcclusionSet() and passed to AddOccluders.
+		 */
+		const TArray<int64>& GetMissingInitialShapeIndices() const
+		{
+			return MissingInitialShapeIndices;
+		}
+
+		/**
+		 * \brief Adds newly generated occluder handles to the snapshot and registers them in the cache unless the initial shape has been
+		 * invalidated (or registered by a concurrent call) since the snapshot was taken.
+		 */
+		VITRUVIO_API void AddOccluders(const TArray<int64>& InitialShapeIndices, const TArray<prt::OcclusionSet::Handle>& NewHandles);
+
+		prt::OcclusionSet* GetOcclusionSet() const
+		{
+			return State->OcclusionSet.get();
+		}
+
+		prt::OcclusionSet::Handle GetHandle(int64 InitialShapeIndex) const
+		{
+			return Handles[InitialShapeIndex];
+		}
+
+	private:
+		FOcclusionCache& Cache;
+		TSharedPtr<FOcclusionSetState> State;
+		uint64 Version;
+
+		TMap<int64, prt::OcclusionSet::Handle> Handles;
+		TArray<int64> MissingInitialShapeIndices;
+	};
+
+	VITRUVIO_API void Invalidate(const TArray<int64>& InitialShapeIndices);
+
+	/**
+	 * \brief Drops all cached handles and starts over with a new occlusion set. The previous set is destroyed once it is no longer used
+	 * by any snapshot.
+	 */
+	VITRUVIO_API void Reset();
+
+private:
+	static void DisposeOrDefer(FOcclusionSetState& SetState, uint64 Version, const TArray<prt::OcclusionSet::Handle>& InvalidHandles);
+	static void DisposePending(FOcclusionSetState& SetState);
+
+	mutable FCriticalSection OcclusionCacheCriticalSection;
+
+	TSharedPtr<FOcclusionSetState> State;
+	TMap<int64, prt::OcclusionSet::Handle> HandleCache;
+	TMap<int64, uint64> InvalidationVersions;
+	uint64 Version = 0;
+};
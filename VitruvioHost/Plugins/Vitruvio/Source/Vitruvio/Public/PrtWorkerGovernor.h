@@ -0,0 +1,132 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "HAL/ThreadSafeCounter.h"
+
+class FEvent;
+
+enum class EPrtCallPriority : uint8
+{
+	/** Calls for a single component the user is currently editing. */
+	Interactive,
+	/** Batch calls which (re)generate whole tiles. */
+	Background
+};
+
+/**
+ * \brief Hands out a fixed budget of PRT worker threads (Esri.Vitruvio.PrtWorkerThreads) across all concurrent PRT calls. Calls wait in
+ * priority and then FIFO order if no worker is available. Background callers should check CanAdmit() before dispatching new calls to keep the number of
+ * waiting calls bounded (Esri.Vitruvio.MaxQueuedPrtCalls).
+ */
+class FPrtWorkerGovernor
+{
+public:
+	/**
+	 * \brief Acquires workers for the lifetime of this object.
+	 */
+	class FScopedWorkers
+	{
+	public:
+		FScopedWorkers(FPrtWorkerGovernor& Governor, int32 DesiredWorkers, EPrtCallPriority Priority = EPrtCallPriority::Background)
+			: Governor(Governor), NumWorkers(Governor.Acquire(DesiredWorkers, Priority))
+		{
+		}
+
+		~FScopedWorkers()
+		{
+			Governor.Release(NumWorkers);
+		}
+
+		FScopedWorkers(const FScopedWorkers&) = delete;
+		FScopedWorkers& operator=(const FScopedWorkers&) = delete;
+
+		int32 GetNumWorkers() const
+		{
+			return NumWorkers;
+		}
+
+	private:
+		FPrtWorkerGovernor& Governor;
+		int32 NumWorkers;
+	};
+
+	/**
+	 * \brief Blocks until at least one worker is available. Interactive calls are served before waiting background calls.
+	 *
+	 * \param DesiredWorkers the maximum number of workers the call can make use of.
+	 * \param Priority the priority of the call.
+	 * \return the number of granted workers which have to be passed to Release.
+	 */
+	VITRUVIO_API int32 Acquire(int32 DesiredWorkers, EPrtCallPriority Priority = EPrtCallPriority::Background);
+	VITRUVIO_API void Release(int32 NumWorkers);
+
+	/**
+	 * \brief Tracks a dispatched call from the moment it is scheduled until it has finished.
+	 */
+	VITRUVIO_API void BeginCall();
+	VITRUVIO_API void EndCall();
+
+	/**
+	 * \return whether a new background call can be dispatched without exceeding the queue bound.
+	 */
+	VITRUVIO_API bool CanAdmit() const;
+
+	/**
+	 * \brief Counts a call which has been deferred because it could not be admitted. Callers retrying the same call only count it once.
+	 */
+	VITRUVIO_API void AddDeferredCall();
+
+	VITRUVIO_API int32 GetWorkerBudget() const;
+	VITRUVIO_API int32 GetMaxQueuedCalls() const;
+	VITRUVIO_API int32 GetNumBusyWorkers() const;
+	VITRUVIO_API int32 GetNumWaitingCalls() const;
+
+	int32 GetNumCalls() const
+	{
+		return NumCalls.GetValue();
+	}
+
+	int32 GetNumContendedAcquires() const
+	{
+		return NumContendedAcquires.GetValue();
+	}
+
+	int32 GetNumRejectedCalls() const
+	{
+		return NumRejectedCalls.GetValue();
+	}
+
+private:
+	struct FWaiter
+	{
+		FEvent* Event;
+		EPrtCallPriority Priority;
+		int32 DesiredWorkers;
+		int32 GrantedWorkers;
+	};
+
+	int32 GetGrant(int32 DesiredWorkers) const;
+
+	mutable FCriticalSection GovernorCriticalSection;
+
+	TArray<FWaiter*> Waiters;
+	int32 BusyWorkers = 0;
+
+	FThreadSafeCounter NumCalls;
+	FThreadSafeCounter NumContendedAcquires;
+	FThreadSafeCounter NumRejectedCalls;
+};
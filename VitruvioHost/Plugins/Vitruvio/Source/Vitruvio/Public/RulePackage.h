@@ -16,6 +16,7 @@
 #pragma once
 
 #include "Containers/Array.h"
+#include "Serialization/BulkData.h"
 #include "UObject/Object.h"
 #include "UObject/ObjectSaveContext.h"
 
@@ -26,12 +27,30 @@ class VITRUVIO_API URulePackage final : public UObject
 {
 	GENERATED_BODY()
 public:
-	UPROPERTY(Transient)
-	TArray<uint8> Data;
-
 	UPROPERTY()
 	FString SourcePath;
 
+	// Hash of the rpk data, used to share the extracted rpk and its resolve map between rule packages with identical content
+	UPROPERTY()
+	FString ContentHash;
+
+	/**
+	 * \brief Replaces the rpk data and updates the content hash.
+	 */
+	void SetData(TArray<uint8>&& InData);
+
+	/**
+	 * \brief Returns a copy of the rpk data. The data is only read from the package when requested and not kept resident afterwards.
+	 */
+	TArray<uint8> LoadData();
+
+	int64 GetDataSize() const
+	{
+		return Data.GetBulkDataSize();
+	}
+
+	static FString ComputeContentHash(const TArray<uint8>& InData);
+
 	virtual void PreSave(FObjectPreSaveContext SaveContext) override
 	{
 		Super::PreSave(SaveContext);
@@ -42,26 +61,9 @@ public:
 		FUniqueObjectGuid::GetOrCreateIDForObject(this);
 	}
 
-	virtual void Serialize(FArchive& Ar) override
-	{
-		Super::Serialize(Ar);
+	virtual void Serialize(FArchive& Ar) override;
 
-		// We can not use TArray#BulkSerialize as it does not use the fast path if we are not cooking
-		// This is an adapted version of bulk serialize without that limitation
-		Data.CountBytes(Ar);
-		if (Ar.IsLoading())
-		{
-			int32 NewArrayNum = 0;
-			Ar << NewArrayNum;
-			Data.Empty(NewArrayNum);
-			Data.AddUninitialized(NewArrayNum);
-			Ar.Serialize(Data.GetData(), NewArrayNum);
-		}
-		else if (Ar.IsSaving())
-		{
-			int32 ArrayNum = Data.Num();
-			Ar << ArrayNum;
-			Ar.Serialize(Data.GetData(), ArrayNum);
-		}
-	}
+private:
+	FByteBulkData Data;
+	FCriticalSection DataLock;
 };
@@ -0,0 +1,102 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "VitruvioTypes.h"
+
+#include "HAL/ThreadSafeCounter.h"
+#include "UObject/GCObject.h"
+
+struct FFileChangeData;
+
+/**
+ * \brief Shares the decoded textures between material creations by their path. Once the memory budget (Esri.Vitruvio.TextureCacheBudget) is
+ * exceeded, textures are evicted in least recently used order. Evicted textures stay alive as long as materials reference them.
+ *
+ * Changed texture files are invalidated by watching the directories of the cached textures (editor only), so lookups do not touch the file
+ * system.
+ */
+class FTextureCache
+{
+public:
+	VITRUVIO_API bool Find(const FString& Path, Vitruvio::FTextureData& OutTextureData);
+	VITRUVIO_API void Add(const FString& Path, const Vitruvio::FTextureData& TextureData);
+	VITRUVIO_API void Empty();
+
+	/**
+	 * Starts watching the directory of the given texture for changes unless it is already watched. Has to be called on the game thread before
+	 * the texture is loaded, changes happening between loading and watching would otherwise go unnoticed.
+	 */
+	VITRUVIO_API void WatchTextureDirectory(const FString& Path);
+
+	/**
+	 * Stops watching all directories, called before the directory watcher module is unloaded.
+	 */
+	VITRUVIO_API void UnwatchDirectories();
+
+	void AddReferencedObjects(FReferenceCollector& Collector);
+
+	int32 GetNumHits() const
+	{
+		return Hits.GetValue();
+	}
+
+	int32 GetNumMisses() const
+	{
+		return Misses.GetValue();
+	}
+
+	int32 GetNumEvictions() const
+	{
+		return Evictions.GetValue();
+	}
+
+	int32 GetNumInvalidations() const
+	{
+		return Invalidations.GetValue();
+	}
+
+	VITRUVIO_API SIZE_T GetCpuSize() const;
+	VITRUVIO_API SIZE_T GetGpuSize() const;
+
+private:
+	struct FEntry
+	{
+		Vitruvio::FTextureData TextureData;
+		// Size of the mip data kept in the platform data of the texture
+		SIZE_T CpuSize = 0;
+		// Size of the texture resource
+		SIZE_T GpuSize = 0;
+		int64 LastAccess = 0;
+	};
+
+	void EvictToBudget(SIZE_T Budget);
+	void OnDirectoryChanged(const TArray<FFileChangeData>& FileChanges);
+
+	mutable FCriticalSection CacheCriticalSection;
+	TMap<FString, FEntry> Entries;
+	SIZE_T CpuSize = 0;
+	SIZE_T GpuSize = 0;
+	int64 AccessCounter = 0;
+
+	// Only accessed on the game thread
+	TMap<FString, FDelegateHandle> WatchedDirectories;
+
+	FThreadSafeCounter Hits;
+	FThreadSafeCounter Misses;
+	FThreadSafeCounter Evictions;
+	FThreadSafeCounter Invalidations;
+};
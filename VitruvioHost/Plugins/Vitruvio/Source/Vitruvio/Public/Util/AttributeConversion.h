@@ -18,9 +18,37 @@
 #include "PRTTypes.h"
 #include "RuleAttributes.h"
 
+#include "UObject/StrongObjectPtr.h"
+
+#include <string>
+
 namespace Vitruvio
 {
-void UpdateAttributeMap(TMap<FString, URuleAttribute*>& AttributeMapOut, const AttributeMapUPtr& AttributeMap, const RuleFileInfoPtr& RuleInfo,
+/**
+ * \brief Per attribute data of a rule file which does not depend on the evaluated shape. Hidden attributes, attributes with parameters
+ * and non-default styles are not part of the schema.
+ */
+struct FAttributeSchemaEntry
+{
+	const prt::RuleFileInfo::Entry* AttributeInfo = nullptr;
+	std::wstring Name;
+	FString AttributeName;
+	FString DisplayName;
+	FString ImportPath;
+	int ImportOrder = INT32_MAX;
+
+	// Attribute with the parsed annotations, lazily created on the game thread and duplicated for every component using the attribute
+	mutable TStrongObjectPtr<URuleAttribute> TemplateAttribute;
+};
+
+using FAttributeSchema = TArray<FAttributeSchemaEntry>;
+
+/**
+ * \brief Creates the attribute schema of the given rule file. The schema references entries of RuleInfo and must not outlive it.
+ */
+FAttributeSchema CreateAttributeSchema(const RuleFileInfoPtr& RuleInfo);
+
+void UpdateAttributeMap(TMap<FString, URuleAttribute*>& AttributeMapOut, const AttributeMapUPtr& AttributeMap, const FAttributeSchema& Schema,
 						UObject* const Outer);
 
 AttributeMapUPtr CreateAttributeMap(const TMap<FString, URuleAttribute*>& Attributes);
@@ -18,11 +18,23 @@
 #include "CoreMinimal.h"
 
 #include "VitruvioModule.h"
+#include "VitruvioSpatialIndex.h"
 #include "GenerateCompletedCallbackProxy.h"
 #include "Util/AttributeConversion.h"
 
 #include "VitruvioBatchActor.generated.h"
 
+UENUM()
+enum class EBatchOutputGranularity : uint8
+{
+	/** One generated model per tile. */
+	Tile,
+	/** One generated model per cluster of neighbouring initial shapes inside a tile (see AVitruvioBatchActor::ClusterSize). */
+	Cluster,
+	/** One generated model per initial shape. */
+	InitialShape
+};
+
 UCLASS()
 class UTile : public UObject
 {
@@ -38,10 +50,15 @@ public:
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category = "Vitruvio")
 	bool bMarkedForGenerate;
 	bool bIsGenerating;
+	// Whether the generate was requested for a single component the user is editing
+	bool bInteractiveGenerate;
+	// Whether the marked generate has already been counted as deferred by the PRT worker governor
+	bool bGenerateDeferred;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category = "Vitruvio")
 	bool bMarkedForEvaluateAttributes;
 	bool bIsEvaluatingAttributes;
+	bool bAttributeEvaluationDeferred;
 
 	UPROPERTY()
 	TMap<UVitruvioComponent*, UGenerateCompletedCallbackProxy*> GenerateCallbackProxies;
@@ -81,7 +98,12 @@ struct FGrid
 	void MarkForAttributeEvaluation(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy = nullptr);
 	void MarkAllForAttributeEvaluation();
 
-	void MarkForGenerate(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy = nullptr);
+	/**
+	 * Marks the tile of the given component for generation. Only interactive generates (edits of the user in the editor) bypass the admission
+	 * control of the PRT worker governor, all others are dispatched once the workers have caught up.
+	 */
+	void MarkForGenerate(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy = nullptr,
+						 EPrtCallPriority Priority = EPrtCallPriority::Background);
 	void MarkAllForGenerate();
 	
 	void RegisterAll(const TSet<UVitruvioComponent*>& VitruvioComponents, AVitruvioBatchActor* VitruvioBatchActor, bool bGeneateModel = true);
@@ -96,7 +118,7 @@ struct FGrid
 	void UnmarkAllForGenerate();
 	void UnmarkAllForAttributeEvaluation();
 
-	TArray<FInitialShape> GetNeighboringShapes(const UTile* Tile, const TArray<FInitialShape>& Initial);
+	TArray<FInitialShape> GetNeighboringShapes(const UTile* Tile, const TArray<FInitialShape>& InitialShapes, const FVitruvioSpatialIndex& SpatialIndex);
 };
 
 struct FBatchGenerateQueueItem
@@ -113,6 +135,44 @@ struct FEvaluateAttributesQueueItem
 	TArray<UVitruvioComponent*> VitruvioComponents;
 };
 
+enum class EBatchGenerateStage : uint8
+{
+	UpdateAttributes,
+	BuildMeshes,
+	WaitForMeshes,
+	ConvertResult,
+	RegisterClusters,
+	RegisterInstances,
+	Finish
+};
+
+/**
+ * Generate queue item which is currently being applied to its tile. Applying an item is split into small work units (one component,
+ * mesh or instance component at a time) so that a single heavy tile can be spread over multiple frames.
+ */
+struct FBatchGenerateProgress
+{
+	FBatchGenerateQueueItem Item;
+	EBatchGenerateStage Stage = EBatchGenerateStage::UpdateAttributes;
+	int32 NextIndex = 0;
+
+	TArray<TTuple<FString, TSharedPtr<FVitruvioMesh>>> MeshesToBuild;
+	TArray<TSharedPtr<FVitruvioMesh>> ClusterModels;
+	TArray<FInstance> Instances;
+	TSet<FInstance> ReplacedInstances;
+	TMap<FString, int32> NameMap;
+
+	// Kept per item as several items can be in flight at once, the materials are referenced by the static meshes of the item
+	TMap<UMaterialInterface*, FString> MaterialIdentifiers;
+	TMap<FString, int32> UniqueMaterialIdentifiers;
+};
+
+struct FEvaluateAttributesProgress
+{
+	FEvaluateAttributesQueueItem Item;
+	int32 NextIndex = 0;
+};
+
 UCLASS(NotBlueprintable, NotPlaceable)
 class VITRUVIO_API AVitruvioBatchActor : public AActor
 {
@@ -125,6 +185,25 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Vitruvio")
 	bool bEnableOcclusionQueries = false;
 
+	/**
+	 * Generates initial shapes which only differ by their location and rotation about the up axis (same polygon, rule package, random seed
+	 * and attributes) only once and adds them as instances. Rules whose output depends on the absolute location or orientation of the initial
+	 * shape must not use this.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Vitruvio", meta = (EditCondition = "!bEnableOcclusionQueries"))
+	bool bInstanceIdenticalInitialShapes = false;
+
+	/**
+	 * How the generated geometry of a tile is split into static meshes. Smaller meshes can be culled and streamed individually at the
+	 * cost of more draw calls. Instances are always registered per tile.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Vitruvio")
+	EBatchOutputGranularity OutputGranularity = EBatchOutputGranularity::Tile;
+
+	/** The size (in cm) of the square cells initial shapes are clustered by if the output granularity is set to Cluster. */
+	UPROPERTY(EditAnywhere, Category = "Vitruvio", meta = (ClampMin = "100", EditCondition = "OutputGranularity == EBatchOutputGranularity::Cluster"))
+	double ClusterSize = 10000;
+
 #if WITH_EDITORONLY_DATA
 	UPROPERTY(EditAnywhere, Category = "Vitruvio")
 	bool bDebugVisualizeGrid = false;
@@ -137,9 +216,9 @@ private:
 	TQueue<FBatchGenerateQueueItem> GenerateQueue;
 	TQueue<FEvaluateAttributesQueueItem> AttributeEvaluationQueue;
 
-	UPROPERTY(Transient)
-	TMap<UMaterialInterface*, FString> MaterialIdentifiers;
-	TMap<FString, int32> UniqueMaterialIdentifiers;
+	// Results which are being applied in queue order, results waiting for their meshes are skipped until they have been built
+	TArray<FBatchGenerateProgress> GenerateProgresses;
+	TOptional<FEvaluateAttributesProgress> AttributeEvaluationProgress;
 
 	int NumModelComponents = 0;
 	
@@ -178,7 +257,8 @@ public:
 	void EvaluateAttributes(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy = nullptr);
 	void EvaluateAllAttributes(UGenerateCompletedCallbackProxy* CallbackProxy = nullptr);
 	
-	void Generate(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy = nullptr);
+	void Generate(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy = nullptr,
+				  EPrtCallPriority Priority = EPrtCallPriority::Background);
 	void GenerateAll(UGenerateCompletedCallbackProxy* CallbackProxy = nullptr);
 	
 	FIntPoint GetPosition(const UVitruvioComponent* VitruvioComponent) const;
@@ -205,8 +285,12 @@ public:
 	
 private:
 	void ProcessTiles();
-	void ProcessGenerateQueue();
-	void ProcessAttributeEvaluationQueue();
+	void AssignOutputClusters(TArray<FInitialShape>& InitialShapes) const;
+	void ProcessGenerateQueue(double Deadline);
+	void ProcessAttributeEvaluationQueue(double Deadline);
+
+	/** Executes the next work unit of the current generate progress. Returns true once the item has been fully applied. */
+	bool ProcessGenerateProgress(FBatchGenerateProgress& Progress);
 
 	FCriticalSection ProcessGenerateQueueCriticalSection;
 	FCriticalSection ProcessAttributeEvaluationQueueCriticalSection;
@@ -16,6 +16,7 @@
 #pragma once
 
 #include "VitruvioBatchActor.h"
+#include "VitruvioSpatialIndex.h"
 #include "Runtime/Engine/Public/Subsystems/WorldSubsystem.h"
 
 #include "VitruvioBatchSubsystem.generated.h"
@@ -38,12 +39,19 @@ public:
 	void EvaluateAttributes(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy = nullptr);
 	void EvaluateAllAttributes(UGenerateCompletedCallbackProxy* CallbackProxy = nullptr);
 	
-	void Generate(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy = nullptr);
+	void Generate(UVitruvioComponent* VitruvioComponent, UGenerateCompletedCallbackProxy* CallbackProxy = nullptr,
+				  EPrtCallPriority Priority = EPrtCallPriority::Background);
 	void GenerateAll(UGenerateCompletedCallbackProxy* CallbackProxy);
 
 	AVitruvioBatchActor* GetBatchActor();
 	bool HasRegisteredVitruvioComponents() const;
 
+	/** Positions of all initialized VitruvioComponents of this world (batch generated or not) used for neighbor queries. */
+	FVitruvioSpatialIndex& GetSpatialIndex()
+	{
+		return SpatialIndex;
+	}
+
 	DECLARE_MULTICAST_DELEGATE(FOnComponentRegistered);
 	FOnComponentRegistered OnComponentRegistered;
 
@@ -58,6 +66,8 @@ private:
 	UPROPERTY()
 	TSet<UVitruvioComponent*> RegisteredComponents;
 
+	FVitruvioSpatialIndex SpatialIndex;
+
 #if WITH_EDITORONLY_DATA
 	FDelegateHandle OnActorMoved;
 	FDelegateHandle OnActorsMoved;
@@ -51,6 +51,7 @@ struct FAttributesEvaluationQueueItem
 	FAttributeMapPtr AttributeMap;
 	bool bForceRegenerate;
 	UGenerateCompletedCallbackProxy* CallbackProxy;
+	EPrtCallPriority Priority;
 };
 
 struct FGenerateQueueItem
@@ -90,13 +91,30 @@ struct FConvertedGenerateResult
 	TMap<FString, FReport> Reports;
 };
 
-FConvertedGenerateResult BuildGenerateResult(const FGenerateResultDescription& GenerateResult,
-									 TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
-									 TMap<FString, Vitruvio::FTextureData>& TextureCache,
-									 TMap<UMaterialInterface*, FString>& MaterialIdentifiers,
-									 TMap<FString, int32>& UniqueMaterialIdentifiers,
-									 UMaterial* OpaqueParent, UMaterial* MaskedParent, UMaterial* TranslucentParent,
-									 UWorld* World);
+/**
+ * Builds all meshes of the given generate result asynchronously. Materials are created immediately, OnBuilt is called on the game thread once
+ * all meshes of the generate result have been built, after which the result can be converted with ConvertGenerateResult.
+ */
+void BuildGenerateResultAsync(const FGenerateResultDescription& GenerateResult,
+							  TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
+							  FTextureCache& TextureCache, TMap<UMaterialInterface*, FString>& MaterialIdentifiers,
+							  TMap<FString, int32>& UniqueMaterialIdentifiers, UMaterial* OpaqueParent, UMaterial* MaskedParent,
+							  UMaterial* TranslucentParent, UWorld* World, TFunction<void()> OnBuilt);
+
+/**
+ * Returns the name and mesh of all meshes of the given generate result which need to be built before the result can be converted.
+ */
+TArray<TTuple<FString, TSharedPtr<FVitruvioMesh>>> GetMeshesToBuild(const FGenerateResultDescription& GenerateResult);
+
+/**
+ * Converts an already built generate result (see GetMeshesToBuild and BuildGenerateResultAsync).
+ */
+FConvertedGenerateResult ConvertGenerateResult(const FGenerateResultDescription& GenerateResult,
+											   TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
+											   FTextureCache& TextureCache,
+											   TMap<UMaterialInterface*, FString>& MaterialIdentifiers,
+											   TMap<FString, int32>& UniqueMaterialIdentifiers,
+											   UMaterial* OpaqueParent, UMaterial* MaskedParent, UMaterial* TranslucentParent);
 
 FString UniqueComponentName(const FString& Name, TMap<FString, int32>& UsedNames);
 
@@ -201,8 +219,11 @@ public:
 	/**
 	 * Generates a model using the current Rule Package and initial shape. If the attributes are not yet available, they will first be evaluated. If
 	 * no Initial Shape or Rule Package is set, this method will do nothing.
+	 *
+	 * @param Priority Interactive for edits of the user in the editor, which are batch generated ahead of the other tiles.
 	 */
-	void Generate(UGenerateCompletedCallbackProxy* CallbackProxy = nullptr, const FGenerateOptions& GenerateOptions = {});
+	void Generate(UGenerateCompletedCallbackProxy* CallbackProxy = nullptr, const FGenerateOptions& GenerateOptions = {},
+				  EPrtCallPriority Priority = EPrtCallPriority::Background);
 
 	/**
 	 * Sets the given Rule Package. This will reevaluate the attributes and if bGenerateModel is set to true, also generates the model.
@@ -451,8 +472,10 @@ public:
 	 * Evaluate rule attributes.
 	 *
 	 * @param ForceRegenerate Whether to force regenerate even if generate automatically is set to false
+	 * @param Priority The priority of the regenerate, Interactive for edits of the user in the editor
 	 */
-	void EvaluateRuleAttributes(bool ForceRegenerate = false, UGenerateCompletedCallbackProxy* CallbackProxy = nullptr);
+	void EvaluateRuleAttributes(bool ForceRegenerate = false, UGenerateCompletedCallbackProxy* CallbackProxy = nullptr,
+								EPrtCallPriority Priority = EPrtCallPriority::Background);
 
 	/* Returns whether the initial shape type can be changed */
 	bool CanChangeInitialShapeType() const
@@ -533,6 +556,9 @@ private:
 	FGenerateResult::FTokenPtr GenerateToken;
 	FAttributeMapResult::FTokenPtr EvalAttributesInvalidationToken;
 
+	// Identifies the generate result whose meshes are currently built asynchronously
+	int32 PendingMeshBuildId = 0;
+
 	bool HasGeneratedMesh = false;
 
 	// Note that these are only unique per VitruvioComponent
@@ -541,12 +567,16 @@ private:
 	TMap<FString, int32> UniqueMaterialIdentifiers;
 
 	TArray<FInitialShape> GetNeighboringShapes() const;
+
+	FDelegateHandle OwnerTransformUpdated;
+	void UpdateSpatialIndex(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
 	
 	void CalculateRandomSeed();
 
 	void NotifyAttributesChanged();
 
 	void ProcessGenerateQueue();
+	void ApplyGenerateResult(const FGenerateQueueItem& Result);
 	void ProcessAttributesEvaluationQueue();
 
 #if WITH_EDITOR
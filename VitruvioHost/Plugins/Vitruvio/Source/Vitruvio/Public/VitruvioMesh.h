@@ -17,31 +17,141 @@
 
 #include "CustomCollisionProvider.h"
 #include "MeshDescription.h"
+#include "StaticMeshResources.h"
+#include "TextureCache.h"
 #include "VitruvioTypes.h"
 #include "Runtime/PhysicsCore/Public/Interface_CollisionDataProviderCore.h"
 
 
 UMaterialInstanceDynamic* CacheMaterial(UMaterial* OpaqueParent, UMaterial* MaskedParent, UMaterial* TranslucentParent,
-										TMap<FString, Vitruvio::FTextureData>& TextureCache,
+										FTextureCache& TextureCache,
 										TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
 										const Vitruvio::FMaterialAttributeContainer& MaterialAttributes, TMap<FString, int32>& UniqueMaterialNames,
 										TMap<UMaterialInterface*, FString>& MaterialIdentifiers, UObject* Outer);
 
-class FVitruvioMesh
+namespace Vitruvio
 {
+/**
+ * Triangulated render buffers of a mesh which are copied directly into the static mesh render data, bypassing FMeshDescription. Every face
+ * corner is its own vertex and the triangles are grouped into one section per material.
+ */
+struct FRenderMeshData
+{
+	struct FSection
+	{
+		uint32 FirstIndex = 0;
+		uint32 NumTriangles = 0;
+		uint32 MinVertexIndex = 0;
+		uint32 MaxVertexIndex = 0;
+	};
+
+	// Only as many uv channels as needed for the highest uv set of the mesh are stored
+	int32 NumUVChannels = 1;
+
+	TArray<FVector3f> Positions;
+	TArray<FVector3f> TangentX;
+	TArray<FVector3f> TangentY;
+	TArray<FVector3f> TangentZ;
+	// NumUVChannels coordinates per vertex
+	TArray<FVector2f> UVs;
+	TArray<uint32> Indices;
+	TArray<FSection> Sections;
+
+	bool IsEmpty() const
+	{
+		return Indices.IsEmpty();
+	}
+
+	/** Widens the uvs of the vertices added so far to at least MinUVChannels per vertex, the added channels are zero. */
+	void GrowUVChannels(int32 MinUVChannels)
+	{
+		if (MinUVChannels <= NumUVChannels)
+		{
+			return;
+		}
+
+		const int32 NumVertices = UVs.Num() / NumUVChannels;
+		TArray<FVector2f> GrownUVs;
+		GrownUVs.SetNumZeroed(NumVertices * MinUVChannels);
+		for (int32 VertexIndex = 0; VertexIndex < NumVertices; ++VertexIndex)
+		{
+			FMemory::Memcpy(&GrownUVs[VertexIndex * MinUVChannels], &UVs[VertexIndex * NumUVChannels], NumUVChannels * sizeof(FVector2f));
+		}
+
+		UVs = MoveTemp(GrownUVs);
+		NumUVChannels = MinUVChannels;
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Positions.GetAllocatedSize() + TangentX.GetAllocatedSize() + TangentY.GetAllocatedSize() + TangentZ.GetAllocatedSize() +
+			   UVs.GetAllocatedSize() + Indices.GetAllocatedSize() + Sections.GetAllocatedSize();
+	}
+};
+} // namespace Vitruvio
+
+class FVitruvioMesh : public TSharedFromThis<FVitruvioMesh>
+{
+	enum class EBuildState : uint8
+	{
+		NotBuilt,
+		Building,
+		Built
+	};
+
+	/** Render and collision data which is prepared from the mesh description on a worker thread. */
+	struct FBuildData
+	{
+		TUniquePtr<FStaticMeshRenderData> RenderData;
+		Vitruvio::FCollisionData CollisionData;
+	};
+
 	FString Identifier;
 
+	// Meshes are either built from their mesh description or directly from render buffers (see Esri.Vitruvio.DirectMeshConversion)
 	FMeshDescription MeshDescription;
+	Vitruvio::FRenderMeshData RenderMeshData;
+	// Set on construction, both are empty once the source data has been released
+	bool bIsRenderData;
 	TArray<Vitruvio::FMaterialAttributeContainer> Materials;
+	// The identifier per material slot, used for material replacements
+	TArray<FString> MaterialIdentifiers;
 
 	UStaticMesh* StaticMesh;
 	UCustomCollisionDataProvider* CollisionDataProvider;
 
+	EBuildState BuildState = EBuildState::NotBuilt;
+	TArray<TFunction<void()>> OnBuiltCallbacks;
+
+	// The mesh description or render buffers are released once the static mesh has been built (see Esri.Vitruvio.ReleaseMeshSourceData), the
+	// size is kept up to date for the caches which query it from other threads
+	TAtomic<SIZE_T> SourceDataSize = 0;
+	// Size of the static mesh resources (render data and collision), only known once the static mesh has been built
+	TAtomic<SIZE_T> ResourceSize = 0;
+
 public:
 	FVitruvioMesh(const FString& Identifier, const FMeshDescription& MeshDescription,
 				  const TArray<Vitruvio::FMaterialAttributeContainer>& Materials)
-		: Identifier(Identifier), MeshDescription(MeshDescription), Materials(Materials), StaticMesh(nullptr), CollisionDataProvider(nullptr)
+		: Identifier(Identifier), MeshDescription(MeshDescription), bIsRenderData(false), Materials(Materials), StaticMesh(nullptr),
+		  CollisionDataProvider(nullptr)
 	{
+		for (const Vitruvio::FMaterialAttributeContainer& MaterialAttributes : Materials)
+		{
+			MaterialIdentifiers.Add(MaterialAttributes.GetMaterialName());
+		}
+		SourceDataSize = ComputeSourceDataSize();
+	}
+
+	FVitruvioMesh(const FString& Identifier, Vitruvio::FRenderMeshData&& RenderMeshData,
+				  const TArray<Vitruvio::FMaterialAttributeContainer>& Materials)
+		: Identifier(Identifier), RenderMeshData(MoveTemp(RenderMeshData)), bIsRenderData(true), Materials(Materials), StaticMesh(nullptr),
+		  CollisionDataProvider(nullptr)
+	{
+		for (const Vitruvio::FMaterialAttributeContainer& MaterialAttributes : Materials)
+		{
+			MaterialIdentifiers.Add(MaterialAttributes.GetMaterialName());
+		}
+		SourceDataSize = ComputeSourceDataSize();
 	}
 
 	~FVitruvioMesh();
@@ -61,8 +171,59 @@ public:
 		return StaticMesh;
 	}
 
-	void Build(const FString& Name, TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
-			   TMap<FString, Vitruvio::FTextureData>& TextureCache, TMap<UMaterialInterface*, FString>& MaterialIdentifiers,
-			   TMap<FString, int32>& UniqueMaterialNames, UMaterial* OpaqueParent, UMaterial* MaskedParent, UMaterial* TranslucentParent,
-			   UWorld* World);
+	/**
+	 * \return the estimated number of bytes used by the mesh description (or render buffers) and materials of this mesh. Built meshes which
+	 * released their source data only account for the materials.
+	 */
+	SIZE_T GetAllocatedSize() const;
+
+	/**
+	 * \return the number of bytes used by the resources of the built static mesh (render data and collision), 0 if it has not been built yet.
+	 * Can be queried from any thread.
+	 */
+	SIZE_T GetResourceSize() const
+	{
+		return ResourceSize.Load();
+	}
+
+	/**
+	 * \return whether the static mesh has been built and can be assigned to components.
+	 */
+	bool IsBuilt() const
+	{
+		return BuildState == EBuildState::Built;
+	}
+
+	/**
+	 * Builds the static mesh asynchronously. The static mesh and its materials are created immediately, the render data and collision are
+	 * prepared on worker threads and only hooked up to the static mesh on the game thread.
+	 *
+	 * The identifiers of the materials of this mesh are added to MaterialIdentifiers on every call, also if the mesh has already been built
+	 * or is being built for another caller.
+	 *
+	 * \param OnBuilt called on the game thread once the static mesh has been built (immediately if it has already been built).
+	 */
+	void BuildAsync(const FString& Name, TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
+					FTextureCache& TextureCache, TMap<UMaterialInterface*, FString>& MaterialIdentifiers,
+					TMap<FString, int32>& UniqueMaterialNames, UMaterial* OpaqueParent, UMaterial* MaskedParent, UMaterial* TranslucentParent,
+					UWorld* World, TFunction<void()> OnBuilt);
+
+private:
+	void CreateStaticMesh(const FString& Name, TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>>& MaterialCache,
+						  FTextureCache& TextureCache, TMap<UMaterialInterface*, FString>& MaterialIdentifiers,
+						  TMap<FString, int32>& UniqueMaterialNames, UMaterial* OpaqueParent, UMaterial* MaskedParent, UMaterial* TranslucentParent,
+						  UWorld* World);
+	bool HasMeshDescription() const
+	{
+		return !bIsRenderData;
+	}
+
+	void AddMaterialIdentifiers(TMap<UMaterialInterface*, FString>& OutMaterialIdentifiers) const;
+
+	SIZE_T ComputeSourceDataSize() const;
+	void ReleaseSourceData();
+
+	FBuildData PrepareBuildData() const;
+	void FinishBuild(FBuildData&& BuildData);
+	void MarkBuilt();
 };
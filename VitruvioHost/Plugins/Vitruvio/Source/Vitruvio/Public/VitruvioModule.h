@@ -16,17 +16,24 @@
 #pragma once
 
 #include "AttributeMap.h"
+#include "CustomCollisionProvider.h"
+#include "GenerateResultCache.h"
 #include "InitialShape.h"
 #include "MeshCache.h"
+#include "OcclusionCache.h"
 #include "PRTTypes.h"
+#include "PrtWorkerGovernor.h"
 #include "Report.h"
 #include "RulePackage.h"
+#include "TextureCache.h"
 
 #include "prt/Object.h"
 
 #include "Engine/StaticMesh.h"
 #include "HAL/ThreadSafeCounter.h"
 #include "HAL/ThreadSafeBool.h"
+#include "Misc/QueuedThreadPool.h"
+#include "Misc/QueuedThreadPoolWrapper.h"
 #include "Modules/ModuleManager.h"
 
 #include "UnrealLogHandler.h"
@@ -48,6 +55,12 @@ struct FGenerateResultDescription
 	TMap<FString, FReport> Reports;
 
 	TArray<FAttributeMapPtr> EvaluatedAttributes;
+
+	// The generated model per output cluster (see FInitialShape::OutputCluster) if the initial shapes were split into several clusters,
+	// GeneratedModel is empty then. Clusters without geometry have no model.
+	TArray<TSharedPtr<FVitruvioMesh>> ClusterModels;
+	// The instances per output cluster, Instances holds the instances of all clusters.
+	TArray<Vitruvio::FInstanceMap> ClusterInstances;
 };
 
 class FInvalidationToken
@@ -105,6 +118,9 @@ struct FInitialShape
 	int32 RandomSeed = 0;
 	URulePackage* RulePackage = nullptr;
 	bool bOccluderOnly = false;
+
+	// Batch generate calls keep the generated geometry of initial shapes with different (dense, zero based) output clusters apart
+	int32 OutputCluster = 0;
 };
 
 using FGenerateResult = TResult<FGenerateResultDescription, FGenerateToken>;
@@ -126,14 +142,20 @@ public:
 	VITRUVIO_API Vitruvio::FTextureData DecodeTexture(UObject* Outer, const FString& Path, const FString& Key) const;
 
 	/**
-	 * \brief Asynchronously evaluates the attributes and generates the models for all given InitialShapes.
+	 * \brief Asynchronously evaluates the attributes and generates the models for all given InitialShapes. Interactive calls are queued
+	 * ahead of background calls.
 	 *
 	 * \param InitialShapes
 	 * \param bEnableOcclusionQueries
 	 * \param OccluderOnlyShapes
+	 * \param Priority
+	 * \param bInstanceIdenticalShapes see BatchGenerate
+	 * \param TraceTag see BatchGenerate
 	 * \return the generated UStaticMesh.
 	 */
-	VITRUVIO_API FBatchGenerateResult BatchGenerateAsync(TArray<FInitialShape> InitialShapes, bool bEnableOcclusionQueries, TArray<FInitialShape> OccluderOnlyShapes) const;
+	VITRUVIO_API FBatchGenerateResult BatchGenerateAsync(TArray<FInitialShape> InitialShapes, bool bEnableOcclusionQueries, TArray<FInitialShape> OccluderOnlyShapes,
+														 EPrtCallPriority Priority = EPrtCallPriority::Background, bool bInstanceIdenticalShapes = false,
+														 FString TraceTag = {}) const;
 
 	/**
 	 * \brief Generate the models with the given InitialShapes.
@@ -141,26 +163,35 @@ public:
 	 * \param InitialShapes
 	 * \param bEnableOcclusionQueries
 	 * \param OccluderOnlyShapes
+	 * \param Priority
+	 * \param bInstanceIdenticalShapes whether initial shapes which only differ by a rigid transform (same rule package, random seed and
+	 * user-set attributes) are generated once and added as instances of a shared mesh. Ignored if occlusion queries are enabled.
+	 * \param TraceTag prefixes the trace spans of the PRT calls (eg. the tile coordinates of the batch)
 	 * \return the generated UStaticMesh.
 	 */
-	VITRUVIO_API FGenerateResultDescription BatchGenerate(TArray<FInitialShape> InitialShapes, bool bEnableOcclusionQueries, TArray<FInitialShape> OccluderOnlyShapes) const;
+	VITRUVIO_API FGenerateResultDescription BatchGenerate(TArray<FInitialShape> InitialShapes, bool bEnableOcclusionQueries, TArray<FInitialShape> OccluderOnlyShapes,
+														  EPrtCallPriority Priority = EPrtCallPriority::Background, bool bInstanceIdenticalShapes = false,
+														  const FString& TraceTag = {}) const;
 
 	/**
-	 * \brief Asynchronously Evaluates attributes for the given initial shapes and rule packages.
+	 * \brief Asynchronously Evaluates attributes for the given initial shapes and rule packages. The call is queued with background priority.
 	 *
 	 * \param InitialShapes
+	 * \param TraceTag see BatchEvaluateRuleAttributes
 	 */
-	VITRUVIO_API FAttributeMapsResult BatchEvaluateRuleAttributesAsync(TArray<FInitialShape> InitialShapes) const;
+	VITRUVIO_API FAttributeMapsResult BatchEvaluateRuleAttributesAsync(TArray<FInitialShape> InitialShapes, FString TraceTag = {}) const;
 	
 	/**
 	 * \brief Evaluates attributes for the given initial shapes and rule package.
 	 *
 	 * \param InitialShapes
+	 * \param TraceTag prefixes the trace spans of the PRT calls (eg. the tile coordinates of the batch)
 	 */
-	VITRUVIO_API TArray<FAttributeMapPtr> BatchEvaluateRuleAttributes(TArray<FInitialShape> InitialShapes) const;
+	VITRUVIO_API TArray<FAttributeMapPtr> BatchEvaluateRuleAttributes(TArray<FInitialShape> InitialShapes, const FString& TraceTag = {}) const;
 
 	/**
-	 * \brief Asynchronously generate the models with the given InitialShape, RulePackage and Attributes.
+	 * \brief Asynchronously generate the models with the given InitialShape, RulePackage and Attributes. The call is queued with
+	 * interactive priority and therefore starts ahead of queued batch calls.
 	 *
 	 * \param InitialShapes The initial shapes to generate the models for.
 	 *						Initial shapes after the first one are considered occlusion shapes and will not be generated as models,
@@ -180,7 +211,7 @@ public:
 	VITRUVIO_API FGenerateResultDescription Generate(TArray<FInitialShape> InitialShapes) const;
 
 	/**
-	 * \brief Asynchronously evaluates attributes for the given initial shape and rule package.
+	 * \brief Asynchronously evaluates attributes for the given initial shape and rule package. The call is queued with interactive priority.
 	 *
 	 * \param InitialShape
 	 * \return
@@ -220,6 +251,14 @@ public:
 		return RpkLoadingTasksCounter.GetValue() > 0;
 	}
 
+	/**
+	 * \returns the governor which distributes the PRT worker threads across concurrent calls.
+	 */
+	VITRUVIO_API FPrtWorkerGovernor& GetPrtWorkerGovernor()
+	{
+		return PrtWorkerGovernor;
+	}
+
 	/**
 	 * \returns the cache used for materials generated by PRT.
 	 */
@@ -237,22 +276,31 @@ public:
 	}
 
 	/**
-	 * \returns the cache used for materials generated by PRT.
+	 * \returns the cache used for generate results.
 	 */
-	VITRUVIO_API TMap<FString, Vitruvio::FTextureData>& GetTextureCache()
+	VITRUVIO_API FGenerateResultCache& GetGenerateResultCache()
+	{
+		return GenerateResultCache;
+	}
+
+	/**
+	 * \returns the cache used for textures of materials generated by PRT.
+	 */
+	VITRUVIO_API FTextureCache& GetTextureCache()
 	{
 		return TextureCache;
 	}
 
 	/**
-	 * Registers a generated mesh to keep it from being garbage collected.
+	 * Registers a generated mesh and its collision data provider to keep them from being garbage collected. The collision data provider is
+	 * only referenced by the body setup of the mesh once its build has finished.
 	 */
-	VITRUVIO_API void RegisterMesh(UStaticMesh* StaticMesh);
+	VITRUVIO_API void RegisterMesh(UStaticMesh* StaticMesh, UCustomCollisionDataProvider* CollisionDataProvider);
 
 	/**
 	 * Unregisters a generated mesh and therefore allows the garbage collector to delete it if it not referenced anywhere else.
 	 */
-	VITRUVIO_API void UnregisterMesh(UStaticMesh* StaticMesh);
+	VITRUVIO_API void UnregisterMesh(UStaticMesh* StaticMesh, UCustomCollisionDataProvider* CollisionDataProvider);
 
 	/**
 	 * Invalidates the occlusion handle of the given initial shape index.
@@ -291,6 +339,8 @@ public:
 	{
 		Collector.AddReferencedObjects(MaterialCache);
 		Collector.AddReferencedObjects(RegisteredMeshes);
+		Collector.AddReferencedObjects(RegisteredCollisionDataProviders);
+		TextureCache.AddReferencedObjects(Collector);
 	}
 
 	FString GetReferencerName() const override
@@ -312,12 +362,17 @@ private:
 	void* PrtDllHandle = nullptr;
 	prt::Object const* PrtLibrary = nullptr;
 	CacheObjectUPtr PrtCache;
+
+	// The options the loaded UnrealGeometryEncoder declares, options added in later encoder versions are only set if it knows them
+	TSet<FString> UnrealEncoderOptionKeys;
 	
 	TUniquePtr<UnrealLogHandler> LogHandler;
 
 	TAtomic<bool> Initialized = false;
 
 	mutable TMap<TLazyObjectPtr<URulePackage>, ResolveMapSPtr> ResolveMapCache;
+	mutable TMap<TLazyObjectPtr<URulePackage>, FRuleInfoPtr> RuleInfoCache;
+	mutable TMap<FString, ResolveMapSPtr> ContentResolveMapCache;
 	mutable TMap<TLazyObjectPtr<URulePackage>, FGraphEventRef> ResolveMapEventGraphRefCache;
 
 	mutable FCriticalSection LoadResolveMapLock;
@@ -326,23 +381,43 @@ private:
 	mutable FThreadSafeCounter RpkLoadingTasksCounter;
 	mutable FThreadSafeCounter LoadAttributesCounter;
 
+	mutable FPrtWorkerGovernor PrtWorkerGovernor;
+	// Runs the PRT calls, limits the concurrency of PrtJobThreadPool to the number of job threads the PRT worker governor can make use of
+	FQueuedThreadPoolWrapper* PrtJobPool = nullptr;
+	FQueuedThreadPool* PrtJobThreadPool = nullptr;
+	mutable TAtomic<int32> PrtJobConcurrency = 0;
+
 	FString RpkFolder;
+	bool bTemporaryRpkFolder = false;
 
 	TMap<Vitruvio::FMaterialAttributeContainer, TObjectPtr<UMaterialInstanceDynamic>> MaterialCache;
-	TMap<FString, Vitruvio::FTextureData> TextureCache;
+	FTextureCache TextureCache;
 	FMeshCache MeshCache;
+	mutable FGenerateResultCache GenerateResultCache;
 
-	mutable FCriticalSection OcclusionLock;
-	mutable TMap<int64, prt::OcclusionSet::Handle> OcclusionHandleCache;
-
-	mutable OcclusionSetUPtr OcclusionSet;
+	mutable FOcclusionCache OcclusionCache;
 
 	FCriticalSection RegisterMeshLock;
 	TSet<TObjectPtr<UStaticMesh>> RegisteredMeshes;
+	TSet<TObjectPtr<UCustomCollisionDataProvider>> RegisteredCollisionDataProviders;
 
 	void NotifyGenerateCompleted() const;
 
+	/**
+	 * \brief Generates the initial shapes which occur only once with a regular batch generate call and the identical ones once per canonical
+	 * shape (see Vitruvio::CanonicalizeInitialShape), whose models are then instanced at all identical initial shapes.
+	 */
+	FGenerateResultDescription BatchGenerateInstanced(TArray<FInitialShape> InitialShapes, EPrtCallPriority Priority, const FString& TraceTag) const;
+
 	TFuture<ResolveMapSPtr> LoadResolveMapAsync(URulePackage* RulePackage) const;
+
+	FQueuedThreadPool& GetPrtJobPool() const;
+
+	/**
+	 * \brief Returns the rule file info, start rule and import order of the given resolve map. Cached alongside the resolve map and evicted
+	 * together with it in EvictFromResolveMapCache.
+	 */
+	FRuleInfoPtr GetRuleInfo(URulePackage* RulePackage, const ResolveMapSPtr& ResolveMap) const;
 	void InitializePrt();
 
 	VITRUVIO_API void EvictFromResolveMapCache(URulePackage* RulePackage);
@@ -0,0 +1,60 @@
+/* Copyright 2024 Esri
+ *
+ * Licensed under the Apache License Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UVitruvioComponent;
+
+/**
+ * \brief Uniform hash grid over the (xy) positions of all initialized VitruvioComponents of a world. Used to find inter-occlusion
+ * neighbors without iterating over all actors. Radius queries only visit the cells overlapping the query circle.
+ */
+class VITRUVIO_API FVitruvioSpatialIndex
+{
+public:
+	/**
+	 * \brief Adds the component or moves it to the given position if it has already been added.
+	 */
+	void Update(UVitruvioComponent* VitruvioComponent, const FVector& Position);
+	void Remove(UVitruvioComponent* VitruvioComponent);
+	void Empty();
+
+	/**
+	 * \brief Appends all components whose position is closer than Radius to Center.
+	 */
+	void QueryRadius(const FVector& Center, double Radius, TArray<UVitruvioComponent*>& OutVitruvioComponents) const;
+
+	int32 Num() const
+	{
+		return Positions.Num();
+	}
+
+private:
+	struct FEntry
+	{
+		// Identifies the entry even if the component has already been garbage collected
+		const UVitruvioComponent* Key;
+		TWeakObjectPtr<UVitruvioComponent> VitruvioComponent;
+		FVector Position;
+	};
+
+	static FIntPoint GetCell(const FVector& Position);
+	void RemoveFromCell(const FIntPoint& Cell, const UVitruvioComponent* VitruvioComponent);
+
+	TMap<FIntPoint, TArray<FEntry>> Cells;
+	TMap<UVitruvioComponent*, FVector> Positions;
+};
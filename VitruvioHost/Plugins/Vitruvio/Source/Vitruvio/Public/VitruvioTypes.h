@@ -149,7 +149,6 @@ struct FTextureData
 {
 	UTexture2D* Texture = nullptr;
 	uint32 NumChannels = 0;
-	FDateTime LoadTime;
 
 	friend bool operator==(const FTextureData& Lhs, const FTextureData& Rhs)
 	{
@@ -162,14 +161,43 @@ struct FTextureData
 	}
 };
 
+/**
+ * Collision geometry in a packed form which is only expanded while the physics meshes are cooked. Duplicate vertices are welded and the
+ * triangle indices are stored with 16 bits if there are few enough vertices.
+ */
 struct FCollisionData
 {
-	TArray<FTriIndices> Indices;
 	TArray<FVector3f> Vertices;
+	TArray<uint16> SmallIndices;
+	TArray<uint32> Indices;
+
+	/**
+	 * Packs the given triangles, every three indices form one triangle.
+	 *
+	 * @param InVertices	The triangle vertices
+	 * @param InIndices		The triangle indices into InVertices
+	 * @param bWeld			Whether duplicate vertices are welded first, only worth it if the vertices are not already shared between faces
+	 */
+	void Set(TArray<FVector3f> InVertices, TArrayView<const uint32> InIndices, bool bWeld);
+
+	/**
+	 * Expands the packed triangles into the format the physics cooker consumes.
+	 */
+	void Unpack(TArray<FVector3f>& OutVertices, TArray<FTriIndices>& OutIndices) const;
+
+	int32 NumTriangles() const
+	{
+		return (SmallIndices.Num() + Indices.Num()) / 3;
+	}
 
 	bool IsValid() const
 	{
-		return Indices.Num() > 0 && Vertices.Num() > 0;
+		return NumTriangles() > 0 && Vertices.Num() > 0;
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Vertices.GetAllocatedSize() + SmallIndices.GetAllocatedSize() + Indices.GetAllocatedSize();
 	}
 };
 
@@ -68,5 +68,11 @@ public class Vitruvio : ModuleRules
 				"AppFramework",
 			}
 		);
+
+		// Used to invalidate cached textures whose files have changed
+		if (Target.bBuildEditor)
+		{
+			PrivateDependencyModuleNames.Add("DirectoryWatcher");
+		}
 	}
 }
@@ -70,7 +70,7 @@ EReimportResult::Type URulePackageFactory::Reimport(UObject* Obj)
 		RulePackage->Modify();
 		RulePackage->MarkPackageDirty();
 
-		RulePackage->Data = Data;
+		RulePackage->SetData(MoveTemp(Data));
 		RulePackage->SourcePath = UAssetImportData::SanitizeImportFilename(CurrentFilename, RulePackage->GetOutermost());
 	}
 
@@ -88,7 +88,7 @@ UObject* URulePackageFactory::FactoryCreateFile(UClass* InClass, UObject* InPare
 	}
 
 	URulePackage* RulePackage = NewObject<URulePackage>(InParent, SupportedClass, InName, Flags | RF_Transactional);
-	RulePackage->Data = Data;
+	RulePackage->SetData(MoveTemp(Data));
 	RulePackage->SourcePath = UAssetImportData::ResolveImportFilename(Filename, RulePackage->GetOutermost());
 	return RulePackage;
 }
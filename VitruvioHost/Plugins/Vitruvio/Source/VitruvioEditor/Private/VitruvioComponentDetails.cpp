@@ -74,7 +74,7 @@ void UpdateAttributeValue(UVitruvioComponent* VitruvioActor, A* Attribute, const
 {
 	Attribute->Value = Value;
 	Attribute->bUserSet = true;
-	VitruvioActor->EvaluateRuleAttributes(VitruvioActor->GenerateAutomatically);
+	VitruvioActor->EvaluateRuleAttributes(VitruvioActor->GenerateAutomatically, nullptr, EPrtCallPriority::Interactive);
 }
 
 bool IsVitruvioComponentSelected(const TArray<TWeakObjectPtr<UObject>>& ObjectsBeingCustomized, UVitruvioComponent*& OutComponent)
@@ -302,7 +302,7 @@ FResetToDefaultOverride ResetToDefaultOverride(URuleAttribute* Attribute, UVitru
 		FIsResetToDefaultVisible::CreateLambda([Attribute](TSharedPtr<IPropertyHandle> Property) { return Attribute->bUserSet; }),
 		FResetToDefaultHandler::CreateLambda([Attribute, VitruvioActor](TSharedPtr<IPropertyHandle> Property) {
 			Attribute->bUserSet = false;
-			VitruvioActor->EvaluateRuleAttributes(VitruvioActor->GenerateAutomatically);
+			VitruvioActor->EvaluateRuleAttributes(VitruvioActor->GenerateAutomatically, nullptr, EPrtCallPriority::Interactive);
 		}));
 	return ResetToDefaultOverride;
 }
@@ -548,7 +548,7 @@ void AddGenerateButton(IDetailCategoryBuilder& RootCategory, UVitruvioComponent*
 			.ContentPadding(FMargin(30, 2))
 			.OnClicked_Lambda([VitruvioComponent]()
 			{
-				VitruvioComponent->Generate();
+				VitruvioComponent->Generate(nullptr, {}, EPrtCallPriority::Interactive);
 				return FReply::Handled();
 			})
 		]
@@ -728,7 +728,7 @@ void FVitruvioComponentDetails::BuildAttributeEditor(IDetailLayoutBuilder& Detai
 				AttributeEntry.Value->bUserSet = false;
 			}
 
-			VitruvioActor->EvaluateRuleAttributes(VitruvioActor->GenerateAutomatically);
+			VitruvioActor->EvaluateRuleAttributes(VitruvioActor->GenerateAutomatically, nullptr, EPrtCallPriority::Interactive);
 		}));
 
 	HeaderProperty.OverrideResetToDefault(ResetAllToDefaultOverride);
@@ -771,7 +771,7 @@ void FVitruvioComponentDetails::BuildAttributeEditor(IDetailLayoutBuilder& Detai
 				}
 			}
 			Attribute->bUserSet = true;
-			VitruvioActor->EvaluateRuleAttributes(VitruvioActor->GenerateAutomatically);
+			VitruvioActor->EvaluateRuleAttributes(VitruvioActor->GenerateAutomatically, nullptr, EPrtCallPriority::Interactive);
 		});
 		const TArray<TSharedRef<IDetailTreeNode>> DetailTreeNodes = Generator->GetRootTreeNodes();
 
@@ -827,7 +827,7 @@ void FVitruvioComponentDetails::AddSwitchInitialShapeCombobox(IDetailCategoryBui
 						GEditor->BeginTransaction(*FGuid::NewGuid().ToString(), FText::FromString("Change Initial Shape Type"), VitruvioComponent->GetOwner());
 						VitruvioComponent->Modify();
 						VitruvioComponent->SetInitialShapeType(InitialShapeTypeMap[Selection]);
-						VitruvioComponent->Generate();
+						VitruvioComponent->Generate(nullptr, {}, EPrtCallPriority::Interactive);
 
 						// Hack to refresh the property editor
 						GEditor->SelectActor(VitruvioComponent->GetOwner(), false, true, true, true);
@@ -17,6 +17,7 @@
 
 #include "AssetRegistry/AssetRegistryModule.h"
 #include "AssetToolsModule.h"
+#include "Algo/AllOf.h"
 #include "Dialogs/DlgPickPath.h"
 #include "Factories/MaterialInstanceConstantFactoryNew.h"
 #include "GeneratedModelHISMComponent.h"
@@ -31,6 +32,8 @@
 #include "VitruvioEditorModule.h"
 #include "VitruvioModule.h"
 
+DEFINE_LOG_CATEGORY_STATIC(LogVitruvioCooker, Log, All);
+
 namespace
 {
 
@@ -214,6 +217,17 @@ UMaterialInstanceConstant* SaveMaterial(UMaterialInstance* Material, const FStri
 	return NewMaterial;
 }
 
+// Generated meshes which have been converted directly into render data (see Esri.Vitruvio.DirectMeshConversion) have no source geometry to persist
+bool HasSourceGeometry(const AActor* Actor)
+{
+	TArray<UStaticMeshComponent*> MeshComponents;
+	Actor->GetComponents<UStaticMeshComponent>(MeshComponents);
+	return Algo::AllOf(MeshComponents, [](const UStaticMeshComponent* MeshComponent) {
+		UStaticMesh* Mesh = MeshComponent->GetStaticMesh();
+		return !Mesh || Mesh->GetOutermost() != GetTransientPackage() || Mesh->GetMeshDescription(0) != nullptr;
+	});
+}
+
 UStaticMesh* SaveStaticMesh(UStaticMesh* Mesh, const FString& Path, FStaticMeshCache& MeshCache, FMaterialCache& MaterialCache,
 							FTextureCache& TextureCache)
 {
@@ -310,6 +324,13 @@ void CookActors(const TArray<AActor*>& Actors, const FString& CookPath)
 			continue;
 		}
 
+		if (!HasSourceGeometry(Actor))
+		{
+			UE_LOG(LogVitruvioCooker, Warning, TEXT("Skipped cooking %s because its models have been generated without source geometry. Disable "
+												   "Esri.Vitruvio.DirectMeshConversion and regenerate to cook it."), *Actor->GetActorLabel());
+			continue;
+		}
+
 		AActor* OldAttachParent = Actor->GetAttachParentActor();
 
 		// Spawn new Actor with persisted geometry
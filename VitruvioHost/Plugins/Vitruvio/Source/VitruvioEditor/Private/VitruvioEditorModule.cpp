@@ -301,7 +301,9 @@ void VitruvioEditorModule::OnMapChanged(UWorld* World, EMapChangeType ChangeType
 {
 	if (ChangeType == EMapChangeType::TearDownWorld)
 	{
+		// Cached meshes hold collision data outered to the world which is torn down
 		VitruvioModule::Get().GetMeshCache().Empty();
+		VitruvioModule::Get().GetGenerateResultCache().Empty();
 		VitruvioModule::Get().InvalidateAllOcclusionHandles();
 
 		// Close all open editor of transient meshes generated by Vitruvio to prevent GC issues while loading a new map